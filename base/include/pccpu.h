@@ -0,0 +1,95 @@
+#ifndef PCCPU_H
+#define PCCPU_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Initial capacity of a work-item log, in records. Logs grow as needed, so records are never dropped.
+ */
+#define PC_CPU_LOG_INITIAL_LEN 4096
+
+/**
+ * @brief Log of one work-item, in the same format as the "log" buffer written by ProfCounter.
+ */
+typedef struct {
+	uint64_t *log;
+	size_t logLen;
+	size_t logCapacity;
+	/* Counter value at the start of the work-item, timestamps are relative to it */
+	uint64_t origin;
+	/* Log could not grow, further records were dropped */
+	bool truncated;
+} pc_cpu_item_t;
+
+/**
+ * @brief CPU backend of the PROFCOUNTER_* macros, for kernels compiled as C with PROFCOUNTER_CPU defined (see profcounter.h).
+ * Every work-item records its commands into its own log, through a thread-local pointer, so that work-items may run concurrently.
+ */
+typedef struct {
+	pc_cpu_item_t *items;
+	unsigned itemsLen;
+	unsigned prescaler;
+	/* Frequency of the time source in MHz (time-stamp counter, or 1000 for clock_gettime()) */
+	unsigned clockMHz;
+	/* Work-item body and argument of the ongoing pc_cpu_run(), next work-item to be run */
+	void (*body)(unsigned, void *);
+	void *bodyArg;
+	unsigned next;
+	pthread_mutex_t mutex;
+} pc_cpu_t;
+
+/**
+ * @brief Prepare the logs of the CPU backend. On x86, the time-stamp counter is used and its frequency is measured against
+ * clock_gettime(), which takes about 20 ms. Other architectures use clock_gettime() directly (1 count per ns).
+ * @param cpu CPU backend to be initialised. Must be released with pc_cpu_close().
+ * @param itemsLen Number of work-items.
+ * @param prescaler Log2 of the number of time source counts per timestamp count, as the "prescaler" argument of profCounter.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_cpu_open(pc_cpu_t *cpu, unsigned itemsLen, unsigned prescaler);
+
+/**
+ * @brief Run every work-item, with the commands issued by the PROFCOUNTER_* macros recorded into the log of the calling
+ * work-item. Each log starts with the header and the clocks record, as if profCounter was started for each work-item.
+ * @param cpu CPU backend.
+ * @param threadsLen Number of threads running work-items concurrently (0 runs them on the calling thread, in order).
+ * @param body Work-item body, usually a wrapper calling the kernel function with its arguments. Receives the work-item ID (also
+ * returned by get_global_id(0)) and @p bodyArg.
+ * @param bodyArg User argument passed to @p body.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if a log could not be allocated or a thread could not be created.
+ */
+int pc_cpu_run(pc_cpu_t *cpu, unsigned threadsLen, void (*body)(unsigned, void *), void *bodyArg);
+
+/**
+ * @brief Get the log of a work-item after pc_cpu_run(). It can be decoded with pc_decode() and saved with pc_log_save().
+ * @param cpu CPU backend.
+ * @param item Work-item ID.
+ * @param logLen Number of 64-bit records in the log.
+ * @return The log, owned by @p cpu (valid until the next pc_cpu_run() or pc_cpu_close()).
+ */
+const uint64_t *pc_cpu_log(const pc_cpu_t *cpu, unsigned item, size_t *logLen);
+
+/**
+ * @brief Release the logs of the CPU backend.
+ * @param cpu CPU backend to be released.
+ */
+void pc_cpu_close(pc_cpu_t *cpu);
+
+/**
+ * @brief Record a ProfCounter command (as written to pipe p0) into the log of the calling work-item. Called by the PROFCOUNTER_*
+ * macros, ignored outside pc_cpu_run().
+ * @param command Pipe word: command on bits [3:0] and checkpoint bank on bits [10:4] (see src/profCounter/commands.vh).
+ */
+void pc_cpu_command(unsigned command);
+
+/**
+ * @brief Work-item ID of the calling work-item, for kernels compiled as C (only dimension 0 is used).
+ * @param dim Dimension.
+ * @return Work-item ID for dimension 0, 0 otherwise.
+ */
+size_t get_global_id(unsigned dim);
+
+#endif
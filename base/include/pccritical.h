@@ -0,0 +1,102 @@
+#ifndef PCCRITICAL_H
+#define PCCRITICAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pcdecoder.h"
+
+/**
+ * @brief Default speedup of the what-if projections of pc_critical_analyse().
+ */
+#define PC_CRITICAL_DEFAULT_SPEEDUP 2.0
+
+/**
+ * @brief Checkpoints issued by one work-item, i.e. a chain of dependent regions. A trace has a single lane unless it comes from an
+ * NDRange DUT. Lanes are keyed by work-group and local ID hash, which is only the local ID for work-groups of up to 256 work-items:
+ * with larger work-groups, work-items sharing a hash are merged into a single lane whose regions mix their checkpoints, and the
+ * analysis is not meaningful.
+ */
+typedef struct {
+	/* Issuing work-group ID and local ID hash (0 unless pc_header_t::ndrange is set) */
+	unsigned group;
+	unsigned local;
+	/* Number of checkpoints, and cycles of the first and of the last one from the start of the timeline */
+	size_t checkpointsLen;
+	uint64_t start;
+	uint64_t end;
+} pc_lane_t;
+
+/**
+ * @brief A region (transition between two consecutive checkpoints of a work-item) as an optimisation target.
+ */
+typedef struct {
+	unsigned from;
+	unsigned to;
+	/* Occurrences and cycles over all work-items */
+	size_t count;
+	uint64_t cycles;
+	/* Occurrences and cycles on the critical path */
+	size_t criticalCount;
+	uint64_t criticalCycles;
+	/* Projected end-to-end cycles if every occurrence took pc_critical_t::speedup times less, and if it took no time at all */
+	uint64_t projected;
+	uint64_t bound;
+} pc_target_t;
+
+/**
+ * @brief Critical path analysis of a trace.
+ */
+typedef struct {
+	/* Speedup of the what-if projections */
+	double speedup;
+	/* Cycle of the first checkpoint, which starts the timeline, and end-to-end cycles up to the last checkpoint */
+	uint64_t origin;
+	uint64_t total;
+	pc_lane_t *lanes;
+	size_t lanesLen;
+	/* Lane that finishes last (the earliest one in case of a tie), whose regions form the critical path */
+	size_t critical;
+	/* Regions, from the most to the least promising (ascending projected end-to-end cycles) */
+	pc_target_t *targets;
+	size_t targetsLen;
+} pc_critical_t;
+
+/**
+ * @brief Find the critical path of a trace and rank its regions by the end-to-end cycles projected if each were made faster.
+ * @param trace Decoded trace. Stamps are ignored. NDRange traces must come from work-groups of up to 256 work-items (see pc_lane_t).
+ * @param speedup Factor by which each region is made faster in the projections (e.g. PC_CRITICAL_DEFAULT_SPEEDUP).
+ * @param critical Analysis result. Must be released with pc_critical_free().
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the trace has no region or on allocation errors.
+ */
+int pc_critical_analyse(const pc_trace_t *trace, double speedup, pc_critical_t *critical);
+
+/**
+ * @brief Project the end-to-end cycles of a trace if a region were made faster.
+ * @param trace Decoded trace.
+ * @param from Checkpoint ID that starts the region.
+ * @param to Checkpoint ID that ends the region.
+ * @param speedup Factor by which every occurrence of the region is made faster.
+ * @param projected Projected end-to-end cycles (unchanged from the trace if the region never occurs).
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the trace has no region or on allocation errors.
+ */
+int pc_critical_project(const pc_trace_t *trace, unsigned from, unsigned to, double speedup, uint64_t *projected);
+
+/**
+ * @brief Release the memory allocated by pc_critical_analyse().
+ * @param critical Analysis to be released.
+ */
+void pc_critical_free(pc_critical_t *critical);
+
+/**
+ * @brief Print the critical path analysis: end-to-end cycles, critical work-item and the most promising regions with their
+ * projections.
+ * @param f Output stream.
+ * @param critical Analysis result.
+ * @param ndrange True if the analysed trace is from an NDRange DUT (pc_header_t::ndrange), to report the critical work-item.
+ * @param symtab Symbol table used to name the checkpoints. May be NULL.
+ */
+void pc_print_critical(FILE *f, const pc_critical_t *critical, bool ndrange, const pc_symtab_t *symtab);
+
+#endif
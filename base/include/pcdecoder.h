@@ -0,0 +1,476 @@
+#ifndef PCDECODER_H
+#define PCDECODER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Record tags, as defined in src/profCounter/records.vh.
+ */
+#define PC_REC_EMPTY 0x00
+#define PC_REC_STAMP 0x01
+#define PC_REC_REPEAT 0x02
+#define PC_REC_HEADER 0x10
+#define PC_REC_TELEMETRY 0x11
+#define PC_REC_CLOCKS 0x12
+#define PC_REC_TRAFFIC 0x13
+#define PC_REC_SAMPLE 0x14
+#define PC_REC_SYNC 0x15
+#define PC_REC_CHECKPOINT 0x80
+
+/**
+ * @brief Log format constants, as defined in src/profCounter/records.vh.
+ */
+#define PC_LOG_VERSION 0x01
+#define PC_LOG_MAGIC 0x50434E54
+
+/**
+ * @brief Record field extraction.
+ */
+#define PC_RECORD_TAG(rec) ((unsigned) (((rec) >> 56) & 0xFF))
+#define PC_RECORD_PAYLOAD(rec) ((rec) & 0xFFFFFFFFFFFFFFull)
+
+/**
+ * @brief Repeat record field extraction (tag of the repeated records, number of records and distance between them).
+ */
+#define PC_REPEAT_TAG(rec) ((unsigned) (((rec) >> 48) & 0xFF))
+#define PC_REPEAT_COUNT(rec) ((unsigned) (((rec) >> 32) & 0xFFFF))
+#define PC_REPEAT_DELTA(rec) ((rec) & 0xFFFFFFFFull)
+
+/**
+ * @brief Issuer of stamps and checkpoints in NDRange logs (work-group ID modulo 8192 and local ID hash, see profcounter.h), and
+ * widest timestamp of such logs.
+ */
+#define PC_EVENT_GROUP(rec) ((unsigned) (((rec) >> 35) & 0x1FFF))
+#define PC_EVENT_LOCAL(rec) ((unsigned) (((rec) >> 48) & 0xFF))
+#define PC_NDRANGE_COUNTER_WIDTH 35
+
+/**
+ * @brief Sample record field extraction (current checkpoint ID, whether a checkpoint was seen, checkpoints since the previous sample
+ * and timestamp), and width of the sample timestamps.
+ */
+#define PC_SAMPLE_ID(rec) ((unsigned) (((rec) >> 49) & 0x7F))
+#define PC_SAMPLE_SEEN(rec) ((bool) (((rec) >> 48) & 0x1))
+#define PC_SAMPLE_HITS(rec) ((unsigned) (((rec) >> 36) & 0xFFF))
+#define PC_SAMPLE_TIMESTAMP(rec) ((rec) & 0xFFFFFFFFFull)
+#define PC_SAMPLE_TIMESTAMP_WIDTH 36
+
+/**
+ * @brief Traffic record field extraction (field, read and write values).
+ */
+#define PC_TRAFFIC_FIELD(rec) ((unsigned) (((rec) >> 54) & 0x3))
+#define PC_TRAFFIC_READ(rec) (((rec) >> 27) & 0x7FFFFFFull)
+#define PC_TRAFFIC_WRITE(rec) ((rec) & 0x7FFFFFFull)
+
+/**
+ * @brief Traffic record fields, as defined in src/profCounter/records.vh.
+ */
+#define PC_TRAFFIC_BYTES 0x0
+#define PC_TRAFFIC_BEATS 0x1
+#define PC_TRAFFIC_BUSY 0x2
+
+/**
+ * @brief Telemetry trailer fields, as defined in src/profCounter/records.vh.
+ */
+#define PC_TEL_FIFO_HIGH_WATER 0x0
+#define PC_TEL_FIFO_DEPTH 0x1
+#define PC_TEL_DROPPED 0x2
+#define PC_TEL_RECEIVED 0x3
+#define PC_TEL_WRITES 0x4
+#define PC_TEL_AW_BLOCKED 0x5
+#define PC_TEL_W_BLOCKED 0x6
+#define PC_TEL_B_BLOCKED 0x7
+#define PC_TEL_LATENCY_HISTOGRAM 0x8
+#define PC_TEL_LATENCY_BINS 8
+#define PC_TEL_FIELDS (PC_TEL_LATENCY_HISTOGRAM + PC_TEL_LATENCY_BINS)
+
+/**
+ * @brief Type of a decoded event.
+ */
+typedef enum {
+	PC_EVENT_STAMP,
+	PC_EVENT_CHECKPOINT
+} pc_event_type_t;
+
+/**
+ * @brief Timestamp format, as described by the log header and the clocks record.
+ */
+typedef struct {
+	unsigned version;
+	unsigned counterWidth;
+	unsigned prescaler;
+	/* Clock frequencies in MHz (0 if unknown or if the log has no clocks record) */
+	unsigned kernelClockMHz;
+	unsigned dutClockMHz;
+	/* True if timestamps count DUT cycles, i.e. pipe p0 crosses from a different clock domain (DUT_CLOCK_DOMAIN in config.vh) */
+	bool dutCycles;
+	/* True if the log was recorded by the CPU backend (see pccpu.h), timestamps then count ticks of the CPU time source */
+	bool cpu;
+	/* True if events carry their issuing work-group and local ID hash (NDRANGE in config.vh) */
+	bool ndrange;
+	/* True if the log has a sync record, which holds the profCounter cycles since reset when the execution started (TSC ticks for */
+	/* the CPU backend), i.e. a time base shared by the instances of a device (see pcmerge) */
+	bool synced;
+	uint64_t syncCycle;
+} pc_header_t;
+
+/**
+ * @brief Traffic of the DUT port monitored by AxiMonitor (AXI_MONITOR in config.vh). Values saturate at 2^27 - 1.
+ */
+typedef struct {
+	/* Bytes requested by read and write bursts */
+	uint64_t readBytes;
+	uint64_t writeBytes;
+	/* Read and write data beats */
+	uint64_t readBeats;
+	uint64_t writeBeats;
+	/* Cycles with at least one read or write burst outstanding */
+	uint64_t readBusy;
+	uint64_t writeBusy;
+} pc_traffic_t;
+
+/**
+ * @brief A decoded event.
+ */
+typedef struct {
+	pc_event_type_t type;
+	/* Checkpoint ID (only valid for PC_EVENT_CHECKPOINT) */
+	unsigned id;
+	/* Clock cycle of this event, with counter wrap-around and prescaler already compensated */
+	uint64_t cycle;
+	/* Issuing work-group ID (modulo 8192) and local ID hash (only valid if pc_header_t::ndrange is set, 0 otherwise) */
+	unsigned group;
+	unsigned local;
+	/* Traffic since the previous checkpoint, or since start (only valid for PC_EVENT_CHECKPOINT if pc_trace_t::traffic is set) */
+	pc_traffic_t traffic;
+} pc_event_t;
+
+/**
+ * @brief A decoded sample (sampling mode, i.e. "interval" argument of profCounter not zero).
+ */
+typedef struct {
+	/* ProfCounter clock cycle of this sample, with counter wrap-around and prescaler already compensated */
+	uint64_t cycle;
+	/* Last checkpoint passed before this sample (only valid if seen is set, otherwise no checkpoint was passed yet) */
+	unsigned id;
+	bool seen;
+	/* Checkpoints passed since the previous sample (saturates at 4095) */
+	unsigned hits;
+} pc_sample_t;
+
+/**
+ * @brief Largest mean slip (cycles per transition) accepted by pc_calibrate().
+ */
+#define PC_CALIBRATION_MAX_SLIP 0.5
+
+/**
+ * @brief Pipe timing calibration, as measured by pc_calibrate(). Distances between events are measured, thus a constant transport
+ * latency cancels out and is not part of it: only its variations (jitter) and the cycles lost by the reference loop (slip) are.
+ */
+typedef struct {
+	/* Nominal distance in cycles between consecutive commands of the reference sequence */
+	unsigned spacing;
+	/* Number of measured distances */
+	size_t samples;
+	/* Mean deviation of the measured distances from the nominal one, e.g. if the reference loop did not achieve II=1 */
+	double slip;
+	/* Standard deviation of the measured distances */
+	double jitter;
+	/* Smallest and largest deviation from the nominal distance */
+	int64_t minDeviation;
+	int64_t maxDeviation;
+} pc_calibration_t;
+
+/**
+ * @brief Source location of a checkpoint, as listed in the symbol table generated by src/profCounter/symtab.sh.
+ */
+typedef struct {
+	unsigned id;
+	char *file;
+	unsigned line;
+	char *label;
+} pc_symbol_t;
+
+/**
+ * @brief Checkpoint symbol table. The same ID may appear at more than one source location.
+ */
+typedef struct {
+	pc_symbol_t *symbols;
+	size_t symbolsLen;
+} pc_symtab_t;
+
+/**
+ * @brief Writer telemetry, as reported by the trailer written on COMM_FINISH.
+ */
+typedef struct {
+	/* False if the log has no telemetry trailer (e.g. logs from older bitstreams) */
+	bool present;
+	/* Largest FIFO occupancy and FIFO depth, in records */
+	uint64_t fifoHighWater;
+	uint64_t fifoDepth;
+	/* Records dropped because the FIFO was full */
+	uint64_t dropped;
+	/* Commands received from the pipe, and beats written to global memory */
+	uint64_t received;
+	uint64_t writes;
+	/* Cycles waiting for AWREADY, WREADY and BVALID */
+	uint64_t awBlocked;
+	uint64_t wBlocked;
+	uint64_t bBlocked;
+	/* Write latency histogram (cycles from AWVALID to BVALID). Bin 0 is below 4 cycles, bin i counts [2^(i+1), 2^(i+2)), the */
+	/* last bin is 256 cycles or more */
+	uint64_t latency[PC_TEL_LATENCY_BINS];
+} pc_telemetry_t;
+
+/**
+ * @brief A decoded trace (i.e. the events of one ProfCounter execution).
+ */
+typedef struct {
+	pc_header_t header;
+	pc_event_t *events;
+	size_t eventsLen;
+	pc_telemetry_t telemetry;
+	/* Number of repeat records expanded into events (0 unless RUN_COMPRESSION is defined in config.vh) */
+	size_t repeatRecords;
+	/* True if checkpoints carry the traffic of a monitored DUT port (AXI_MONITOR in config.vh) */
+	bool traffic;
+	/* Periodic samples, if the execution was sampled (events are then empty) */
+	pc_sample_t *samples;
+	size_t samplesLen;
+	/* Calibration applied with pc_apply_calibration(), if any */
+	bool calibrated;
+	pc_calibration_t calibration;
+} pc_trace_t;
+
+/**
+ * @brief Item produced by the incremental decoder.
+ */
+typedef enum {
+	PC_STREAM_NONE,
+	PC_STREAM_EVENT,
+	PC_STREAM_SAMPLE
+} pc_stream_item_t;
+
+/**
+ * @brief Incremental decoder, for logs that are decoded record by record (e.g. too large to be decoded at once, or still being
+ * written). Records are given in log order to pc_stream_record(), then the events or sample each one stands for are taken with
+ * pc_stream_next(). Telemetry and traffic records produce no item.
+ */
+typedef struct {
+	/* Filled by the header, clocks and sync records */
+	pc_header_t header;
+	bool started;
+	/* Counter wrap-around of events and samples */
+	uint64_t counterMask;
+	uint64_t epoch;
+	uint64_t previous;
+	uint64_t sampleMask;
+	uint64_t sampleEpoch;
+	uint64_t samplePrevious;
+	/* Last record, its event tag, and the events or sample not yet taken from it */
+	uint64_t record;
+	unsigned tag;
+	unsigned pending;
+	bool repeated;
+	uint64_t delta;
+	bool samplePending;
+} pc_stream_t;
+
+/**
+ * @brief Initialise an incremental decoder. It holds no resources, thus it needs no release.
+ * @param stream Decoder.
+ */
+void pc_stream_init(pc_stream_t *stream);
+
+/**
+ * @brief Give the next record of a log to an incremental decoder. Items left from the previous record are discarded.
+ * @param stream Decoder.
+ * @param record Record. The first one must be the log header.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the log does not start with a valid header.
+ */
+int pc_stream_record(pc_stream_t *stream, uint64_t record);
+
+/**
+ * @brief Take the next item of the last record given to an incremental decoder.
+ * @param stream Decoder.
+ * @param event Decoded event, if PC_STREAM_EVENT is returned (traffic is left empty).
+ * @param sample Decoded sample, if PC_STREAM_SAMPLE is returned.
+ * @return Type of the item, PC_STREAM_NONE once the record has no more items.
+ */
+pc_stream_item_t pc_stream_next(pc_stream_t *stream, pc_event_t *event, pc_sample_t *sample);
+
+/**
+ * @brief Decode a raw log as written by ProfCounter.
+ * @param log Raw log, as read from the "log" global memory buffer.
+ * @param logLen Number of 64-bit records in @p log. Decoding stops at the first empty record.
+ * @param trace Decoded trace. Must be released with pc_trace_free().
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the log is malformed (e.g. no valid header was found).
+ */
+int pc_decode(const uint64_t *log, size_t logLen, pc_trace_t *trace);
+
+/**
+ * @brief Save the used part of a raw log (i.e. up to the first empty record) to a binary file, for offline decoding.
+ * @param fileName Path to the log file (usually profcounter.log).
+ * @param log Raw log, as read from the "log" global memory buffer.
+ * @param logLen Number of 64-bit records in @p log.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_log_save(const char *fileName, const uint64_t *log, size_t logLen);
+
+/**
+ * @brief Load a raw log saved by pc_log_save().
+ * @param fileName Path to the log file.
+ * @param log Loaded raw log. Must be released with free().
+ * @param logLen Number of 64-bit records in @p log.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_log_load(const char *fileName, uint64_t **log, size_t *logLen);
+
+/**
+ * @brief Release the memory allocated by pc_decode().
+ * @param trace Trace to be released.
+ */
+void pc_trace_free(pc_trace_t *trace);
+
+/**
+ * @brief Split the events of an NDRange trace per work-group, or per work-item (work-group and local ID hash). Each part is a trace
+ * with the header and telemetry of @p trace and the events of one issuer, in chronological order, so that analyses that assume a
+ * single instruction stream (e.g. pc_profile_add()) can be applied to each part. Parts are sorted by work-group (then local ID hash).
+ * A trace that is not from an NDRange log is returned as a single part.
+ * @param trace Decoded trace.
+ * @param byWorkItem Split per work-item instead of per work-group.
+ * @param parts Traces of each part. Each must be released with pc_trace_free(), then the array with free().
+ * @param partsLen Number of parts.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_trace_split(const pc_trace_t *trace, bool byWorkItem, pc_trace_t **parts, size_t *partsLen);
+
+/**
+ * @brief Print a decoded trace as a table. The issuer of each event is shown for NDRange logs.
+ * @param f Output stream.
+ * @param trace Decoded trace.
+ * @param symtab Symbol table used to name the checkpoints. May be NULL.
+ */
+void pc_print_trace(FILE *f, const pc_trace_t *trace, const pc_symtab_t *symtab);
+
+/**
+ * @brief Print the writer telemetry of a decoded trace, followed by a diagnosis of lost records. Nothing is printed if the log has no
+ * telemetry trailer.
+ * @param f Output stream.
+ * @param trace Decoded trace.
+ */
+void pc_print_telemetry(FILE *f, const pc_trace_t *trace);
+
+/**
+ * @brief Print the events of an NDRange trace per work-group: work-items seen, events, first and last cycle and span of each
+ * work-group. Nothing is printed if the log is not from an NDRange DUT.
+ * @param f Output stream.
+ * @param trace Decoded trace.
+ */
+void pc_print_groups(FILE *f, const pc_trace_t *trace);
+
+/**
+ * @brief Print the traffic of the monitored DUT port per region (i.e. per pair of consecutive checkpoints): bytes, achieved bandwidth
+ * and share of cycles with outstanding bursts, summed over all occurrences of the region. Nothing is printed if the log has no
+ * traffic records.
+ * @param f Output stream.
+ * @param trace Decoded trace.
+ * @param symtab Symbol table used to name the checkpoints. May be NULL.
+ */
+void pc_print_traffic(FILE *f, const pc_trace_t *trace, const pc_symtab_t *symtab);
+
+/**
+ * @brief Print the time-in-region profile of a sampled trace: for each region (last checkpoint passed), the samples that fell in it,
+ * their share with its 95% confidence interval, the estimated cycles and the checkpoints passed. Regions are sorted by share. Nothing
+ * is printed if the trace has no samples.
+ * @param f Output stream.
+ * @param trace Decoded trace.
+ * @param symtab Symbol table used to name the checkpoints. May be NULL.
+ */
+void pc_print_samples(FILE *f, const pc_trace_t *trace, const pc_symtab_t *symtab);
+
+/**
+ * @brief Export a decoded trace as CSV (one event per line). Work-group and local ID columns are added for NDRange logs, traffic
+ * columns if the log has traffic records.
+ * @param f Output stream.
+ * @param trace Decoded trace.
+ * @param symtab Symbol table used to name the checkpoints. May be NULL.
+ */
+void pc_export_csv(FILE *f, const pc_trace_t *trace, const pc_symtab_t *symtab);
+
+/**
+ * @brief Print a string as a quoted CSV field, with embedded quotes doubled.
+ * @param f Output stream.
+ * @param str String to be printed.
+ */
+void pc_csv_string(FILE *f, const char *str);
+
+/**
+ * @brief Load a checkpoint symbol table generated by src/profCounter/symtab.sh.
+ * @param fileName Path to the symbol table (usually <kernel>.pcsym, next to <kernel>.xo).
+ * @param symtab Loaded symbol table. Must be released with pc_symtab_free().
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_symtab_load(const char *fileName, pc_symtab_t *symtab);
+
+/**
+ * @brief Release the memory allocated by pc_symtab_load().
+ * @param symtab Symbol table to be released.
+ */
+void pc_symtab_free(pc_symtab_t *symtab);
+
+/**
+ * @brief Find the first source location of a checkpoint ID.
+ * @param symtab Symbol table. May be NULL.
+ * @param id Checkpoint ID.
+ * @return The symbol, or NULL if not found.
+ */
+const pc_symbol_t *pc_symtab_lookup(const pc_symtab_t *symtab, unsigned id);
+
+/**
+ * @brief Format a human-readable name for a checkpoint ID: its label if any, otherwise file:line. A "(+N)" suffix indicates that the
+ * same ID is used at N other source locations.
+ * @param symtab Symbol table. May be NULL, in which case the hexadecimal ID is used.
+ * @param id Checkpoint ID.
+ * @param name Output buffer.
+ * @param nameSz Size of @p name.
+ * @return @p name.
+ */
+char *pc_symbol_name(const pc_symtab_t *symtab, unsigned id, char *name, size_t nameSz);
+
+/**
+ * @brief Measure the pipe timing jitter from a trace of the PROFCOUNTER_CALIBRATE() reference sequence. The reference distances are
+ * only known if the reference loop achieved II=1, thus the calibration is rejected if the mean slip exceeds PC_CALIBRATION_MAX_SLIP.
+ * @param trace Decoded trace of the reference sequence, without prescaler and not from an NDRange DUT.
+ * @param spacing Nominal distance in cycles between consecutive commands, as passed to PROFCOUNTER_CALIBRATE().
+ * @param calibration Measured calibration.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the trace is not suitable for calibration or the slip is too large.
+ */
+int pc_calibrate(const pc_trace_t *trace, unsigned spacing, pc_calibration_t *calibration);
+
+/**
+ * @brief Save a calibration to a text file.
+ * @param fileName Path to the calibration file.
+ * @param calibration Calibration to be saved.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_calibration_save(const char *fileName, const pc_calibration_t *calibration);
+
+/**
+ * @brief Load a calibration from a text file created by pc_calibration_save().
+ * @param fileName Path to the calibration file.
+ * @param calibration Loaded calibration.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_calibration_load(const char *fileName, pc_calibration_t *calibration);
+
+/**
+ * @brief Attach a calibration to a decoded trace, so that the timing uncertainty of its transitions is reported with it (see
+ * pc_print_trace()). Timestamps are not modified.
+ * @param trace Decoded trace.
+ * @param calibration Calibration to be attached.
+ */
+void pc_apply_calibration(pc_trace_t *trace, const pc_calibration_t *calibration);
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef PCDRAIN_H
+#define PCDRAIN_H
+
+#include <CL/opencl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pcdecoder.h"
+
+/**
+ * @brief Number of pinned host buffers used by the drain (i.e. double-buffering).
+ */
+#define PC_DRAIN_SLOTS 2
+
+/**
+ * @brief Maximum number of worker threads.
+ */
+#define PC_DRAIN_MAX_WORKERS 4
+
+/**
+ * @brief Function called by a worker thread for every drained log.
+ * @param run Sequential number of the drained log, in the order the logs were enqueued with pc_drain_enqueue().
+ * @param log Raw log. Only valid during the call.
+ * @param logLen Number of 64-bit records in @p log.
+ * @param trace Decoded trace. The consumer may take ownership of its events (e.g. by copying the structure and zeroing the
+ * original), otherwise they are released after the call.
+ * @param arg User argument given to pc_drain_init().
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise (counted in pc_drain_t::failures).
+ */
+typedef int (*pc_drain_consumer_t)(unsigned run, const uint64_t *log, size_t logLen, pc_trace_t *trace, void *arg);
+
+/**
+ * @brief State of a pinned host buffer.
+ */
+typedef enum {
+	/* Available for a new transfer */
+	PC_SLOT_FREE,
+	/* Transfer enqueued, waiting for its completion callback */
+	PC_SLOT_TRANSFERRING,
+	/* Transfer completed, waiting for a worker thread */
+	PC_SLOT_READY,
+	/* Being decoded/exported by a worker thread */
+	PC_SLOT_CONSUMING
+} pc_slot_state_t;
+
+/**
+ * @brief Pinned host buffer receiving one log.
+ */
+typedef struct {
+	/* Buffer allocated by the OpenCL runtime (CL_MEM_ALLOC_HOST_PTR) and its mapped host pointer */
+	cl_mem buffer;
+	uint64_t *log;
+	/* Event of the non-blocking read into this buffer */
+	cl_event event;
+	pc_slot_state_t state;
+	/* Transfer failed (negative event status) */
+	bool failed;
+	unsigned run;
+} pc_slot_t;
+
+/**
+ * @brief Asynchronous log drain. Reads are issued with non-blocking clEnqueueReadBuffer() calls chained to the ProfCounter kernel
+ * event, and completed logs are decoded and handed to a consumer by worker threads, while the next kernel launch is in flight.
+ */
+typedef struct {
+	cl_command_queue queue;
+	size_t logLen;
+	pc_drain_consumer_t consumer;
+	void *consumerArg;
+	pc_slot_t slots[PC_DRAIN_SLOTS];
+	/* Completed transfers in completion order (circular queue of slot indexes) */
+	unsigned ready[PC_DRAIN_SLOTS];
+	unsigned readyHead;
+	unsigned readyLen;
+	/* Slot to be used by the next pc_drain_enqueue() call (slots are used in round-robin) */
+	unsigned next;
+	/* Number of enqueued and consumed logs */
+	unsigned enqueued;
+	unsigned consumed;
+	/* Number of logs that failed to be transferred, decoded or consumed */
+	unsigned failures;
+	pthread_t workers[PC_DRAIN_MAX_WORKERS];
+	unsigned workersLen;
+	bool stopping;
+	pthread_mutex_t mutex;
+	/* Signalled when a slot changes state */
+	pthread_cond_t changed;
+} pc_drain_t;
+
+/**
+ * @brief Allocate the pinned host buffers and start the worker threads.
+ * @param drain Drain to be initialised. Must be released with pc_drain_release().
+ * @param context OpenCL context.
+ * @param queue Command queue where the reads are enqueued (usually the ProfCounter kernel queue). If in-order, a kernel enqueued
+ * after pc_drain_enqueue() on the same queue only overwrites the log buffer after its read completes.
+ * @param logLen Number of 64-bit records in the log buffer.
+ * @param workersLen Number of worker threads (1 to PC_DRAIN_MAX_WORKERS). With more than one worker, the consumer may be called
+ * concurrently and out of order.
+ * @param consumer Function called for every drained log.
+ * @param consumerArg User argument passed to @p consumer.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_drain_init(
+	pc_drain_t *drain, cl_context context, cl_command_queue queue, size_t logLen, unsigned workersLen,
+	pc_drain_consumer_t consumer, void *consumerArg
+);
+
+/**
+ * @brief Enqueue a non-blocking read of a log buffer. This call only blocks while all pinned buffers are in use.
+ * @param drain Drain.
+ * @param logK Log buffer (the "log" argument of the ProfCounter kernel).
+ * @param waitListLen Number of events in @p waitList.
+ * @param waitList Events to wait for before the read (usually the ProfCounter kernel event). May be NULL.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_drain_enqueue(pc_drain_t *drain, cl_mem logK, cl_uint waitListLen, const cl_event *waitList);
+
+/**
+ * @brief Wait until every enqueued log is consumed.
+ * @param drain Drain.
+ * @return EXIT_SUCCESS if all logs were drained without failures, EXIT_FAILURE otherwise.
+ */
+int pc_drain_finish(pc_drain_t *drain);
+
+/**
+ * @brief Wait for the enqueued logs, stop the worker threads and release the pinned host buffers.
+ * @param drain Drain to be released.
+ */
+void pc_drain_release(pc_drain_t *drain);
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef PCLIVE_H
+#define PCLIVE_H
+
+#include <CL/opencl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pcsession.h"
+#include "pcstream.h"
+
+/**
+ * @brief Default drain period, in milliseconds.
+ */
+#define PC_LIVE_DEFAULT_PERIOD 100
+
+/**
+ * @brief Maximum number of connected consumers. Further connections are closed at once.
+ */
+#define PC_LIVE_MAX_CLIENTS 8
+
+/**
+ * @brief Maximum number of events or samples per frame.
+ */
+#define PC_LIVE_FRAME_CAPACITY 1024
+
+/**
+ * @brief Number of work-items of an NDRange DUT whose last checkpoint is tracked at a time (power of two). A work-item evicted by
+ * another one loses one region measurement.
+ */
+#define PC_LIVE_ISSUERS 4096
+
+/**
+ * @brief Time consumers may block the service when sending a frame, in milliseconds. Slower consumers are disconnected.
+ */
+#define PC_LIVE_SEND_TIMEOUT 1000
+
+/**
+ * @brief Last checkpoint of a work-item, for the region statistics.
+ */
+typedef struct {
+	uint32_t issuer;
+	bool valid;
+	unsigned id;
+	uint64_t cycle;
+} pc_live_issuer_t;
+
+/**
+ * @brief Live streaming service. While the profCounter kernel runs, a thread reads the new part of the log buffer every drain
+ * period, decodes it incrementally and publishes the events, samples and region statistics to the consumers connected to a Unix
+ * domain socket.
+ */
+typedef struct {
+	pc_session_t *session;
+	/* Queue used for the reads, so that they are not ordered after the running profCounter kernel */
+	cl_command_queue queue;
+	char *socketPath;
+	unsigned period;
+	int listenFd;
+	int clients[PC_LIVE_MAX_CLIENTS];
+	unsigned clientsLen;
+	/* Watching thread and the profCounter launch it watches */
+	pthread_t thread;
+	bool watching;
+	cl_event running;
+	unsigned run;
+	bool failed;
+	/* Records read at a time, and number of records decoded so far */
+	uint64_t *chunk;
+	size_t consumed;
+	/* Incremental decoder, and whether the header frame of the run was sent */
+	pc_stream_t stream;
+	bool headerSent;
+	uint64_t eventsLen;
+	uint64_t samplesLen;
+	/* Events and samples waiting to be published */
+	pc_live_event_t events[PC_LIVE_FRAME_CAPACITY];
+	unsigned pendingEvents;
+	pc_live_sample_t samples[PC_LIVE_FRAME_CAPACITY];
+	unsigned pendingSamples;
+	/* Region statistics, indexed through regionIndex[from * 128 + to] (0 if unseen, index + 1 otherwise) */
+	pc_live_region_t *regions;
+	size_t regionsLen;
+	uint32_t *regionIndex;
+	/* Last checkpoint of each work-item (a single entry unless the log is from an NDRange DUT) */
+	pc_live_issuer_t *issuers;
+} pc_live_t;
+
+/**
+ * @brief Create the socket and the read queue of a live streaming service.
+ * @param live Service to be opened. Must be released with pc_live_close().
+ * @param session Opened session, whose runs are streamed.
+ * @param socketPath Path of the Unix domain socket (replaced if it exists), or NULL for PC_LIVE_DEFAULT_SOCKET.
+ * @param period Drain period in milliseconds, or 0 for PC_LIVE_DEFAULT_PERIOD.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_live_open(pc_live_t *live, pc_session_t *session, const char *socketPath, unsigned period);
+
+/**
+ * @brief Start streaming the run launched by the last pc_arm(). Must be followed by pc_live_wait() before the next pc_arm(), which
+ * clears the log buffer.
+ * @param live Service.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_live_watch(pc_live_t *live);
+
+/**
+ * @brief Wait for the profCounter kernel to finish and for the rest of its log to be published.
+ * @param live Service.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the run failed or its log could not be read or decoded.
+ */
+int pc_live_wait(pc_live_t *live);
+
+/**
+ * @brief Release the service (the watched run is waited for), disconnect the consumers and remove the socket.
+ * @param live Service to be released.
+ */
+void pc_live_close(pc_live_t *live);
+
+#endif
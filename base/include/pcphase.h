@@ -0,0 +1,96 @@
+#ifndef PCPHASE_H
+#define PCPHASE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pcdecoder.h"
+
+/**
+ * @brief Automatically select the anchor checkpoint in pc_phase_analyse().
+ */
+#define PC_PHASE_AUTO_ANCHOR -1
+
+/**
+ * @brief One iteration of a loop-structured trace, i.e. the events from one occurrence of the anchor checkpoint to the next.
+ */
+typedef struct {
+	/* Index of the first event of this iteration in the trace */
+	size_t firstEvent;
+	/* Number of checkpoints in this iteration */
+	size_t checkpointsLen;
+	/* Cycle where this iteration starts (anchor checkpoint) */
+	uint64_t start;
+	/* Cycles until the next iteration starts (or, for the last iteration, until the checkpoint that follows it) */
+	uint64_t latency;
+	/* Iteration follows the dominant checkpoint sequence (see pc_phases_t) */
+	bool regular;
+} pc_iteration_t;
+
+/**
+ * @brief Per-iteration analysis of a trace.
+ */
+typedef struct {
+	/* Checkpoint ID that starts every iteration */
+	unsigned anchor;
+	/* Dominant checkpoint sequence of an iteration, starting with the anchor */
+	unsigned *pattern;
+	size_t patternLen;
+	pc_iteration_t *iterations;
+	size_t iterationsLen;
+	/* Number of iterations following the dominant sequence */
+	size_t regularLen;
+	/* Cycles before the first and after the last iteration */
+	uint64_t prologue;
+	uint64_t epilogue;
+	/* Statistics of the iteration latencies */
+	uint64_t total;
+	double mean;
+	double stddev;
+	uint64_t min;
+	uint64_t max;
+	/* Iteration with the highest latency */
+	size_t slowest;
+	/* Least-squares slope of the latency over the iteration index, in cycles per iteration */
+	double trend;
+} pc_phases_t;
+
+/**
+ * @brief Segment a trace into iterations of a repeating checkpoint sequence.
+ * @param trace Decoded trace.
+ * @param anchor Checkpoint ID that starts every iteration, or PC_PHASE_AUTO_ANCHOR to use the most frequent checkpoint (the
+ * earliest one in case of a tie).
+ * @param phases Analysis result. Must be released with pc_phases_free().
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if no repeating checkpoint was found.
+ */
+int pc_phase_analyse(const pc_trace_t *trace, int anchor, pc_phases_t *phases);
+
+/**
+ * @brief Release the memory allocated by pc_phase_analyse().
+ * @param phases Analysis to be released.
+ */
+void pc_phases_free(pc_phases_t *phases);
+
+/**
+ * @brief Pearson correlation between the iteration latencies and a per-iteration payload (e.g. the number of elements processed).
+ * @param phases Analysis result.
+ * @param values Payload of each iteration.
+ * @param valuesLen Number of elements in @p values. Only the first min(@p valuesLen, iterations) iterations are considered.
+ * @return Correlation coefficient, or NAN if there are less than 3 iterations or either series is constant.
+ */
+double pc_phase_correlate(const pc_phases_t *phases, const double *values, size_t valuesLen);
+
+/**
+ * @brief Print the per-iteration analysis: summary, dominant iterations and the latency series, broken down into the transitions
+ * of the dominant sequence.
+ * @param f Output stream.
+ * @param phases Analysis result.
+ * @param trace Decoded trace that was analysed.
+ * @param symtab Symbol table used to name the checkpoints. May be NULL.
+ * @param values Payload of each iteration, printed and correlated with the latencies. May be NULL.
+ * @param valuesLen Number of elements in @p values.
+ */
+void pc_print_phases(FILE *f, const pc_phases_t *phases, const pc_trace_t *trace, const pc_symtab_t *symtab, const double *values, size_t valuesLen);
+
+#endif
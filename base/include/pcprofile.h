@@ -0,0 +1,129 @@
+#ifndef PCPROFILE_H
+#define PCPROFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pcdecoder.h"
+
+/**
+ * @brief Cycle distribution of a region, i.e. the transition between two consecutive checkpoints.
+ */
+typedef struct {
+	/* Checkpoint IDs delimiting the region */
+	unsigned from;
+	unsigned to;
+	/* Number of measured transitions */
+	size_t samples;
+	/* Mean and (population) variance of the transition length in cycles */
+	double mean;
+	double variance;
+	uint64_t min;
+	uint64_t max;
+} pc_region_t;
+
+/**
+ * @brief Performance profile: the cycle distributions of all regions observed over one or more traces.
+ */
+typedef struct {
+	/* Number of traces accumulated */
+	size_t runs;
+	pc_region_t *regions;
+	size_t regionsLen;
+} pc_profile_t;
+
+/**
+ * @brief Outcome of the comparison of a region against its baseline.
+ */
+typedef enum {
+	PC_REGION_UNCHANGED,
+	PC_REGION_IMPROVED,
+	PC_REGION_REGRESSED,
+	/* Region only present in the current profile */
+	PC_REGION_NEW,
+	/* Region only present in the baseline */
+	PC_REGION_MISSING
+} pc_verdict_t;
+
+/**
+ * @brief Comparison of a region against its baseline.
+ */
+typedef struct {
+	unsigned from;
+	unsigned to;
+	/* Distributions being compared (zeroed if the region is absent from the respective profile) */
+	pc_region_t baseline;
+	pc_region_t current;
+	/* Relative change of the mean, (current - baseline) / baseline */
+	double change;
+	/* One-sided p-value of Welch's t-test in the direction of the change */
+	double pValue;
+	pc_verdict_t verdict;
+} pc_comparison_t;
+
+/**
+ * @brief Accumulate the transitions between consecutive checkpoints of a decoded trace into a profile. Stamps are ignored. For
+ * NDRange logs, transitions are taken between consecutive checkpoints of the same work-item (see pc_trace_split()).
+ * @param profile Profile. Must be zero-initialised before the first call and released with pc_profile_free().
+ * @param trace Decoded trace.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_profile_add(pc_profile_t *profile, const pc_trace_t *trace);
+
+/**
+ * @brief Release the memory allocated by pc_profile_add() or pc_profile_load().
+ * @param profile Profile to be released.
+ */
+void pc_profile_free(pc_profile_t *profile);
+
+/**
+ * @brief Find the region delimited by a pair of checkpoints.
+ * @param profile Profile.
+ * @param from Checkpoint ID where the region starts.
+ * @param to Checkpoint ID where the region ends.
+ * @return The region, or NULL if not found.
+ */
+const pc_region_t *pc_profile_lookup(const pc_profile_t *profile, unsigned from, unsigned to);
+
+/**
+ * @brief Save a profile to a text file, to be used as baseline.
+ * @param fileName Path to the baseline file.
+ * @param profile Profile to be saved.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_profile_save(const char *fileName, const pc_profile_t *profile);
+
+/**
+ * @brief Load a profile from a text file created by pc_profile_save().
+ * @param fileName Path to the baseline file.
+ * @param profile Loaded profile. Must be released with pc_profile_free().
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_profile_load(const char *fileName, pc_profile_t *profile);
+
+/**
+ * @brief Compare every region of a profile against a baseline. A region regresses (or improves) when its mean changes by more than
+ * @p threshold and the change is significant according to Welch's t-test at level @p alpha.
+ * @param baseline Baseline profile.
+ * @param current Profile under test.
+ * @param threshold Minimum relative change of the mean to be reported (e.g. 0.05 for 5%).
+ * @param alpha Significance level (e.g. 0.01).
+ * @param comparisons Comparison of each region present in either profile. Must be released with free().
+ * @param comparisonsLen Number of elements in @p comparisons.
+ * @return Number of regressed regions, or -1 on error.
+ */
+int pc_profile_compare(
+	const pc_profile_t *baseline, const pc_profile_t *current, double threshold, double alpha,
+	pc_comparison_t **comparisons, size_t *comparisonsLen
+);
+
+/**
+ * @brief Print the result of pc_profile_compare() as a table.
+ * @param f Output stream.
+ * @param comparisons Comparisons.
+ * @param comparisonsLen Number of elements in @p comparisons.
+ * @param symtab Symbol table used to name the checkpoints. May be NULL.
+ */
+void pc_print_comparison(FILE *f, const pc_comparison_t *comparisons, size_t comparisonsLen, const pc_symtab_t *symtab);
+
+#endif
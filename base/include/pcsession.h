@@ -0,0 +1,206 @@
+#ifndef PCSESSION_H
+#define PCSESSION_H
+
+#include <CL/opencl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "pcdecoder.h"
+#include "pcdrain.h"
+
+/**
+ * @brief Default size of the log buffer, in 64-bit records.
+ */
+#define PC_SESSION_DEFAULT_LOG_LEN 65536
+
+/**
+ * @brief Number of records read at a time by pc_collect(). Reading stops at the first chunk containing an empty record.
+ */
+#define PC_SESSION_READ_CHUNK 4096
+
+/**
+ * @brief Maximum time waited by pc_wait_armed() for the profCounter kernel to start, in microseconds.
+ */
+#define PC_SESSION_ARM_TIMEOUT 1000000
+
+/**
+ * @brief Maximum number of programs and kernels kept by the object cache (see pc_program_load() and pc_kernel_create()).
+ */
+#define PC_SESSION_CACHE_LEN 16
+
+/**
+ * @brief Time spent on host startup (program and kernel creation), accumulated over the whole process.
+ */
+typedef struct {
+	/* Seconds spent mapping binaries, creating programs from them, building programs and creating kernels */
+	double loadTime;
+	double createTime;
+	double buildTime;
+	double kernelTime;
+	/* Total size of the loaded binaries */
+	size_t binarySz;
+	/* Number of programs/kernels created, and of requests served from the cache */
+	unsigned programs;
+	unsigned programHits;
+	unsigned kernels;
+	unsigned kernelHits;
+} pc_startup_t;
+
+/**
+ * @brief A ProfCounter session: the profCounter kernel, its command queue and log buffer, reused across runs.
+ */
+typedef struct {
+	cl_context context;
+	cl_command_queue queue;
+	cl_kernel kernel;
+	/* Log buffer (device) and its number of records */
+	cl_mem logK;
+	size_t logLen;
+	/* Empty log used to clear the log buffer before each run */
+	uint64_t *empty;
+	/* Event of the last profCounter launch */
+	cl_event running;
+	/* Raw log of the last run collected with pc_collect(), and its number of valid records (up to the first empty one) */
+	uint64_t *log;
+	size_t logUsed;
+	/* Number of runs armed so far */
+	unsigned runs;
+	/* Asynchronous drain, if started with pc_session_drain() */
+	bool draining;
+	pc_drain_t drain;
+} pc_session_t;
+
+/**
+ * @brief Load and build a program from a binary file (e.g. program.xclbin). The file is memory-mapped instead of copied to the heap,
+ * and the program is cached: further calls with the same context and file name return the same program.
+ * @param context OpenCL context.
+ * @param device Device the program is built for.
+ * @param fileName Path to the binary file.
+ * @param program Built program. Must be released with clReleaseProgram() (the cache holds its own reference).
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_program_load(cl_context context, cl_device_id device, const char *fileName, cl_program *program);
+
+/**
+ * @brief Create a kernel from a program. Kernels are cached: further calls with the same program and name return the same kernel.
+ * @param program Built program.
+ * @param name Kernel name.
+ * @param kernel Kernel. Must be released with clReleaseKernel() (the cache holds its own reference).
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ * @note Kernel arguments belong to the kernel object, thus a cached kernel must not be used by two sessions at the same time.
+ */
+int pc_kernel_create(cl_program program, const char *name, cl_kernel *kernel);
+
+/**
+ * @brief Release the references held by the program and kernel cache. Must be called before releasing the context.
+ */
+void pc_cache_release(void);
+
+/**
+ * @brief Get the time spent on host startup so far.
+ * @param startup Accumulated startup times.
+ */
+void pc_startup_get(pc_startup_t *startup);
+
+/**
+ * @brief Print the time spent on host startup so far.
+ * @param f Output stream.
+ */
+void pc_print_startup(FILE *f);
+
+/**
+ * @brief Create the profCounter kernel, its command queue and log buffer.
+ * @param session Session to be opened. Must be released with pc_close().
+ * @param context OpenCL context.
+ * @param program Built program containing the profCounter kernel (see pc_program_load()). Its first device is used.
+ * @param logLen Size of the log buffer in 64-bit records, or 0 for PC_SESSION_DEFAULT_LOG_LEN.
+ * @param prescaler Timestamp prescaler (see Synthesis Configuration on README).
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_session_open(pc_session_t *session, cl_context context, cl_program program, size_t logLen, cl_uint prescaler);
+
+/**
+ * @brief Set the log watermark: the profCounter interrupt is raised every time another @p watermark records are written to the log
+ * buffer (see Interrupts on README). Takes effect on the next pc_arm(). Sessions start with the watermark disabled.
+ * @param session Session.
+ * @param watermark Number of records between watermark interrupts, 0 to disable them.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_session_watermark(pc_session_t *session, cl_uint watermark);
+
+/**
+ * @brief Set the sampling interval: if not zero, checkpoints only update the current region and profCounter writes a sample record
+ * every @p interval cycles instead (see Periodic Sampling on README). Takes effect on the next pc_arm(). Sessions start with event
+ * logging (interval 0).
+ * @param session Session.
+ * @param interval ProfCounter cycles between samples, 0 to log every event.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_session_interval(pc_session_t *session, cl_uint interval);
+
+/**
+ * @brief Set the number of COMM_FINISH commands that end an execution. With NDRange DUTs every work-item issues PROFCOUNTER_FINISH(),
+ * thus this must be the global work size (see NDRange Kernels on README). Takes effect on the next pc_arm(). Sessions start with 0,
+ * i.e. the first PROFCOUNTER_FINISH() ends the execution.
+ * @param session Session.
+ * @param finishes Number of PROFCOUNTER_FINISH() calls that end an execution, 0 or 1 for the first one.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_session_finishes(pc_session_t *session, cl_uint finishes);
+
+/**
+ * @brief Start asynchronous collection: after this call, logs are collected with pc_collect_async() and handed to @p consumer by
+ * worker threads (see pcdrain.h).
+ * @param session Session.
+ * @param workersLen Number of worker threads.
+ * @param consumer Function called for every collected log.
+ * @param consumerArg User argument passed to @p consumer.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_session_drain(pc_session_t *session, unsigned workersLen, pc_drain_consumer_t consumer, void *consumerArg);
+
+/**
+ * @brief Clear the log buffer and launch the profCounter kernel. The DUT must only be launched after pc_wait_armed().
+ * @param session Session.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_arm(pc_session_t *session);
+
+/**
+ * @brief Wait until the profCounter kernel is running (or up to PC_SESSION_ARM_TIMEOUT).
+ * @param session Session.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the launch failed.
+ */
+int pc_wait_armed(pc_session_t *session);
+
+/**
+ * @brief Wait for the profCounter kernel to finish (i.e. for the DUT to send the FINISH command), read back the used part of the
+ * log and decode it. The raw log remains available at pc_session_t::log.
+ * @param session Session.
+ * @param trace Decoded trace. Must be released with pc_trace_free().
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_collect(pc_session_t *session, pc_trace_t *trace);
+
+/**
+ * @brief Enqueue the collection of the log once the profCounter kernel finishes, without waiting. Requires pc_session_drain().
+ * @param session Session.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int pc_collect_async(pc_session_t *session);
+
+/**
+ * @brief Wait for all logs enqueued with pc_collect_async() to be consumed.
+ * @param session Session.
+ * @return EXIT_SUCCESS if all logs were consumed without failures, EXIT_FAILURE otherwise.
+ */
+int pc_session_wait(pc_session_t *session);
+
+/**
+ * @brief Release the session (pending asynchronous collections are waited for).
+ * @param session Session to be released.
+ */
+void pc_close(pc_session_t *session);
+
+#endif
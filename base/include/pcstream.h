@@ -0,0 +1,115 @@
+#ifndef PCSTREAM_H
+#define PCSTREAM_H
+
+#include <stdint.h>
+
+/**
+ * @brief Version of the streaming protocol, as sent in the header frame.
+ */
+#define PC_LIVE_VERSION 1
+
+/**
+ * @brief Default path of the Unix domain socket.
+ */
+#define PC_LIVE_DEFAULT_SOCKET "/tmp/profcounter.sock"
+
+/**
+ * @brief Frame types. Every frame is a pc_live_frame_t followed by "length" bytes of payload, all in host byte order (the socket
+ * is local):
+ *
+ * - PC_LIVE_FRAME_HEADER: one pc_live_header_t, sent when a run starts and to consumers connecting during a run;
+ * - PC_LIVE_FRAME_EVENTS: pc_live_event_t array, the events decoded in the last drain period;
+ * - PC_LIVE_FRAME_SAMPLES: pc_live_sample_t array, the samples decoded in the last drain period (sampling mode);
+ * - PC_LIVE_FRAME_REGIONS: pc_live_region_t array, every region seen so far in this run, sent once per drain period (possibly empty);
+ * - PC_LIVE_FRAME_END: one pc_live_end_t, sent when the profCounter kernel finishes and the whole log was decoded.
+ */
+#define PC_LIVE_FRAME_HEADER 1
+#define PC_LIVE_FRAME_EVENTS 2
+#define PC_LIVE_FRAME_SAMPLES 3
+#define PC_LIVE_FRAME_REGIONS 4
+#define PC_LIVE_FRAME_END 5
+
+/**
+ * @brief Header frame flags, as in pc_header_t.
+ */
+#define PC_LIVE_FLAG_DUT_CYCLES 0x1
+#define PC_LIVE_FLAG_CPU 0x2
+#define PC_LIVE_FLAG_NDRANGE 0x4
+
+/**
+ * @brief Frame prefix.
+ */
+typedef struct {
+	uint32_t type;
+	/* Payload size in bytes */
+	uint32_t length;
+} pc_live_frame_t;
+
+/**
+ * @brief Header frame payload.
+ */
+typedef struct {
+	uint32_t version;
+	/* Session run number (pc_session_t::runs) */
+	uint32_t run;
+	uint32_t counterWidth;
+	uint32_t prescaler;
+	uint32_t kernelClockMHz;
+	uint32_t dutClockMHz;
+	uint32_t flags;
+	uint32_t reserved;
+} pc_live_header_t;
+
+/**
+ * @brief Event, as in pc_event_t.
+ */
+typedef struct {
+	uint64_t cycle;
+	/* Checkpoint ID, or UINT32_MAX for stamps */
+	uint32_t id;
+	/* Issuing work-group ID and local ID hash (NDRange logs only) */
+	uint16_t group;
+	uint8_t local;
+	uint8_t reserved;
+} pc_live_event_t;
+
+/**
+ * @brief Sample, as in pc_sample_t.
+ */
+typedef struct {
+	uint64_t cycle;
+	uint16_t hits;
+	uint8_t id;
+	uint8_t seen;
+	uint32_t reserved;
+} pc_live_sample_t;
+
+/**
+ * @brief Statistics of a region (transition between two consecutive checkpoints of the same work-item) in the current run, both
+ * since start and within the last drain period (window).
+ */
+typedef struct {
+	uint32_t from;
+	uint32_t to;
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	double mean;
+	uint64_t windowCount;
+	double windowMean;
+} pc_live_region_t;
+
+/**
+ * @brief End frame payload.
+ */
+typedef struct {
+	uint32_t run;
+	/* 0 if the profCounter kernel completed, 1 if it failed or the log was malformed */
+	uint32_t failed;
+	/* Decoded records, events and samples */
+	uint64_t records;
+	uint64_t events;
+	uint64_t samples;
+} pc_live_end_t;
+
+#endif
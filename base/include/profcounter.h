@@ -1,8 +1,29 @@
 #ifndef PROFCOUNTER_H
 #define PROFCOUNTER_H
 
+#ifdef PROFCOUNTER_CPU
+/**
+ * CPU backend: the kernel is compiled as C (e.g. gcc -x c -DPROFCOUNTER_CPU) and linked with src/pccpu.c. The PROFCOUNTER_* macros
+ * record their commands into the log of the calling work-item, in the same format as ProfCounter (see pccpu.h). The OpenCL C
+ * address space qualifiers are defined away, and the OpenCL/Xilinx pragmas and attributes are ignored.
+ */
+#include <limits.h>
+#include <stdbool.h>
+
+#include "pccpu.h"
+
+#pragma GCC diagnostic ignored "-Wunknown-pragmas"
+#pragma GCC diagnostic ignored "-Wattributes"
+
+#define __kernel
+#define __global
+#define __local
+#define __constant const
+#define __private
+#else
 /* Source-end of AXI4-Stream that goes to profCounter */
 __write_only pipe unsigned p0 __attribute__((xcl_reqd_pipe_depth(16)));
+#endif
 
 /* Command macros */
 #define __PROFCOUNTER_COMM_CHECKPOINT_0__ 0x1
@@ -21,38 +42,138 @@ __write_only pipe unsigned p0 __attribute__((xcl_reqd_pipe_depth(16)));
 #define __PROFCOUNTER_COMM_HOLD__ 0xE
 #define __PROFCOUNTER_COMM_FINISH__ 0xF
 
+/**
+ * Checkpoint command for IDs 0 to 127. The 12 checkpoint commands are repeated in banks, selected by bits [10:4] of the command
+ * (see src/profCounter/commands.vh). IDs 0 to 11 use bank 0, i.e. they are the same as __PROFCOUNTER_COMM_CHECKPOINT_<id>__.
+ */
+#define __PROFCOUNTER_COMM_CHECKPOINT__(id) (((((id) / 12) & 0x7F) << 4) | (((id) % 12) + 1))
+
+/**
+ * NDRange kernels (PROFCOUNTER_NDRANGE defined, with NDRANGE defined in src/profCounter/config.vh): every command carries its issuer
+ * on bits [31:11], the linear work-group ID on bits [23:11] (modulo 8192) and a hash of the linear local ID on bits [31:24] (the local
+ * ID itself for work-groups of up to 256 work-items). The issuer is computed once by PROFCOUNTER_INIT() and travels in the same pipe
+ * word as the command, thus commands of different work-items never mix, whatever their order in the pipe.
+ */
+#define __PROFCOUNTER_GROUP_ID__() (\
+	get_group_id(0) + get_num_groups(0) * (get_group_id(1) + get_num_groups(1) * get_group_id(2))\
+)
+#define __PROFCOUNTER_LOCAL_ID__() (\
+	get_local_id(0) + get_local_size(0) * (get_local_id(1) + get_local_size(1) * get_local_id(2))\
+)
+#define __PROFCOUNTER_ISSUER__() (\
+	((__PROFCOUNTER_GROUP_ID__() & 0x1FFF) << 11) | ((((unsigned) __PROFCOUNTER_LOCAL_ID__() ^ ((unsigned) __PROFCOUNTER_LOCAL_ID__() >> 8)) & 0xFF) << 24)\
+)
+
 /**
  * Placeholder dummy variable. All PROFCOUNTER_* calls apart from PROFCOUNTER_FINISH() makes use of this variable.
  * Just before scheduling/binding, this variable is removed and the operations performed in it are substituted by the actual write_pipe() calls.
  * This avoids, the optimiser of generating a different CFG just because of the presence of pipe.
  */
+#ifdef PROFCOUNTER_CPU
+#define PROFCOUNTER_INIT()
+#elif defined(PROFCOUNTER_NDRANGE)
+#define PROFCOUNTER_INIT() __private volatile unsigned __PROFCOUNTER_COMM_DUMMY_VAR__ = 0xDEADBEEF;\
+	__private const unsigned __PROFCOUNTER_COMM_ISSUER__ = __PROFCOUNTER_ISSUER__();
+#else
 #define PROFCOUNTER_INIT() __private volatile unsigned __PROFCOUNTER_COMM_DUMMY_VAR__ = 0xDEADBEEF;
+#endif
+
+/* Command word as written to the pipe, with the issuer of NDRange kernels */
+#ifdef PROFCOUNTER_NDRANGE
+#define __PROFCOUNTER_COMM__(command) ((command) | __PROFCOUNTER_COMM_ISSUER__)
+#else
+#define __PROFCOUNTER_COMM__(command) (command)
+#endif
+
+#ifdef PROFCOUNTER_SYMTAB
+/**
+ * Symbol table mode: this header is only run through the C preprocessor (see src/profCounter/symtab.sh). Checkpoint macros expand
+ * to markers holding the checkpoint ID, source location and label, which are collected into the kernel symbol table.
+ */
+#define __PROFCOUNTER_SYMBOL__(id, label) __PROFCOUNTER_SYMBOL_BEGIN__ id __FILE__ __LINE__ label __PROFCOUNTER_SYMBOL_END__
 
+#define PROFCOUNTER_HOLD()
+#define PROFCOUNTER_CHECKPOINT_0() __PROFCOUNTER_SYMBOL__(0, "")
+#define PROFCOUNTER_CHECKPOINT_1() __PROFCOUNTER_SYMBOL__(1, "")
+#define PROFCOUNTER_CHECKPOINT_2() __PROFCOUNTER_SYMBOL__(2, "")
+#define PROFCOUNTER_CHECKPOINT_3() __PROFCOUNTER_SYMBOL__(3, "")
+#define PROFCOUNTER_CHECKPOINT_4() __PROFCOUNTER_SYMBOL__(4, "")
+#define PROFCOUNTER_CHECKPOINT_5() __PROFCOUNTER_SYMBOL__(5, "")
+#define PROFCOUNTER_CHECKPOINT_6() __PROFCOUNTER_SYMBOL__(6, "")
+#define PROFCOUNTER_CHECKPOINT_7() __PROFCOUNTER_SYMBOL__(7, "")
+#define PROFCOUNTER_CHECKPOINT_8() __PROFCOUNTER_SYMBOL__(8, "")
+#define PROFCOUNTER_CHECKPOINT_9() __PROFCOUNTER_SYMBOL__(9, "")
+#define PROFCOUNTER_CHECKPOINT_10() __PROFCOUNTER_SYMBOL__(10, "")
+#define PROFCOUNTER_CHECKPOINT_11() __PROFCOUNTER_SYMBOL__(11, "")
+#define PROFCOUNTER_CHECKPOINT(id, label) __PROFCOUNTER_SYMBOL__(id, label)
+#define PROFCOUNTER_STAMP()
+#elif defined(PROFCOUNTER_CPU)
+/* CPU backend, commands are recorded directly (see pccpu.h) */
+#define PROFCOUNTER_HOLD() pc_cpu_command(__PROFCOUNTER_COMM_HOLD__)
+#define PROFCOUNTER_CHECKPOINT_0() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_0__)
+#define PROFCOUNTER_CHECKPOINT_1() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_1__)
+#define PROFCOUNTER_CHECKPOINT_2() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_2__)
+#define PROFCOUNTER_CHECKPOINT_3() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_3__)
+#define PROFCOUNTER_CHECKPOINT_4() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_4__)
+#define PROFCOUNTER_CHECKPOINT_5() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_5__)
+#define PROFCOUNTER_CHECKPOINT_6() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_6__)
+#define PROFCOUNTER_CHECKPOINT_7() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_7__)
+#define PROFCOUNTER_CHECKPOINT_8() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_8__)
+#define PROFCOUNTER_CHECKPOINT_9() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_9__)
+#define PROFCOUNTER_CHECKPOINT_10() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_10__)
+#define PROFCOUNTER_CHECKPOINT_11() pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT_11__)
+#define PROFCOUNTER_CHECKPOINT(id, label) pc_cpu_command(__PROFCOUNTER_COMM_CHECKPOINT__(id))
+#define PROFCOUNTER_STAMP() pc_cpu_command(__PROFCOUNTER_COMM_STAMP__)
+#else
 /* Request profcounter to hold all writes to global memory until PROFCOUNTER_FINISH() is called */
-#define PROFCOUNTER_HOLD() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_HOLD__
+#define PROFCOUNTER_HOLD() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_HOLD__)
 
 /* Issue a checkpoint command, with the ID defined at compile-time */
-#define PROFCOUNTER_CHECKPOINT_0() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_0__
-#define PROFCOUNTER_CHECKPOINT_1() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_1__
-#define PROFCOUNTER_CHECKPOINT_2() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_2__
-#define PROFCOUNTER_CHECKPOINT_3() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_3__
-#define PROFCOUNTER_CHECKPOINT_4() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_4__
-#define PROFCOUNTER_CHECKPOINT_5() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_5__
-#define PROFCOUNTER_CHECKPOINT_6() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_6__
-#define PROFCOUNTER_CHECKPOINT_7() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_7__
-#define PROFCOUNTER_CHECKPOINT_8() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_8__
-#define PROFCOUNTER_CHECKPOINT_9() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_9__
-#define PROFCOUNTER_CHECKPOINT_10() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_10__
-#define PROFCOUNTER_CHECKPOINT_11() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_CHECKPOINT_11__
+#define PROFCOUNTER_CHECKPOINT_0() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_0__)
+#define PROFCOUNTER_CHECKPOINT_1() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_1__)
+#define PROFCOUNTER_CHECKPOINT_2() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_2__)
+#define PROFCOUNTER_CHECKPOINT_3() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_3__)
+#define PROFCOUNTER_CHECKPOINT_4() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_4__)
+#define PROFCOUNTER_CHECKPOINT_5() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_5__)
+#define PROFCOUNTER_CHECKPOINT_6() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_6__)
+#define PROFCOUNTER_CHECKPOINT_7() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_7__)
+#define PROFCOUNTER_CHECKPOINT_8() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_8__)
+#define PROFCOUNTER_CHECKPOINT_9() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_9__)
+#define PROFCOUNTER_CHECKPOINT_10() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_10__)
+#define PROFCOUNTER_CHECKPOINT_11() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT_11__)
+
+/* Issue a checkpoint command with a label. The label is only used in the symbol table, "id" must be an integer literal from 0 to 127 */
+#define PROFCOUNTER_CHECKPOINT(id, label) __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_CHECKPOINT__(id))
 
 /* Issue a stamp command */
-#define PROFCOUNTER_STAMP() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM_STAMP__
+#define PROFCOUNTER_STAMP() __PROFCOUNTER_COMM_DUMMY_VAR__ += __PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_STAMP__)
+#endif
+
+/**
+ * Issue "count" checkpoint commands with ID 0, exactly "spacing" cycles apart, as the reference sequence for pipe timing calibration.
+ * The loop is pipelined, and the nominal distance between consecutive commands is only known if it achieves II=1. The measured
+ * distances are compared against "spacing" on the host, which rejects the calibration if they slip (see pc_calibrate() in pcdecoder.h).
+ */
+#define PROFCOUNTER_CALIBRATE(spacing, count) {\
+	unsigned __PROFCOUNTER_CALIBRATE_PHASE__ = 0;\
+	__attribute__((xcl_pipeline_loop))\
+	for(unsigned __PROFCOUNTER_CALIBRATE_I__ = 0; __PROFCOUNTER_CALIBRATE_I__ < (spacing) * (count); __PROFCOUNTER_CALIBRATE_I__++) {\
+		if(!__PROFCOUNTER_CALIBRATE_PHASE__)\
+			PROFCOUNTER_CHECKPOINT(0, "calibration reference");\
+		__PROFCOUNTER_CALIBRATE_PHASE__ = ((spacing) - 1 == __PROFCOUNTER_CALIBRATE_PHASE__)? 0 : (__PROFCOUNTER_CALIBRATE_PHASE__ + 1);\
+	}\
+}
 
 /**
- * Finish kernel execution and release hold if applicable.
+ * Finish kernel execution and release hold if applicable. With PROFCOUNTER_NDRANGE, every work-item must call it, and profCounter
+ * only finishes on the "finishes"-th call, which the host sets to the global work size (see pc_session_finishes()).
  * This is the only macro that actually calls write_pipe() before optimisation. This is necessary, otherwise the optimiser will optimise away
  * the OpenCL pipe.
  */
-#define PROFCOUNTER_FINISH() write_pipe(p0, &(unsigned){__PROFCOUNTER_COMM_FINISH__})
+#ifdef PROFCOUNTER_CPU
+#define PROFCOUNTER_FINISH() pc_cpu_command(__PROFCOUNTER_COMM_FINISH__)
+#else
+#define PROFCOUNTER_FINISH() write_pipe(p0, &(unsigned){__PROFCOUNTER_COMM__(__PROFCOUNTER_COMM_FINISH__)})
+#endif
 
 #endif
\ No newline at end of file
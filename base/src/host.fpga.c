@@ -29,9 +29,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
-#include <unistd.h>
 
 #include "common.h"
+#include "pcdecoder.h"
+#include "pcsession.h"
 
 /**
  * @brief Standard statements for function error handling and printing.
@@ -66,26 +67,13 @@ int main(int argc, char *argv[]) {
 	cl_platform_id *platforms = NULL;
 	cl_device_id *devices = NULL;
 	cl_context context = NULL;
-	cl_command_queue queueProfCounter = NULL;
 	cl_command_queue queueProbe = NULL;
-	FILE *programFile = NULL;
-	size_t programSz;
-	char *programContent = NULL;
-	cl_int programRet;
 	cl_program program = NULL;
-	cl_kernel kernelProfCounter = NULL;
 	cl_kernel kernelProbe = NULL;
 	bool loopFlag = false;
 	long totalTime;
 	struct timeval tThen, tNow, tDelta, tExecTime;
 	timerclear(&tExecTime);
-	cl_uint workDimProfCounter = 1;
-	size_t globalSizeProfCounter[1] = {
-		1
-	};
-	size_t localSizeProfCounter[1] = {
-		1
-	};
 	cl_uint workDimProbe = 1;
 	size_t globalSizeProbe[1] = {
 		1
@@ -95,11 +83,17 @@ int main(int argc, char *argv[]) {
 	};
 
 	/* Input/output variables */
-	long *log = calloc(65536, sizeof(long));
-	cl_mem logK = NULL;
 	unsigned *timeline = malloc(10 * sizeof(unsigned));
 	cl_mem timelineK = NULL;
 	char mustHold = 0;
+	cl_uint prescaler = 0;
+	cl_uint calibrationSpacing = 0;
+	pc_session_t session = {0};
+	pc_trace_t trace = {0};
+	pc_calibration_t calibration;
+	pc_symtab_t symtab = {0};
+	char symbolName[64];
+	FILE *csvFile = NULL;
 
 	/* Populate timeline */
 	unsigned timelineFixed[10] = {0, 15, 30, 40, 50, 70, 100, 120, 199, 200};
@@ -107,9 +101,18 @@ int main(int argc, char *argv[]) {
 		timeline[i] = timelineFixed[i];
 	i = 0;
 
-	/* Update mustHold variable if command-line argument was provided */
-	if(argc > 1 && !strcmp(argv[1], "hold"))
-		mustHold = 1;
+	/* Update mustHold and prescaler variables if command-line arguments were provided */
+	for(i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "hold"))
+			mustHold = 1;
+		else if(!strncmp(argv[i], "prescaler=", 10))
+			prescaler = strtoul(argv[i] + 10, NULL, 10);
+		else if(!strcmp(argv[i], "calibrate"))
+			calibrationSpacing = 4;
+		else if(!strncmp(argv[i], "calibrate=", 10))
+			calibrationSpacing = strtoul(argv[i] + 10, NULL, 10);
+	}
+	i = 0;
 
 	/* Get platforms IDs */
 	PRINT_STEP("Getting platforms IDs...");
@@ -135,110 +138,73 @@ int main(int argc, char *argv[]) {
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateContext"));
 	PRINT_SUCCESS();
 
-	/* Create command queue for profCounter kernel */
-	PRINT_STEP("Creating command queue for \"profCounter\"...");
-	queueProfCounter = clCreateCommandQueue(context, devices[0], 0, &fRet);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateCommandQueue"));
-	PRINT_SUCCESS();
-
 	/* Create command queue for probe kernel */
 	PRINT_STEP("Creating command queue for \"probe\"...");
 	queueProbe = clCreateCommandQueue(context, devices[0], 0, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateCommandQueue"));
 	PRINT_SUCCESS();
 
-	/* Open binary file */
-	PRINT_STEP("Opening program binary...");
-	programFile = fopen("program.xclbin", "rb");
-	ASSERT_CALL(programFile, POSIX_ERROR_STATEMENTS("program.xclbin"));
-	PRINT_SUCCESS();
-
-	/* Get size and read file */
-	PRINT_STEP("Reading program binary...");
-	fseek(programFile, 0, SEEK_END);
-	programSz = ftell(programFile);
-	fseek(programFile, 0, SEEK_SET);
-	programContent = malloc(programSz);
-	fread(programContent, programSz, 1, programFile);
-	fclose(programFile);
-	programFile = NULL;
-	PRINT_SUCCESS();
-
-	/* Create program from binary file */
-	PRINT_STEP("Creating program from binary...");
-	program = clCreateProgramWithBinary(context, 1, devices, &programSz, (const unsigned char **) &programContent, &programRet, &fRet);
-	ASSERT_CALL(CL_SUCCESS == programRet, FUNCTION_ERROR_STATEMENTS("clCreateProgramWithBinary (when loading binary)"));
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateProgramWithBinary"));
-	PRINT_SUCCESS();
-
-	/* Build program */
-	PRINT_STEP("Building program...");
-	fRet = clBuildProgram(program, 1, devices, NULL, NULL, NULL);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clBuildProgram"));
+	/* Load (memory-mapped) and build program from binary file */
+	PRINT_STEP("Loading program binary...");
+	fRet = pc_program_load(context, devices[0], "program.xclbin", &program);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_program_load"));
 	PRINT_SUCCESS();
 
-	/* Create profCounter kernel */
-	PRINT_STEP("Creating kernel \"profCounter\" from program...");
-	kernelProfCounter = clCreateKernel(program, "profCounter", &fRet);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateKernel"));
+	/* Open ProfCounter session (profCounter kernel, its queue and log buffer) */
+	PRINT_STEP("Opening ProfCounter session...");
+	fRet = pc_session_open(&session, context, program, 0, prescaler);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_session_open"));
 	PRINT_SUCCESS();
 
 	/* Create probe kernel */
 	PRINT_STEP("Creating kernel \"probe\" from program...");
-	kernelProbe = clCreateKernel(program, "probe", &fRet);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateKernel"));
+	fRet = pc_kernel_create(program, "probe", &kernelProbe);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_kernel_create"));
 	PRINT_SUCCESS();
 
+	pc_print_startup(stdout);
+
 	/* Create input and output buffers */
 	PRINT_STEP("Creating buffers...");
-	logK = clCreateBuffer(context, CL_MEM_WRITE_ONLY, 65536 * sizeof(long), NULL, &fRet);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (logK)"));
 	timelineK = clCreateBuffer(context, CL_MEM_READ_ONLY, 10 * sizeof(unsigned), NULL, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (timelineK)"));
 	PRINT_SUCCESS();
 
-	/* Set kernel arguments for profCounter */
-	PRINT_STEP("Setting kernel arguments for \"profCounter\"...");
-	fRet = clSetKernelArg(kernelProfCounter, 0, sizeof(cl_mem), &logK);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clSetKernelArg (logK)"));
-	PRINT_SUCCESS();
-
 	/* Set kernel arguments for probe */
 	PRINT_STEP("Setting kernel arguments for \"probe\"...");
 	fRet = clSetKernelArg(kernelProbe, 0, sizeof(cl_mem), &timelineK);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clSetKernelArg (timelineK)"));
 	fRet = clSetKernelArg(kernelProbe, 1, sizeof(char), &mustHold);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clSetKernelArg (mustHold)"));
+	fRet = clSetKernelArg(kernelProbe, 2, sizeof(cl_uint), &calibrationSpacing);
+	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clSetKernelArg (calibrationSpacing)"));
 	PRINT_SUCCESS();
 
 	do {
 		/* Setting input and output buffers */
 		PRINT_STEP("[%d] Setting buffers...", i);
-		fRet = clEnqueueWriteBuffer(queueProfCounter, logK, CL_TRUE, 0, 65536 * sizeof(long), log, 0, NULL, NULL);
-		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (logK)"));
 		fRet = clEnqueueWriteBuffer(queueProbe, timelineK, CL_TRUE, 0, 10 * sizeof(unsigned), timeline, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (timelineK)"));
 		PRINT_SUCCESS();
 
 		PRINT_STEP("[%d] Running kernels...", i);
-		fRet = clEnqueueNDRangeKernel(queueProfCounter, kernelProfCounter, workDimProfCounter, NULL, globalSizeProfCounter, localSizeProfCounter, 0, NULL, NULL);
-		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueNDRangeKernel"));
-
-		// XXX: wait to settle down
-		sleep(1);
+		fRet = pc_arm(&session);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_arm"));
+		fRet = pc_wait_armed(&session);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_wait_armed"));
 
 		gettimeofday(&tThen, NULL);
 		fRet = clEnqueueNDRangeKernel(queueProbe, kernelProbe, workDimProbe, NULL, globalSizeProbe, localSizeProbe, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueNDRangeKernel"));
 		clFinish(queueProbe);
 		gettimeofday(&tNow, NULL);
-		clFinish(queueProfCounter);
 		PRINT_SUCCESS();
 
-		/* Get output buffers */
+		/* Get output buffers (log is read back and decoded by the session) */
 		PRINT_STEP("[%d] Getting kernels arguments...", i);
-		fRet = clEnqueueReadBuffer(queueProfCounter, logK, CL_TRUE, 0, 65536 * sizeof(long), log, 0, NULL, NULL);
-		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueReadBuffer"));
+		pc_trace_free(&trace);
+		fRet = pc_collect(&session, &trace);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_collect"));
 		PRINT_SUCCESS();
 
 		timersub(&tNow, &tThen, &tDelta);
@@ -250,58 +216,95 @@ int main(int argc, char *argv[]) {
 	totalTime = (1000000 * tExecTime.tv_sec) + tExecTime.tv_usec;
 	printf("Elapsed time spent on kernels: %ld us; Average time per iteration: %lf us.\n", totalTime, totalTime / (double) i);
 
-	printf("Received values (assuming latency of 137 cycles):\n");
-	printf("|    | Absolute values                       || Latency-normalised values             | ID (if      |\n");
-	printf("|  i |       t(i) |  t(i)-t(0) | t(i)-t(i-1) ||       t(i) |  t(i)-t(0) | t(i)-t(i-1) | applicable) |\n");
-	for(i = 0; i < 50; i++) {
-		if(!(log[i]))
-			break;
-
-		unsigned checkpointID = (log[i] >> 60) & 0xF;
-		uint64_t timestamp0 = log[0] & 0xFFFFFFFFFFFFFFF;
-		uint64_t timestampi_1 = i? (log[i-1] & 0xFFFFFFFFFFFFFFF) : 0;
-		uint64_t timestampi = log[i] & 0xFFFFFFFFFFFFFFF;
+	/* Calibration mode: measure pipe timing from the reference sequence and save it for later executions */
+	if(calibrationSpacing) {
+		PRINT_STEP("Calibrating pipe timing...");
+		fRet = pc_calibrate(&trace, calibrationSpacing, &calibration);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_calibrate"));
+		fRet = pc_calibration_save("profcounter.cal", &calibration);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_calibration_save"));
+		PRINT_SUCCESS();
 
 		printf(
-			"| %2d | %10ld | %10ld |  %10ld || %10ld | %10ld |  %10ld |          %2u |\n", i,
-			timestampi, timestampi - timestamp0, i? (timestampi - timestampi_1) : 0,
-			timestampi / 137, (timestampi - timestamp0) / 137, i? ((timestampi - timestampi_1) / 137) : 0,
-			checkpointID
+			"Pipe timing over %zu samples: slip %.2f cycles per transition, jitter %.2f cycles (deviation from %d to %d cycles).\n",
+			calibration.samples, calibration.slip, calibration.jitter, (int) calibration.minDeviation, (int) calibration.maxDeviation
 		);
 	}
+	else {
+		/* Report the pipe timing jitter if a calibration is available */
+		if(EXIT_SUCCESS == pc_calibration_load("profcounter.cal", &calibration))
+			pc_apply_calibration(&trace, &calibration);
+
+		/* Name checkpoints after their source locations if the symbol table is available */
+		pc_symtab_load("probe.pcsym", &symtab);
+
+		printf("Received values (assuming latency of 137 cycles):\n");
+		printf("|    | Absolute values                       || Latency-normalised values             | ID (if      |                      |\n");
+		printf("|  i |       t(i) |  t(i)-t(0) | t(i)-t(i-1) ||       t(i) |  t(i)-t(0) | t(i)-t(i-1) | applicable) | Location             |\n");
+		for(i = 0; i < trace.eventsLen && i < 50; i++) {
+			uint64_t timestamp0 = trace.events[0].cycle;
+			uint64_t timestampi_1 = i? trace.events[i-1].cycle : 0;
+			uint64_t timestampi = trace.events[i].cycle;
+
+			printf(
+				"| %2d | %10ld | %10ld |  %10ld || %10ld | %10ld |  %10ld |", i,
+				timestampi, timestampi - timestamp0, i? (timestampi - timestampi_1) : 0,
+				timestampi / 137, (timestampi - timestamp0) / 137, i? ((timestampi - timestampi_1) / 137) : 0
+			);
+			if(PC_EVENT_CHECKPOINT == trace.events[i].type)
+				printf("          %2u | %-20.20s |\n", trace.events[i].id, pc_symbol_name(&symtab, trace.events[i].id, symbolName, sizeof(symbolName)));
+			else
+				printf("             |                      |\n");
+		}
+
+		/* Writer telemetry, tells whether records were lost and why */
+		pc_print_telemetry(stdout, &trace);
+
+		/* Save raw log for offline analysis (e.g. regression tests with pcregress) */
+		PRINT_STEP("Saving raw log to profcounter.log...");
+		fRet = pc_log_save("profcounter.log", session.log, session.logUsed);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_log_save"));
+		PRINT_SUCCESS();
+
+		/* Export decoded trace */
+		PRINT_STEP("Exporting trace to profcounter.csv...");
+		csvFile = fopen("profcounter.csv", "w");
+		ASSERT_CALL(csvFile, POSIX_ERROR_STATEMENTS("profcounter.csv"));
+		pc_export_csv(csvFile, &trace, &symtab);
+		PRINT_SUCCESS();
+	}
 
 _err:
 
+	/* Close ProfCounter session */
+	pc_close(&session);
+
 	/* Dealloc buffers */
-	if(logK)
-		clReleaseMemObject(logK);
 	if(timelineK)
 		clReleaseMemObject(timelineK);
 
 	/* Dealloc variables */
-	free(log);
+	if(csvFile)
+		fclose(csvFile);
+	pc_symtab_free(&symtab);
+	pc_trace_free(&trace);
 	free(timeline);
 
 	/* Dealloc kernels */
-	if(kernelProfCounter)
-		clReleaseKernel(kernelProfCounter);
 	if(kernelProbe)
 		clReleaseKernel(kernelProbe);
 
 	/* Dealloc program */
 	if(program)
 		clReleaseProgram(program);
-	if(programContent)
-		free(programContent);
-	if(programFile)
-		fclose(programFile);
 
 	/* Dealloc queues */
-	if(queueProfCounter)
-		clReleaseCommandQueue(queueProfCounter);
 	if(queueProbe)
 		clReleaseCommandQueue(queueProbe);
 
+	/* Release cached programs and kernels */
+	pc_cache_release();
+
 	/* Last OpenCL variables */
 	if(context)
 		clReleaseContext(context);
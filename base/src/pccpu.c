@@ -0,0 +1,249 @@
+/**
+ * ProfCounter CPU backend
+ *
+ * Records the commands of the PROFCOUNTER_* macros when a kernel is compiled as C with PROFCOUNTER_CPU defined (see profcounter.h),
+ * e.g. to iterate on the instrumentation without hardware or to compare profiles across targets. Every work-item has its own log,
+ * reached through a thread-local pointer, which is filled with the same records that ProfCounter writes (header, clocks and sync records,
+ * stamps and checkpoints, see src/profCounter/records.vh). The logs are therefore decoded, exported and analysed by the same host code.
+ *
+ * Timestamps come from the time-stamp counter on x86 (rdtsc) and from clock_gettime(CLOCK_MONOTONIC) elsewhere. They include the
+ * overhead of the time source and of the log itself, and PROFCOUNTER_HOLD() has no effect, as logs are kept in host memory.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "common.h"
+#include "pccpu.h"
+#include "pcdecoder.h"
+
+/* Command codes, as in src/profCounter/commands.vh */
+#define PC_CPU_COMM_NOP 0x0
+#define PC_CPU_COMM_STAMP 0xD
+#define PC_CPU_COMM_HOLD 0xE
+#define PC_CPU_COMM_FINISH 0xF
+#define PC_CPU_COMM_CHECKPOINTS_PER_BANK 12
+
+/* Timestamps have the full width of the ProfCounter records */
+#define PC_CPU_COUNTER_WIDTH 56
+#define PC_CPU_COUNTER_MASK ((1ull << PC_CPU_COUNTER_WIDTH) - 1)
+
+/* Work-item being run by the calling thread, and its backend (NULL outside pc_cpu_run()) */
+static __thread pc_cpu_item_t *currentItem = NULL;
+static __thread const pc_cpu_t *currentCpu = NULL;
+static __thread unsigned currentId = 0;
+
+static uint64_t pc_cpu_monotonic(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static uint64_t pc_cpu_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return pc_cpu_monotonic();
+#endif
+}
+
+static void pc_cpu_append(pc_cpu_item_t *item, uint64_t record) {
+	if(item->logLen == item->logCapacity) {
+		uint64_t *log = realloc(item->log, 2 * item->logCapacity * sizeof(uint64_t));
+
+		if(!log) {
+			item->truncated = true;
+			return;
+		}
+		item->log = log;
+		item->logCapacity *= 2;
+	}
+
+	item->log[(item->logLen)++] = record;
+}
+
+/* Start the log of a work-item as profCounter does on start: header, clocks and sync records. Timestamps count from here */
+static void pc_cpu_begin(const pc_cpu_t *cpu, pc_cpu_item_t *item) {
+	item->logLen = 0;
+	item->truncated = false;
+	pc_cpu_append(
+		item, ((uint64_t) PC_REC_HEADER << 56) | ((uint64_t) PC_LOG_VERSION << 48) | ((uint64_t) PC_CPU_COUNTER_WIDTH << 40) |
+		((uint64_t) cpu->prescaler << 32) | PC_LOG_MAGIC
+	);
+	/* Bit 33 flags timestamps from the CPU backend, both clocks are the time source */
+	pc_cpu_append(item, ((uint64_t) PC_REC_CLOCKS << 56) | (1ull << 33) | ((uint64_t) cpu->clockMHz << 16) | cpu->clockMHz);
+	/* The time source is shared by all work-items, so that their logs can be merged (see pcmerge) */
+	item->origin = pc_cpu_now();
+	pc_cpu_append(item, ((uint64_t) PC_REC_SYNC << 56) | (item->origin & PC_CPU_COUNTER_MASK));
+}
+
+static void pc_cpu_run_item(pc_cpu_t *cpu, unsigned id) {
+	pc_cpu_begin(cpu, &(cpu->items[id]));
+
+	currentCpu = cpu;
+	currentItem = &(cpu->items[id]);
+	currentId = id;
+	cpu->body(id, cpu->bodyArg);
+	currentItem = NULL;
+	currentCpu = NULL;
+	currentId = 0;
+}
+
+static void *pc_cpu_worker(void *arg) {
+	pc_cpu_t *cpu = (pc_cpu_t *) arg;
+
+	while(true) {
+		unsigned id;
+
+		pthread_mutex_lock(&(cpu->mutex));
+		id = (cpu->next)++;
+		pthread_mutex_unlock(&(cpu->mutex));
+
+		if(id >= cpu->itemsLen)
+			break;
+		pc_cpu_run_item(cpu, id);
+	}
+
+	return NULL;
+}
+
+int pc_cpu_open(pc_cpu_t *cpu, unsigned itemsLen, unsigned prescaler) {
+	int rv = EXIT_SUCCESS;
+
+	memset(cpu, 0, sizeof(pc_cpu_t));
+	ASSERT_CALL(itemsLen, fprintf(stderr, "Error: at least one work-item is needed.\n"); rv = EXIT_FAILURE);
+	ASSERT_CALL(prescaler < 32, fprintf(stderr, "Error: invalid prescaler %u.\n", prescaler); rv = EXIT_FAILURE);
+	cpu->items = calloc(itemsLen, sizeof(pc_cpu_item_t));
+	ASSERT_CALL(cpu->items, fprintf(stderr, "Error: could not allocate memory for %u work-items.\n", itemsLen); rv = EXIT_FAILURE);
+	cpu->itemsLen = itemsLen;
+	cpu->prescaler = prescaler;
+	pthread_mutex_init(&(cpu->mutex), NULL);
+
+#if defined(__x86_64__) || defined(__i386__)
+	{
+		/* Measure the time-stamp counter frequency (the counter is invariant on any recent x86) */
+		struct timespec interval = {0, 20000000};
+		uint64_t timeThen = pc_cpu_monotonic();
+		uint64_t countThen = pc_cpu_now();
+		uint64_t elapsed;
+
+		nanosleep(&interval, NULL);
+		elapsed = pc_cpu_monotonic() - timeThen;
+		cpu->clockMHz = ((pc_cpu_now() - countThen) * 1000 + elapsed / 2) / elapsed;
+	}
+#else
+	cpu->clockMHz = 1000;
+#endif
+
+_err:
+	if(EXIT_FAILURE == rv)
+		memset(cpu, 0, sizeof(pc_cpu_t));
+
+	return rv;
+}
+
+int pc_cpu_run(pc_cpu_t *cpu, unsigned threadsLen, void (*body)(unsigned, void *), void *bodyArg) {
+	int rv = EXIT_SUCCESS;
+	unsigned i;
+	unsigned threadsCreated;
+	pthread_t *threads = NULL;
+
+	for(i = 0; i < cpu->itemsLen; i++) {
+		if(!(cpu->items[i].log)) {
+			cpu->items[i].log = malloc(PC_CPU_LOG_INITIAL_LEN * sizeof(uint64_t));
+			ASSERT_CALL(cpu->items[i].log, fprintf(stderr, "Error: could not allocate memory for work-item logs.\n"); rv = EXIT_FAILURE);
+			cpu->items[i].logCapacity = PC_CPU_LOG_INITIAL_LEN;
+		}
+		cpu->items[i].logLen = 0;
+	}
+
+	cpu->body = body;
+	cpu->bodyArg = bodyArg;
+	cpu->next = 0;
+
+	if(!threadsLen) {
+		for(i = 0; i < cpu->itemsLen; i++)
+			pc_cpu_run_item(cpu, i);
+	}
+	else {
+		threads = malloc(threadsLen * sizeof(pthread_t));
+		ASSERT_CALL(threads, fprintf(stderr, "Error: could not allocate memory for threads.\n"); rv = EXIT_FAILURE);
+
+		/* If a thread cannot be created, the work-items are shared by the threads already created */
+		for(threadsCreated = 0; threadsCreated < threadsLen; threadsCreated++) {
+			if(pthread_create(&(threads[threadsCreated]), NULL, pc_cpu_worker, cpu))
+				break;
+		}
+		ASSERT_CALL(threadsCreated, fprintf(stderr, "Error: could not create work-item threads.\n"); rv = EXIT_FAILURE);
+
+		for(i = 0; i < threadsCreated; i++)
+			pthread_join(threads[i], NULL);
+	}
+
+	for(i = 0; i < cpu->itemsLen; i++) {
+		if(cpu->items[i].truncated)
+			fprintf(stderr, "Warning: log of work-item %u could not grow, records were dropped.\n", i);
+	}
+
+_err:
+	if(threads)
+		free(threads);
+
+	return rv;
+}
+
+const uint64_t *pc_cpu_log(const pc_cpu_t *cpu, unsigned item, size_t *logLen) {
+	*logLen = cpu->items[item].logLen;
+
+	return cpu->items[item].log;
+}
+
+void pc_cpu_close(pc_cpu_t *cpu) {
+	unsigned i;
+
+	if(cpu->items) {
+		for(i = 0; i < cpu->itemsLen; i++) {
+			if(cpu->items[i].log)
+				free(cpu->items[i].log);
+		}
+		free(cpu->items);
+		pthread_mutex_destroy(&(cpu->mutex));
+	}
+
+	memset(cpu, 0, sizeof(pc_cpu_t));
+}
+
+void pc_cpu_command(unsigned command) {
+	uint64_t timestamp;
+	unsigned id;
+
+	if(!currentItem)
+		return;
+
+	timestamp = ((pc_cpu_now() - currentItem->origin) >> currentCpu->prescaler) & PC_CPU_COUNTER_MASK;
+
+	switch(command & 0xF) {
+		/* No record, and logs are never written to global memory on the CPU */
+		case PC_CPU_COMM_NOP:
+		case PC_CPU_COMM_HOLD:
+		case PC_CPU_COMM_FINISH:
+			break;
+		case PC_CPU_COMM_STAMP:
+			pc_cpu_append(currentItem, ((uint64_t) PC_REC_STAMP << 56) | timestamp);
+			break;
+		default:
+			id = ((command >> 4) & 0x7F) * PC_CPU_COMM_CHECKPOINTS_PER_BANK + (command & 0xF) - 1;
+			pc_cpu_append(currentItem, ((uint64_t) (PC_REC_CHECKPOINT | (id & 0x7F)) << 56) | timestamp);
+			break;
+	}
+}
+
+size_t get_global_id(unsigned dim) {
+	return dim? 0 : currentId;
+}
@@ -0,0 +1,341 @@
+/**
+ * ProfCounter critical path and what-if analysis
+ *
+ * The checkpoints of a work-item form a chain of regions, each depending on the previous one. A trace holds one such lane, or one
+ * per work-item for NDRange DUTs (see pc_header_t::ndrange), which starts when the work-item issues its first checkpoint. The
+ * end-to-end cycles of the trace are given by the lane that finishes last: its dispatch delay and its regions are the critical path.
+ *
+ * What-if projections follow Amdahl's law per occurrence: making a region X times faster shortens every occurrence of it (e.g. once
+ * per iteration of a loop) by (1 - 1/X) of its cycles, in every lane, with dispatch delays unchanged. The projected end-to-end
+ * cycles are those of the lane that then finishes last, thus the critical path may move to another lane and the gain of a region
+ * that is only critical in one lane is limited accordingly. Regions are ranked by their projection for a given speedup, along
+ * with the bound for a region taking no time at all.
+ *
+ * Lanes are assumed to be independent: work-items waiting for each other (e.g. barriers) or competing for the same pipeline are not
+ * modelled, so projections are optimistic for these. Lanes are told apart by the issuer recorded in the log, whose local ID hash
+ * only identifies a work-item in work-groups of up to 256 work-items.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "pccritical.h"
+
+/* Number of checkpoint IDs, regions are indexed by from * PC_CRITICAL_IDS + to */
+#define PC_CRITICAL_IDS 128
+/* Maximum number of regions reported by pc_print_critical() */
+#define PC_CRITICAL_MAX_TARGETS 10
+
+/* A checkpoint and its issuer, to sort checkpoints per lane */
+typedef struct {
+	uint32_t issuer;
+	size_t event;
+} pc_critical_entry_t;
+
+static int pc_critical_compare_entries(const void *a, const void *b) {
+	const pc_critical_entry_t *entryA = (const pc_critical_entry_t *) a;
+	const pc_critical_entry_t *entryB = (const pc_critical_entry_t *) b;
+
+	if(entryA->issuer != entryB->issuer)
+		return (entryA->issuer > entryB->issuer) - (entryA->issuer < entryB->issuer);
+	return (entryA->event > entryB->event) - (entryA->event < entryB->event);
+}
+
+/* Most promising first, then most cycles on the critical path */
+static int pc_critical_compare_targets(const void *a, const void *b) {
+	const pc_target_t *targetA = (const pc_target_t *) a;
+	const pc_target_t *targetB = (const pc_target_t *) b;
+
+	if(targetA->projected != targetB->projected)
+		return (targetA->projected > targetB->projected) - (targetA->projected < targetB->projected);
+	if(targetA->criticalCycles != targetB->criticalCycles)
+		return (targetA->criticalCycles < targetB->criticalCycles) - (targetA->criticalCycles > targetB->criticalCycles);
+	return (targetA->from * PC_CRITICAL_IDS + targetA->to > targetB->from * PC_CRITICAL_IDS + targetB->to) -
+		(targetA->from * PC_CRITICAL_IDS + targetA->to < targetB->from * PC_CRITICAL_IDS + targetB->to);
+}
+
+/* Checkpoints of the trace grouped per issuer, in chronological order within each issuer */
+static int pc_critical_sort(const pc_trace_t *trace, pc_critical_entry_t **entries, size_t *entriesLen) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+
+	*entriesLen = 0;
+	*entries = malloc((trace->eventsLen? trace->eventsLen : 1) * sizeof(pc_critical_entry_t));
+	ASSERT_CALL(*entries, fprintf(stderr, "Error: could not allocate memory for critical path analysis.\n"); rv = EXIT_FAILURE);
+
+	for(i = 0; i < trace->eventsLen; i++) {
+		if(PC_EVENT_CHECKPOINT != trace->events[i].type)
+			continue;
+
+		(*entries)[*entriesLen].issuer = (trace->events[i].group << 8) | trace->events[i].local;
+		(*entries)[*entriesLen].event = i;
+		(*entriesLen)++;
+	}
+	qsort(*entries, *entriesLen, sizeof(pc_critical_entry_t), pc_critical_compare_entries);
+
+_err:
+	return rv;
+}
+
+/**
+ * Project the end-to-end cycles for every region of regionIndex (0 if not a target, index + 1 otherwise) made "speedup" times
+ * faster, and made infinitely faster (bound). Each lane ends "saved" cycles earlier, and the projection is the latest lane end.
+ */
+static int pc_critical_scan(
+	const pc_trace_t *trace, const pc_critical_entry_t *entries, size_t entriesLen, uint64_t origin, const uint32_t *regionIndex,
+	size_t targetsLen, double speedup, double *projected, double *bound
+) {
+	int rv = EXIT_SUCCESS;
+	size_t i, j;
+	size_t first = 0;
+	double *saved = calloc(targetsLen, sizeof(double));
+	double *removed = calloc(targetsLen, sizeof(double));
+
+	ASSERT_CALL(saved && removed, fprintf(stderr, "Error: could not allocate memory for critical path analysis.\n"); rv = EXIT_FAILURE);
+	for(j = 0; j < targetsLen; j++) {
+		projected[j] = 0;
+		bound[j] = 0;
+	}
+
+	for(i = 1; i <= entriesLen; i++) {
+		const pc_event_t *event;
+		uint64_t end;
+
+		/* Lane continues, accumulate its last region */
+		if(i < entriesLen && entries[i].issuer == entries[first].issuer) {
+			const pc_event_t *previous = &(trace->events[entries[i - 1].event]);
+			uint32_t index;
+
+			event = &(trace->events[entries[i].event]);
+			index = regionIndex[previous->id * PC_CRITICAL_IDS + event->id];
+			if(index) {
+				saved[index - 1] += (event->cycle - previous->cycle) * (1 - 1 / speedup);
+				removed[index - 1] += event->cycle - previous->cycle;
+			}
+			continue;
+		}
+
+		/* Lane ended, it is projected for every target */
+		end = trace->events[entries[i - 1].event].cycle - origin;
+		for(j = 0; j < targetsLen; j++) {
+			if(end - saved[j] > projected[j])
+				projected[j] = end - saved[j];
+			if(end - removed[j] > bound[j])
+				bound[j] = end - removed[j];
+			saved[j] = 0;
+			removed[j] = 0;
+		}
+		first = i;
+	}
+
+_err:
+	if(saved)
+		free(saved);
+	if(removed)
+		free(removed);
+
+	return rv;
+}
+
+int pc_critical_analyse(const pc_trace_t *trace, double speedup, pc_critical_t *critical) {
+	int rv = EXIT_SUCCESS;
+	size_t i, j;
+	pc_critical_entry_t *entries = NULL;
+	size_t entriesLen;
+	pc_lane_t *lane = NULL;
+	uint32_t *regionIndex = NULL;
+	double *projected = NULL;
+	double *bound = NULL;
+
+	memset(critical, 0, sizeof(pc_critical_t));
+	critical->speedup = speedup;
+	ASSERT_CALL(speedup > 0, fprintf(stderr, "Error: invalid speedup %g.\n", speedup); rv = EXIT_FAILURE);
+
+	ASSERT_CALL(EXIT_SUCCESS == pc_critical_sort(trace, &entries, &entriesLen), rv = EXIT_FAILURE);
+	ASSERT_CALL(entriesLen, fprintf(stderr, "Error: no checkpoint found.\n"); rv = EXIT_FAILURE);
+
+	/* The timeline starts at the first checkpoint of any lane */
+	critical->origin = trace->events[entries[0].event].cycle;
+	for(i = 1; i < entriesLen; i++) {
+		if(trace->events[entries[i].event].cycle < critical->origin)
+			critical->origin = trace->events[entries[i].event].cycle;
+	}
+
+	/* Lanes and regions */
+	critical->lanes = malloc(entriesLen * sizeof(pc_lane_t));
+	critical->targets = malloc(((entriesLen < PC_CRITICAL_IDS * PC_CRITICAL_IDS)? entriesLen : (PC_CRITICAL_IDS * PC_CRITICAL_IDS)) * sizeof(pc_target_t));
+	regionIndex = calloc(PC_CRITICAL_IDS * PC_CRITICAL_IDS, sizeof(uint32_t));
+	ASSERT_CALL(
+		critical->lanes && critical->targets && regionIndex,
+		fprintf(stderr, "Error: could not allocate memory for critical path analysis.\n"); rv = EXIT_FAILURE
+	);
+	for(i = 0; i < entriesLen; i++) {
+		const pc_event_t *event = &(trace->events[entries[i].event]);
+
+		if(!i || entries[i].issuer != entries[i - 1].issuer) {
+			lane = &(critical->lanes[(critical->lanesLen)++]);
+			lane->group = event->group;
+			lane->local = event->local;
+			lane->checkpointsLen = 0;
+			lane->start = event->cycle - critical->origin;
+		}
+		else {
+			const pc_event_t *previous = &(trace->events[entries[i - 1].event]);
+			uint32_t *index = &(regionIndex[previous->id * PC_CRITICAL_IDS + event->id]);
+			pc_target_t *target;
+
+			if(!(*index)) {
+				target = &(critical->targets[(critical->targetsLen)++]);
+				memset(target, 0, sizeof(pc_target_t));
+				target->from = previous->id;
+				target->to = event->id;
+				*index = critical->targetsLen;
+			}
+			target = &(critical->targets[*index - 1]);
+			(target->count)++;
+			target->cycles += event->cycle - previous->cycle;
+		}
+
+		(lane->checkpointsLen)++;
+		lane->end = event->cycle - critical->origin;
+	}
+	ASSERT_CALL(critical->targetsLen, fprintf(stderr, "Error: no region found (a work-item must issue two checkpoints at least).\n"); rv = EXIT_FAILURE);
+
+	/* Critical path: the regions of the lane that finishes last, whose checkpoints follow those of the previous lanes */
+	for(i = 1; i < critical->lanesLen; i++) {
+		if(critical->lanes[i].end > critical->lanes[critical->critical].end)
+			critical->critical = i;
+	}
+	for(i = 0, j = 0; i < critical->critical; i++)
+		j += critical->lanes[i].checkpointsLen;
+	critical->total = critical->lanes[critical->critical].end;
+	for(i = j + 1; i < j + critical->lanes[critical->critical].checkpointsLen; i++) {
+		const pc_event_t *previous = &(trace->events[entries[i - 1].event]);
+		const pc_event_t *event = &(trace->events[entries[i].event]);
+		pc_target_t *target = &(critical->targets[regionIndex[previous->id * PC_CRITICAL_IDS + event->id] - 1]);
+
+		(target->criticalCount)++;
+		target->criticalCycles += event->cycle - previous->cycle;
+	}
+
+	/* What-if projections */
+	projected = malloc(critical->targetsLen * sizeof(double));
+	bound = malloc(critical->targetsLen * sizeof(double));
+	ASSERT_CALL(projected && bound, fprintf(stderr, "Error: could not allocate memory for critical path analysis.\n"); rv = EXIT_FAILURE);
+	ASSERT_CALL(
+		EXIT_SUCCESS == pc_critical_scan(trace, entries, entriesLen, critical->origin, regionIndex, critical->targetsLen, speedup, projected, bound),
+		rv = EXIT_FAILURE
+	);
+	for(i = 0; i < critical->targetsLen; i++) {
+		critical->targets[i].projected = projected[i] + 0.5;
+		critical->targets[i].bound = bound[i] + 0.5;
+	}
+	qsort(critical->targets, critical->targetsLen, sizeof(pc_target_t), pc_critical_compare_targets);
+
+_err:
+	if(entries)
+		free(entries);
+	if(regionIndex)
+		free(regionIndex);
+	if(projected)
+		free(projected);
+	if(bound)
+		free(bound);
+	if(EXIT_FAILURE == rv)
+		pc_critical_free(critical);
+
+	return rv;
+}
+
+int pc_critical_project(const pc_trace_t *trace, unsigned from, unsigned to, double speedup, uint64_t *projected) {
+	int rv = EXIT_SUCCESS;
+	pc_critical_entry_t *entries = NULL;
+	size_t entriesLen;
+	uint32_t *regionIndex = NULL;
+	uint64_t origin;
+	double regionProjected;
+	double regionBound;
+	size_t i;
+
+	ASSERT_CALL(speedup > 0, fprintf(stderr, "Error: invalid speedup %g.\n", speedup); rv = EXIT_FAILURE);
+	ASSERT_CALL(from < PC_CRITICAL_IDS && to < PC_CRITICAL_IDS, fprintf(stderr, "Error: invalid region %u -> %u.\n", from, to); rv = EXIT_FAILURE);
+
+	ASSERT_CALL(EXIT_SUCCESS == pc_critical_sort(trace, &entries, &entriesLen), rv = EXIT_FAILURE);
+	ASSERT_CALL(entriesLen, fprintf(stderr, "Error: no checkpoint found.\n"); rv = EXIT_FAILURE);
+	origin = trace->events[entries[0].event].cycle;
+	for(i = 1; i < entriesLen; i++) {
+		if(trace->events[entries[i].event].cycle < origin)
+			origin = trace->events[entries[i].event].cycle;
+	}
+
+	/* A single target */
+	regionIndex = calloc(PC_CRITICAL_IDS * PC_CRITICAL_IDS, sizeof(uint32_t));
+	ASSERT_CALL(regionIndex, fprintf(stderr, "Error: could not allocate memory for critical path analysis.\n"); rv = EXIT_FAILURE);
+	regionIndex[from * PC_CRITICAL_IDS + to] = 1;
+	ASSERT_CALL(
+		EXIT_SUCCESS == pc_critical_scan(trace, entries, entriesLen, origin, regionIndex, 1, speedup, &regionProjected, &regionBound),
+		rv = EXIT_FAILURE
+	);
+	*projected = regionProjected + 0.5;
+
+_err:
+	if(entries)
+		free(entries);
+	if(regionIndex)
+		free(regionIndex);
+
+	return rv;
+}
+
+void pc_critical_free(pc_critical_t *critical) {
+	if(critical->lanes)
+		free(critical->lanes);
+	if(critical->targets)
+		free(critical->targets);
+	memset(critical, 0, sizeof(pc_critical_t));
+}
+
+void pc_print_critical(FILE *f, const pc_critical_t *critical, bool ndrange, const pc_symtab_t *symtab) {
+	size_t i;
+	char fromName[64];
+	char toName[64];
+	char region[136];
+	char limit[16];
+	const pc_lane_t *lane = &(critical->lanes[critical->critical]);
+
+	fprintf(f, "Critical path analysis (%zu regions, what-if speedup %.2fx):\n", critical->targetsLen, critical->speedup);
+	if(ndrange) {
+		fprintf(
+			f, "End-to-end: %" PRIu64 " cycles. Critical path: work-item %u.%u (of %zu), starting at cycle %" PRIu64 ", %zu checkpoints\n",
+			critical->total, lane->group, lane->local, critical->lanesLen, lane->start, lane->checkpointsLen
+		);
+	}
+	else {
+		fprintf(f, "End-to-end: %" PRIu64 " cycles. Critical path: %zu checkpoints\n", critical->total, lane->checkpointsLen);
+	}
+
+	fprintf(
+		f, "| %-40.40s | %7s | %12s | %6s | %12s | %7s | %7s |\n", "Region", "On path", "Path cycles", "Share", "Projected", "Gain",
+		"Limit"
+	);
+	for(i = 0; i < critical->targetsLen && i < PC_CRITICAL_MAX_TARGETS; i++) {
+		const pc_target_t *target = &(critical->targets[i]);
+
+		snprintf(
+			region, sizeof(region), "%s -> %s", pc_symbol_name(symtab, target->from, fromName, sizeof(fromName)),
+			pc_symbol_name(symtab, target->to, toName, sizeof(toName))
+		);
+		/* No limit if nothing else is left once the region takes no time */
+		if(target->bound)
+			snprintf(limit, sizeof(limit), "%6.2fx", (double) critical->total / target->bound);
+		else
+			snprintf(limit, sizeof(limit), "%7s", "inf");
+		fprintf(
+			f, "| %-40.40s | %7zu | %12" PRIu64 " | %5.1f%% | %12" PRIu64 " | %6.2fx | %7s |\n", region, target->criticalCount,
+			target->criticalCycles, critical->total? (100.0 * target->criticalCycles / critical->total) : 0, target->projected,
+			target->projected? ((double) critical->total / target->projected) : 1, limit
+		);
+	}
+}
@@ -0,0 +1,951 @@
+/**
+ * ProfCounter host-side trace decoder
+ *
+ * Converts the raw records written by ProfCounter (see src/profCounter/records.vh) into a list of events with absolute cycle
+ * counts. Counter wrap-around (when COUNTER_WIDTH is narrow) and the prescaler are compensated using the log header. The telemetry
+ * trailer written by SequentialWriter on COMM_FINISH is decoded separately into pc_trace_t::telemetry. Repeat records written by
+ * RunCompressor are expanded back into one event per repeated record, and traffic records written by AxiMonitor are attached to the
+ * checkpoint they follow. Sample records of sampled executions are decoded into pc_trace_t::samples. Events of NDRange logs carry
+ * their issuing work-group and local ID hash, and are split per issuer with pc_trace_split(). Logs can also be decoded record by
+ * record with the incremental decoder (pc_stream_*), on which pc_decode() is built.
+ *
+ * The timing jitter of the command transport (DUT write_pipe() -> pipe p0 -> CommandUnit) is characterised with pc_calibrate() over
+ * the PROFCOUNTER_CALIBRATE() reference sequence, and reported with decoded traces after pc_apply_calibration().
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "pcdecoder.h"
+
+static void pc_traffic_set(pc_traffic_t *traffic, unsigned field, uint64_t readValue, uint64_t writeValue) {
+	switch(field) {
+		case PC_TRAFFIC_BYTES:
+			traffic->readBytes = readValue;
+			traffic->writeBytes = writeValue;
+			break;
+		case PC_TRAFFIC_BEATS:
+			traffic->readBeats = readValue;
+			traffic->writeBeats = writeValue;
+			break;
+		case PC_TRAFFIC_BUSY:
+			traffic->readBusy = readValue;
+			traffic->writeBusy = writeValue;
+			break;
+	}
+}
+
+static void pc_telemetry_set(pc_telemetry_t *telemetry, unsigned field, uint64_t value) {
+	telemetry->present = true;
+
+	switch(field) {
+		case PC_TEL_FIFO_HIGH_WATER:
+			telemetry->fifoHighWater = value;
+			break;
+		case PC_TEL_FIFO_DEPTH:
+			telemetry->fifoDepth = value;
+			break;
+		case PC_TEL_DROPPED:
+			telemetry->dropped = value;
+			break;
+		case PC_TEL_RECEIVED:
+			telemetry->received = value;
+			break;
+		case PC_TEL_WRITES:
+			telemetry->writes = value;
+			break;
+		case PC_TEL_AW_BLOCKED:
+			telemetry->awBlocked = value;
+			break;
+		case PC_TEL_W_BLOCKED:
+			telemetry->wBlocked = value;
+			break;
+		case PC_TEL_B_BLOCKED:
+			telemetry->bBlocked = value;
+			break;
+		default:
+			telemetry->latency[field - PC_TEL_LATENCY_HISTOGRAM] = value;
+			break;
+	}
+}
+
+void pc_stream_init(pc_stream_t *stream) {
+	memset(stream, 0, sizeof(pc_stream_t));
+}
+
+int pc_stream_record(pc_stream_t *stream, uint64_t record) {
+	int rv = EXIT_SUCCESS;
+	pc_header_t *header = &(stream->header);
+	unsigned tag = PC_RECORD_TAG(record);
+
+	stream->record = record;
+	stream->pending = 0;
+	stream->samplePending = false;
+
+	/* First record must be the header */
+	if(!(stream->started)) {
+		ASSERT_CALL(PC_REC_HEADER == tag, fprintf(stderr, "Error: log header not found.\n"); rv = EXIT_FAILURE);
+		ASSERT_CALL(PC_LOG_MAGIC == (record & 0xFFFFFFFF), fprintf(stderr, "Error: invalid log magic number.\n"); rv = EXIT_FAILURE);
+		header->version = (record >> 48) & 0xFF;
+		header->counterWidth = (record >> 40) & 0xFF;
+		header->prescaler = (record >> 32) & 0x1F;
+		header->ndrange = (record >> 37) & 0x1;
+		ASSERT_CALL(PC_LOG_VERSION == header->version, fprintf(stderr, "Error: unsupported log format version %u.\n", header->version); rv = EXIT_FAILURE);
+		ASSERT_CALL(
+			header->counterWidth && header->counterWidth <= 56,
+			fprintf(stderr, "Error: invalid counter width %u.\n", header->counterWidth); rv = EXIT_FAILURE
+		);
+		ASSERT_CALL(
+			!(header->ndrange) || header->counterWidth <= PC_NDRANGE_COUNTER_WIDTH,
+			fprintf(stderr, "Error: invalid counter width %u for an NDRange log.\n", header->counterWidth); rv = EXIT_FAILURE
+		);
+		stream->counterMask = (1ull << header->counterWidth) - 1;
+		stream->sampleMask = (header->counterWidth < PC_SAMPLE_TIMESTAMP_WIDTH)? stream->counterMask : ((1ull << PC_SAMPLE_TIMESTAMP_WIDTH) - 1);
+		stream->started = true;
+		goto _err;
+	}
+
+	switch(tag) {
+		/* Clock frequencies, following the header */
+		case PC_REC_CLOCKS:
+			header->dutCycles = (record >> 32) & 0x1;
+			header->cpu = (record >> 33) & 0x1;
+			header->kernelClockMHz = (record >> 16) & 0xFFFF;
+			header->dutClockMHz = record & 0xFFFF;
+			break;
+		/* Cycles since reset at start, following the clocks record */
+		case PC_REC_SYNC:
+			header->synced = true;
+			header->syncCycle = PC_RECORD_PAYLOAD(record);
+			break;
+		/* Periodic sample, which is not an event */
+		case PC_REC_SAMPLE:
+			stream->samplePending = true;
+			break;
+		/* Repeat record, "count" events of the repeated tag spaced by "delta" counts, starting from the previous event */
+		case PC_REC_REPEAT:
+			stream->tag = PC_REPEAT_TAG(record);
+			stream->pending = PC_REPEAT_COUNT(record);
+			stream->delta = PC_REPEAT_DELTA(record);
+			stream->repeated = true;
+			break;
+		default:
+			stream->tag = tag;
+			stream->pending = 1;
+			stream->repeated = false;
+			break;
+	}
+
+	/* Only stamps and checkpoints are events, skip unknown records */
+	if(PC_REC_STAMP != stream->tag && !(stream->tag & PC_REC_CHECKPOINT))
+		stream->pending = 0;
+
+_err:
+	return rv;
+}
+
+pc_stream_item_t pc_stream_next(pc_stream_t *stream, pc_event_t *event, pc_sample_t *sample) {
+	uint64_t timestamp;
+
+	if(stream->samplePending) {
+		/* Samples have their own timestamp width, thus their own wrap-around */
+		timestamp = PC_SAMPLE_TIMESTAMP(stream->record) & stream->sampleMask;
+		if(timestamp < stream->samplePrevious)
+			stream->sampleEpoch += stream->sampleMask + 1;
+		stream->samplePrevious = timestamp;
+
+		sample->cycle = (stream->sampleEpoch + timestamp) << stream->header.prescaler;
+		sample->id = PC_SAMPLE_ID(stream->record);
+		sample->seen = PC_SAMPLE_SEEN(stream->record);
+		sample->hits = PC_SAMPLE_HITS(stream->record);
+		stream->samplePending = false;
+
+		return PC_STREAM_SAMPLE;
+	}
+
+	if(!(stream->pending))
+		return PC_STREAM_NONE;
+
+	memset(&(event->traffic), 0, sizeof(pc_traffic_t));
+	event->group = stream->header.ndrange? PC_EVENT_GROUP(stream->record) : 0;
+	event->local = stream->header.ndrange? PC_EVENT_LOCAL(stream->record) : 0;
+	if(PC_REC_STAMP == stream->tag) {
+		event->type = PC_EVENT_STAMP;
+		event->id = 0;
+	}
+	else {
+		event->type = PC_EVENT_CHECKPOINT;
+		event->id = stream->tag & 0x7F;
+	}
+
+	timestamp = stream->repeated? ((stream->previous + stream->delta) & stream->counterMask) : (PC_RECORD_PAYLOAD(stream->record) & stream->counterMask);
+
+	/* Records are written in chronological order, thus a smaller timestamp means that the counter wrapped around */
+	if(timestamp < stream->previous)
+		stream->epoch += stream->counterMask + 1;
+	stream->previous = timestamp;
+
+	event->cycle = (stream->epoch + timestamp) << stream->header.prescaler;
+	(stream->pending)--;
+
+	return PC_STREAM_EVENT;
+}
+
+int pc_decode(const uint64_t *log, size_t logLen, pc_trace_t *trace) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+	size_t eventsCapacity = 0;
+	size_t samplesCapacity = 0;
+	pc_stream_t stream;
+
+	memset(trace, 0, sizeof(pc_trace_t));
+	pc_stream_init(&stream);
+
+	/* First record must be the header */
+	ASSERT_CALL(logLen, fprintf(stderr, "Error: log header not found.\n"); rv = EXIT_FAILURE);
+	ASSERT_CALL(EXIT_SUCCESS == pc_stream_record(&stream, log[0]), rv = EXIT_FAILURE);
+
+	/* Repeat records stand for several events */
+	for(i = 1; i < logLen && log[i]; i++) {
+		if(PC_REC_SAMPLE == PC_RECORD_TAG(log[i]))
+			samplesCapacity++;
+		else
+			eventsCapacity += (PC_REC_REPEAT == PC_RECORD_TAG(log[i]))? PC_REPEAT_COUNT(log[i]) : 1;
+	}
+	trace->events = malloc((eventsCapacity? eventsCapacity : 1) * sizeof(pc_event_t));
+	ASSERT_CALL(trace->events, fprintf(stderr, "Error: could not allocate memory for decoded events.\n"); rv = EXIT_FAILURE);
+	if(samplesCapacity) {
+		trace->samples = malloc(samplesCapacity * sizeof(pc_sample_t));
+		ASSERT_CALL(trace->samples, fprintf(stderr, "Error: could not allocate memory for decoded samples.\n"); rv = EXIT_FAILURE);
+	}
+
+	for(i = 1; i < logLen && log[i]; i++) {
+		unsigned tag = PC_RECORD_TAG(log[i]);
+		pc_stream_item_t item;
+		pc_event_t event;
+		pc_sample_t sample;
+
+		/* Telemetry trailer, the payload is not a timestamp */
+		if(PC_REC_TELEMETRY == tag) {
+			pc_telemetry_set(&(trace->telemetry), (log[i] >> 48) & 0xF, log[i] & 0xFFFFFFFFFFFFull);
+			continue;
+		}
+		/* Traffic of the monitored DUT port, following the checkpoint it belongs to */
+		else if(PC_REC_TRAFFIC == tag) {
+			trace->traffic = true;
+			if(trace->eventsLen)
+				pc_traffic_set(&(trace->events[trace->eventsLen - 1].traffic), PC_TRAFFIC_FIELD(log[i]), PC_TRAFFIC_READ(log[i]), PC_TRAFFIC_WRITE(log[i]));
+			continue;
+		}
+		else if(PC_REC_REPEAT == tag) {
+			(trace->repeatRecords)++;
+		}
+
+		pc_stream_record(&stream, log[i]);
+		while(PC_STREAM_NONE != (item = pc_stream_next(&stream, &event, &sample))) {
+			if(PC_STREAM_EVENT == item)
+				trace->events[(trace->eventsLen)++] = event;
+			else
+				trace->samples[(trace->samplesLen)++] = sample;
+		}
+	}
+
+	trace->header = stream.header;
+
+_err:
+	if(EXIT_FAILURE == rv)
+		pc_trace_free(trace);
+
+	return rv;
+}
+
+int pc_log_save(const char *fileName, const uint64_t *log, size_t logLen) {
+	int rv = EXIT_SUCCESS;
+	size_t used;
+	FILE *logFile = fopen(fileName, "wb");
+
+	ASSERT_CALL(logFile, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+
+	/* Only the records up to the first empty one are saved */
+	for(used = 0; used < logLen && log[used]; used++)
+		continue;
+	ASSERT_CALL(used == fwrite(log, sizeof(uint64_t), used, logFile), fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+
+_err:
+	if(logFile)
+		fclose(logFile);
+
+	return rv;
+}
+
+int pc_log_load(const char *fileName, uint64_t **log, size_t *logLen) {
+	int rv = EXIT_SUCCESS;
+	long logSz;
+	FILE *logFile = fopen(fileName, "rb");
+
+	*log = NULL;
+	*logLen = 0;
+	ASSERT_CALL(logFile, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+
+	fseek(logFile, 0, SEEK_END);
+	logSz = ftell(logFile);
+	fseek(logFile, 0, SEEK_SET);
+	ASSERT_CALL(logSz > 0 && !(logSz % sizeof(uint64_t)), fprintf(stderr, "Error: malformed log file: %s\n", fileName); rv = EXIT_FAILURE);
+
+	*log = malloc(logSz);
+	ASSERT_CALL(*log, fprintf(stderr, "Error: could not allocate memory for log.\n"); rv = EXIT_FAILURE);
+	*logLen = logSz / sizeof(uint64_t);
+	ASSERT_CALL(*logLen == fread(*log, sizeof(uint64_t), *logLen, logFile), fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+
+_err:
+	if(logFile)
+		fclose(logFile);
+	if(EXIT_FAILURE == rv) {
+		free(*log);
+		*log = NULL;
+		*logLen = 0;
+	}
+
+	return rv;
+}
+
+void pc_trace_free(pc_trace_t *trace) {
+	if(trace->events)
+		free(trace->events);
+	if(trace->samples)
+		free(trace->samples);
+	trace->events = NULL;
+	trace->eventsLen = 0;
+	trace->samples = NULL;
+	trace->samplesLen = 0;
+}
+
+/* Issuer of an event, as split by pc_trace_split() */
+static unsigned pc_event_issuer(const pc_event_t *event, bool byWorkItem) {
+	return byWorkItem? ((event->group << 8) | event->local) : event->group;
+}
+
+static int pc_issuer_compare(const void *a, const void *b) {
+	unsigned issuerA = *((const unsigned *) a);
+	unsigned issuerB = *((const unsigned *) b);
+
+	return (issuerA > issuerB) - (issuerA < issuerB);
+}
+
+int pc_trace_split(const pc_trace_t *trace, bool byWorkItem, pc_trace_t **parts, size_t *partsLen) {
+	int rv = EXIT_SUCCESS;
+	unsigned *issuers = NULL;
+	size_t issuersLen = 0;
+	size_t i;
+
+	*parts = NULL;
+	*partsLen = 0;
+
+	/* Distinct issuers, in ascending order. Logs from other DUTs have a single issuer (0) */
+	issuers = malloc((trace->eventsLen? trace->eventsLen : 1) * sizeof(unsigned));
+	ASSERT_CALL(issuers, fprintf(stderr, "Error: could not allocate memory for trace parts.\n"); rv = EXIT_FAILURE);
+	for(i = 0; i < trace->eventsLen; i++)
+		issuers[i] = pc_event_issuer(&(trace->events[i]), byWorkItem);
+	if(!(trace->eventsLen))
+		issuers[0] = 0;
+	qsort(issuers, trace->eventsLen, sizeof(unsigned), pc_issuer_compare);
+	for(i = 0; i < trace->eventsLen || !i; i++) {
+		if(!i || issuers[i] != issuers[issuersLen - 1])
+			issuers[issuersLen++] = issuers[i];
+	}
+
+	*parts = calloc(issuersLen, sizeof(pc_trace_t));
+	ASSERT_CALL(*parts, fprintf(stderr, "Error: could not allocate memory for trace parts.\n"); rv = EXIT_FAILURE);
+	*partsLen = issuersLen;
+	for(i = 0; i < issuersLen; i++) {
+		(*parts)[i].header = trace->header;
+		(*parts)[i].telemetry = trace->telemetry;
+		(*parts)[i].traffic = trace->traffic;
+		(*parts)[i].calibrated = trace->calibrated;
+		(*parts)[i].calibration = trace->calibration;
+		(*parts)[i].events = malloc((trace->eventsLen? trace->eventsLen : 1) * sizeof(pc_event_t));
+		ASSERT_CALL((*parts)[i].events, fprintf(stderr, "Error: could not allocate memory for trace parts.\n"); rv = EXIT_FAILURE);
+	}
+
+	/* Events keep their chronological order within each part */
+	for(i = 0; i < trace->eventsLen; i++) {
+		unsigned issuer = pc_event_issuer(&(trace->events[i]), byWorkItem);
+		unsigned *found = bsearch(&issuer, issuers, issuersLen, sizeof(unsigned), pc_issuer_compare);
+		pc_trace_t *part = &((*parts)[found - issuers]);
+
+		part->events[(part->eventsLen)++] = trace->events[i];
+	}
+
+_err:
+	if(issuers)
+		free(issuers);
+	if(EXIT_FAILURE == rv && *parts) {
+		for(i = 0; i < *partsLen; i++)
+			pc_trace_free(&((*parts)[i]));
+		free(*parts);
+		*parts = NULL;
+		*partsLen = 0;
+	}
+
+	return rv;
+}
+
+void pc_print_trace(FILE *f, const pc_trace_t *trace, const pc_symtab_t *symtab) {
+	size_t i;
+	char name[64];
+	char issuer[24];
+
+	fprintf(f, "Information provided by \"profCounter\" (%u-bit counter, 1 count per %u cycles):\n", trace->header.counterWidth, 1u << trace->header.prescaler);
+	if(trace->header.cpu)
+		fprintf(f, "Recorded by the CPU backend, timestamps count ticks of the CPU time source (%u MHz).\n", trace->header.kernelClockMHz);
+	else if(trace->header.dutCycles)
+		fprintf(f, "Timestamps count DUT cycles (DUT clock %u MHz, profCounter clock %u MHz).\n", trace->header.dutClockMHz, trace->header.kernelClockMHz);
+	else if(trace->header.kernelClockMHz)
+		fprintf(f, "Clock: %u MHz.\n", trace->header.kernelClockMHz);
+	if(trace->samplesLen)
+		fprintf(f, "Sampled execution: %zu samples, stamps and checkpoints were not logged.\n", trace->samplesLen);
+	if(trace->repeatRecords)
+		fprintf(f, "Run compression: %zu repeat records expanded into events.\n", trace->repeatRecords);
+	if(trace->calibrated) {
+		fprintf(
+			f, "Calibrated: transitions are accurate to %.2f cycles (pipe jitter, deviation from %" PRId64 " to %" PRId64 " cycles).\n",
+			trace->calibration.jitter, trace->calibration.minDeviation, trace->calibration.maxDeviation
+		);
+	}
+	if(trace->header.ndrange) {
+		fprintf(f, "NDRange log, events are tagged with their work-group (modulo 8192) and local ID hash.\n");
+		fprintf(f, "|           |          |                                  |        Timestamp        |\n");
+		fprintf(f, "| Issuer    | Chkpt ID | Location                         |   Absolute |   Relative |\n");
+	}
+	else {
+		fprintf(f, "|          |                                  |        Timestamp        |\n");
+		fprintf(f, "| Chkpt ID | Location                         |   Absolute |   Relative |\n");
+	}
+	for(i = 0; i < trace->eventsLen; i++) {
+		const pc_event_t *event = &(trace->events[i]);
+
+		if(trace->header.ndrange) {
+			snprintf(issuer, sizeof(issuer), "%u.%u", event->group, event->local);
+			fprintf(f, "| %-9s ", issuer);
+		}
+
+		if(PC_EVENT_CHECKPOINT == event->type) {
+			fprintf(
+				f, "|       %2x | %-32.32s | %10" PRIu64 " | %10" PRIu64 " |\n", event->id, pc_symbol_name(symtab, event->id, name, sizeof(name)),
+				event->cycle, event->cycle - trace->events[0].cycle
+			);
+		}
+		else {
+			fprintf(f, "|       -- | %-32s | %10" PRIu64 " | %10" PRIu64 " |\n", "(stamp)", event->cycle, event->cycle - trace->events[0].cycle);
+		}
+	}
+}
+
+void pc_print_telemetry(FILE *f, const pc_trace_t *trace) {
+	const pc_telemetry_t *telemetry = &(trace->telemetry);
+	static const char *binNames[PC_TEL_LATENCY_BINS] = {"<4", "4-7", "8-15", "16-31", "32-63", "64-127", "128-255", ">=256"};
+	static const char *channelNames[3] = {"AWREADY", "WREADY", "BVALID"};
+	uint64_t blocked[3] = {telemetry->awBlocked, telemetry->wBlocked, telemetry->bBlocked};
+	unsigned worst = 0;
+	unsigned i;
+
+	if(!telemetry->present)
+		return;
+
+	for(i = 1; i < 3; i++) {
+		if(blocked[i] > blocked[worst])
+			worst = i;
+	}
+
+	fprintf(f, "Writer telemetry:\n");
+	fprintf(
+		f, "FIFO high-water mark: %" PRIu64 " of %" PRIu64 " records (%.1f%%); %" PRIu64 " records dropped.\n",
+		telemetry->fifoHighWater, telemetry->fifoDepth, telemetry->fifoDepth? (100.0 * telemetry->fifoHighWater) / telemetry->fifoDepth : 0.0,
+		telemetry->dropped
+	);
+	fprintf(f, "Commands received: %" PRIu64 "; beats written: %" PRIu64 ".\n", telemetry->received, telemetry->writes);
+	fprintf(
+		f, "Cycles blocked on AWREADY: %" PRIu64 ", WREADY: %" PRIu64 ", BVALID: %" PRIu64 " (%.1f cycles per write).\n",
+		telemetry->awBlocked, telemetry->wBlocked, telemetry->bBlocked,
+		telemetry->writes? (telemetry->awBlocked + telemetry->wBlocked + telemetry->bBlocked) / (double) telemetry->writes : 0.0
+	);
+	fprintf(f, "| Write latency (cycles) |");
+	for(i = 0; i < PC_TEL_LATENCY_BINS; i++)
+		fprintf(f, " %8s |", binNames[i]);
+	fprintf(f, "\n|                 Writes |");
+	for(i = 0; i < PC_TEL_LATENCY_BINS; i++)
+		fprintf(f, " %8" PRIu64 " |", telemetry->latency[i]);
+	fprintf(f, "\n");
+
+	/* Records are only dropped when the FIFO is full, i.e. when the writer did not keep up with the commands. If the writer spent */
+	/* most of its time waiting on memory, the cause is memory contention, otherwise it is the command rate itself. Either way, the */
+	/* FIFO must absorb the bursts: PROFCOUNTER_HOLD() would only make it fill up faster */
+	if(telemetry->dropped) {
+		fprintf(f, "Records were lost at the writer FIFO. ");
+		if(blocked[worst]) {
+			fprintf(
+				f, "The writer was mostly waiting on %s (memory contention), consider a deeper FIFO (FIFO_DEPTH in config.vh) or a wider or "
+				"less contended memory port for the log.\n", channelNames[worst]
+			);
+		}
+		else
+			fprintf(f, "Commands arrive faster than records are written, consider a deeper FIFO (FIFO_DEPTH in config.vh).\n");
+	}
+	else if(telemetry->fifoDepth && telemetry->fifoHighWater == telemetry->fifoDepth) {
+		fprintf(f, "No records were lost, but the FIFO was full at some point.\n");
+	}
+	else {
+		fprintf(f, "No records were lost.\n");
+	}
+}
+
+void pc_print_groups(FILE *f, const pc_trace_t *trace) {
+	pc_trace_t *groups = NULL;
+	size_t groupsLen = 0;
+	size_t i;
+	size_t j;
+
+	if(!(trace->header.ndrange) || !(trace->eventsLen) || EXIT_SUCCESS != pc_trace_split(trace, false, &groups, &groupsLen))
+		return;
+
+	/* Cycles are relative to the first event of the trace, as in pc_print_trace() */
+	fprintf(f, "Events per work-group:\n");
+	fprintf(f, "| Work-group | Work-items |   Events |      First |       Last |       Span |\n");
+	for(i = 0; i < groupsLen; i++) {
+		const pc_trace_t *group = &(groups[i]);
+		bool seen[256] = {false};
+		unsigned items = 0;
+		uint64_t first = group->events[0].cycle - trace->events[0].cycle;
+		uint64_t last = group->events[group->eventsLen - 1].cycle - trace->events[0].cycle;
+
+		for(j = 0; j < group->eventsLen; j++) {
+			if(!seen[group->events[j].local]) {
+				seen[group->events[j].local] = true;
+				items++;
+			}
+		}
+
+		fprintf(
+			f, "| %10u | %10u | %8zu | %10" PRIu64 " | %10" PRIu64 " | %10" PRIu64 " |\n", group->events[0].group, items, group->eventsLen,
+			first, last, last - first
+		);
+	}
+
+	for(i = 0; i < groupsLen; i++)
+		pc_trace_free(&(groups[i]));
+	free(groups);
+}
+
+void pc_print_traffic(FILE *f, const pc_trace_t *trace, const pc_symtab_t *symtab) {
+	typedef struct {
+		/* Region start (UINT_MAX for the kernel start) and end */
+		unsigned from;
+		unsigned to;
+		size_t samples;
+		uint64_t cycles;
+		pc_traffic_t traffic;
+	} traffic_region_t;
+	traffic_region_t *regions = NULL;
+	size_t regionsLen = 0;
+	pc_traffic_t total = {0};
+	uint64_t totalCycles = 0;
+	unsigned from = UINT_MAX;
+	uint64_t fromCycle = 0;
+	size_t i;
+	size_t j;
+	char fromName[64];
+	char toName[64];
+	char region[128];
+
+	if(!(trace->traffic))
+		return;
+
+	/* Traffic is summed per pair of consecutive checkpoints. The first region starts with the kernel (timestamp 0) */
+	for(i = 0; i < trace->eventsLen; i++) {
+		const pc_event_t *event = &(trace->events[i]);
+
+		if(PC_EVENT_CHECKPOINT != event->type)
+			continue;
+
+		for(j = 0; j < regionsLen && !(from == regions[j].from && event->id == regions[j].to); j++)
+			continue;
+		if(j == regionsLen) {
+			traffic_region_t *newRegions = realloc(regions, (regionsLen + 1) * sizeof(traffic_region_t));
+
+			if(!newRegions) {
+				fprintf(stderr, "Error: could not allocate memory for traffic regions.\n");
+				free(regions);
+				return;
+			}
+			regions = newRegions;
+			memset(&(regions[j]), 0, sizeof(traffic_region_t));
+			regions[j].from = from;
+			regions[j].to = event->id;
+			regionsLen++;
+		}
+
+		(regions[j].samples)++;
+		regions[j].cycles += event->cycle - fromCycle;
+		regions[j].traffic.readBytes += event->traffic.readBytes;
+		regions[j].traffic.writeBytes += event->traffic.writeBytes;
+		regions[j].traffic.readBusy += event->traffic.readBusy;
+		regions[j].traffic.writeBusy += event->traffic.writeBusy;
+		total.readBytes += event->traffic.readBytes;
+		total.writeBytes += event->traffic.writeBytes;
+		totalCycles += event->cycle - fromCycle;
+
+		from = event->id;
+		fromCycle = event->cycle;
+	}
+
+	fprintf(f, "Memory traffic of the monitored DUT port:\n");
+	fprintf(f, "| Region                                   | Samples |     Cycles |   Read bytes |  Write bytes | Bytes/cycle |     MB/s | Busy R/W (%%) |\n");
+	for(j = 0; j < regionsLen; j++) {
+		const traffic_region_t *current = &(regions[j]);
+		uint64_t bytes = current->traffic.readBytes + current->traffic.writeBytes;
+		double bytesPerCycle = current->cycles? bytes / (double) current->cycles : 0.0;
+
+		snprintf(
+			region, sizeof(region), "%s -> %s", (UINT_MAX == current->from)? "(start)" : pc_symbol_name(symtab, current->from, fromName, sizeof(fromName)),
+			pc_symbol_name(symtab, current->to, toName, sizeof(toName))
+		);
+		fprintf(
+			f, "| %-40.40s | %7zu | %10" PRIu64 " | %12" PRIu64 " | %12" PRIu64 " | %11.2f |", region, current->samples, current->cycles,
+			current->traffic.readBytes, current->traffic.writeBytes, bytesPerCycle
+		);
+		/* Bytes per cycle times cycles per microsecond */
+		if(trace->header.kernelClockMHz)
+			fprintf(f, " %8.1f |", bytesPerCycle * trace->header.kernelClockMHz);
+		else
+			fprintf(f, " %8s |", "--");
+		fprintf(
+			f, " %5.1f/%5.1f |\n", current->cycles? (100.0 * current->traffic.readBusy) / current->cycles : 0.0,
+			current->cycles? (100.0 * current->traffic.writeBusy) / current->cycles : 0.0
+		);
+	}
+	fprintf(
+		f, "Total: %" PRIu64 " bytes read, %" PRIu64 " bytes written in %" PRIu64 " cycles (%.2f bytes/cycle).\n", total.readBytes,
+		total.writeBytes, totalCycles, totalCycles? (total.readBytes + total.writeBytes) / (double) totalCycles : 0.0
+	);
+
+	free(regions);
+}
+
+/* Time spent in a region, as sampled by pc_print_samples() */
+typedef struct {
+	/* Last checkpoint passed (UINT_MAX before the first checkpoint) */
+	unsigned id;
+	size_t samples;
+	uint64_t hits;
+} sample_region_t;
+
+static int pc_sample_region_compare(const void *a, const void *b) {
+	const sample_region_t *regionA = (const sample_region_t *) a;
+	const sample_region_t *regionB = (const sample_region_t *) b;
+
+	return (regionA->samples < regionB->samples) - (regionA->samples > regionB->samples);
+}
+
+void pc_print_samples(FILE *f, const pc_trace_t *trace, const pc_symtab_t *symtab) {
+	/* One region per checkpoint ID, plus the one before the first checkpoint */
+	sample_region_t regions[129];
+	size_t regionsLen = 0;
+	double interval;
+	size_t i;
+	size_t j;
+	char name[64];
+
+	if(!(trace->samplesLen))
+		return;
+
+	for(i = 0; i < trace->samplesLen; i++) {
+		const pc_sample_t *sample = &(trace->samples[i]);
+		unsigned id = sample->seen? sample->id : UINT_MAX;
+
+		for(j = 0; j < regionsLen && regions[j].id != id; j++)
+			continue;
+		if(j == regionsLen) {
+			regions[j].id = id;
+			regions[j].samples = 0;
+			regions[j].hits = 0;
+			regionsLen++;
+		}
+		(regions[j].samples)++;
+		regions[j].hits += sample->hits;
+	}
+	qsort(regions, regionsLen, sizeof(sample_region_t), pc_sample_region_compare);
+
+	/* The first sample is one interval after start */
+	interval = (trace->samplesLen > 1)?
+		(trace->samples[trace->samplesLen - 1].cycle - trace->samples[0].cycle) / (double) (trace->samplesLen - 1) :
+		(double) trace->samples[0].cycle;
+
+	fprintf(f, "Time in region, from %zu samples (one every %.0f cycles):\n", trace->samplesLen, interval);
+	fprintf(f, "| Region (after checkpoint)        | Samples |  Share (%%) |  +/- (%%) | Est. cycles | Checkpoints |\n");
+	for(j = 0; j < regionsLen; j++) {
+		double share = regions[j].samples / (double) trace->samplesLen;
+
+		/* Normal approximation of the binomial confidence interval of the share */
+		fprintf(
+			f, "| %-32.32s | %7zu | %10.2f | %8.2f | %11.0f | %11" PRIu64 " |\n",
+			(UINT_MAX == regions[j].id)? "(start)" : pc_symbol_name(symtab, regions[j].id, name, sizeof(name)), regions[j].samples,
+			100.0 * share, 100.0 * 1.96 * sqrt(share * (1 - share) / trace->samplesLen), regions[j].samples * interval, regions[j].hits
+		);
+	}
+}
+
+void pc_export_csv(FILE *f, const pc_trace_t *trace, const pc_symtab_t *symtab) {
+	size_t i;
+
+	fprintf(f, "index,type,id,file,line,label,cycle,relative,delta");
+	if(trace->header.ndrange)
+		fprintf(f, ",group,local");
+	if(trace->traffic)
+		fprintf(f, ",read_bytes,write_bytes,read_beats,write_beats,read_busy,write_busy");
+	fprintf(f, "\n");
+	for(i = 0; i < trace->eventsLen; i++) {
+		const pc_event_t *event = &(trace->events[i]);
+		const pc_symbol_t *symbol = (PC_EVENT_CHECKPOINT == event->type)? pc_symtab_lookup(symtab, event->id) : NULL;
+
+		if(PC_EVENT_CHECKPOINT == event->type)
+			fprintf(f, "%zu,checkpoint,%u,", i, event->id);
+		else
+			fprintf(f, "%zu,stamp,,", i);
+
+		if(symbol) {
+			pc_csv_string(f, symbol->file);
+			fprintf(f, ",%u,", symbol->line);
+			pc_csv_string(f, symbol->label);
+			fprintf(f, ",");
+		}
+		else
+			fprintf(f, ",,,");
+
+		fprintf(
+			f, "%" PRIu64 ",%" PRIu64 ",%" PRIu64, event->cycle, event->cycle - trace->events[0].cycle,
+			i? (event->cycle - trace->events[i - 1].cycle) : 0
+		);
+
+		if(trace->header.ndrange)
+			fprintf(f, ",%u,%u", event->group, event->local);
+
+		if(trace->traffic && PC_EVENT_CHECKPOINT == event->type) {
+			fprintf(
+				f, ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64, event->traffic.readBytes, event->traffic.writeBytes,
+				event->traffic.readBeats, event->traffic.writeBeats, event->traffic.readBusy, event->traffic.writeBusy
+			);
+		}
+		else if(trace->traffic) {
+			fprintf(f, ",,,,,,");
+		}
+		fprintf(f, "\n");
+	}
+}
+
+void pc_csv_string(FILE *f, const char *str) {
+	fputc('"', f);
+	for(; *str; str++) {
+		if('"' == *str)
+			fputc('"', f);
+		fputc(*str, f);
+	}
+	fputc('"', f);
+}
+
+int pc_symtab_load(const char *fileName, pc_symtab_t *symtab) {
+	int rv = EXIT_SUCCESS;
+	FILE *symFile = fopen(fileName, "r");
+	char *line = NULL;
+	size_t lineSz = 0;
+	size_t symbolsCap = 0;
+
+	memset(symtab, 0, sizeof(pc_symtab_t));
+	ASSERT_CALL(symFile, rv = EXIT_FAILURE);
+
+	while(getline(&line, &lineSz, symFile) != -1) {
+		char *id = strtok(line, "\t\n");
+		char *file = strtok(NULL, "\t\n");
+		char *lineNo = strtok(NULL, "\t\n");
+		char *label = strtok(NULL, "\n");
+
+		/* Malformed lines are ignored */
+		if(!id || !file || !lineNo)
+			continue;
+
+		if(symtab->symbolsLen == symbolsCap) {
+			pc_symbol_t *symbols;
+
+			symbolsCap = symbolsCap? (2 * symbolsCap) : 16;
+			symbols = realloc(symtab->symbols, symbolsCap * sizeof(pc_symbol_t));
+			ASSERT_CALL(symbols, fprintf(stderr, "Error: could not allocate memory for symbol table.\n"); rv = EXIT_FAILURE);
+			symtab->symbols = symbols;
+		}
+
+		symtab->symbols[symtab->symbolsLen].id = strtoul(id, NULL, 10);
+		symtab->symbols[symtab->symbolsLen].file = strdup(file);
+		symtab->symbols[symtab->symbolsLen].line = strtoul(lineNo, NULL, 10);
+		symtab->symbols[symtab->symbolsLen].label = strdup(label? label : "");
+		(symtab->symbolsLen)++;
+	}
+
+_err:
+	if(line)
+		free(line);
+	if(symFile)
+		fclose(symFile);
+	if(EXIT_FAILURE == rv)
+		pc_symtab_free(symtab);
+
+	return rv;
+}
+
+void pc_symtab_free(pc_symtab_t *symtab) {
+	size_t i;
+
+	for(i = 0; i < symtab->symbolsLen; i++) {
+		free(symtab->symbols[i].file);
+		free(symtab->symbols[i].label);
+	}
+	if(symtab->symbols)
+		free(symtab->symbols);
+	symtab->symbols = NULL;
+	symtab->symbolsLen = 0;
+}
+
+const pc_symbol_t *pc_symtab_lookup(const pc_symtab_t *symtab, unsigned id) {
+	size_t i;
+
+	if(!symtab)
+		return NULL;
+
+	for(i = 0; i < symtab->symbolsLen; i++) {
+		if(id == symtab->symbols[i].id)
+			return &(symtab->symbols[i]);
+	}
+
+	return NULL;
+}
+
+char *pc_symbol_name(const pc_symtab_t *symtab, unsigned id, char *name, size_t nameSz) {
+	size_t i;
+	unsigned others = 0;
+	const pc_symbol_t *symbol = pc_symtab_lookup(symtab, id);
+
+	if(!symbol) {
+		snprintf(name, nameSz, "0x%x", id);
+		return name;
+	}
+
+	for(i = 0; i < symtab->symbolsLen; i++) {
+		if(id == symtab->symbols[i].id && symbol != &(symtab->symbols[i]))
+			others++;
+	}
+
+	if(symbol->label[0])
+		snprintf(name, nameSz, others? "%s (+%u)" : "%s", symbol->label, others);
+	else
+		snprintf(name, nameSz, others? "%s:%u (+%u)" : "%s:%u", symbol->file, symbol->line, others);
+
+	return name;
+}
+
+int pc_calibrate(const pc_trace_t *trace, unsigned spacing, pc_calibration_t *calibration) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+	double sum = 0;
+	double sumSquares = 0;
+
+	memset(calibration, 0, sizeof(pc_calibration_t));
+	calibration->spacing = spacing;
+
+	ASSERT_CALL(0 == trace->header.prescaler, fprintf(stderr, "Error: calibration must be performed with prescaler 0.\n"); rv = EXIT_FAILURE);
+	ASSERT_CALL(spacing, fprintf(stderr, "Error: calibration spacing must be positive.\n"); rv = EXIT_FAILURE);
+	/* Consecutive reference commands of different work-items are not spaced by the reference loop */
+	ASSERT_CALL(!(trace->header.ndrange), fprintf(stderr, "Error: calibration must be performed on a single work-item DUT.\n"); rv = EXIT_FAILURE);
+
+	for(i = 1; i < trace->eventsLen; i++) {
+		/* Only the checkpoints of the reference sequence are considered */
+		if(PC_EVENT_CHECKPOINT != trace->events[i - 1].type || PC_EVENT_CHECKPOINT != trace->events[i].type)
+			continue;
+		if(trace->events[i - 1].id || trace->events[i].id)
+			continue;
+
+		int64_t deviation = (int64_t) (trace->events[i].cycle - trace->events[i - 1].cycle) - (int64_t) spacing;
+
+		if(!(calibration->samples) || deviation < calibration->minDeviation)
+			calibration->minDeviation = deviation;
+		if(!(calibration->samples) || deviation > calibration->maxDeviation)
+			calibration->maxDeviation = deviation;
+		sum += deviation;
+		sumSquares += deviation * deviation;
+		(calibration->samples)++;
+	}
+	ASSERT_CALL(calibration->samples > 1, fprintf(stderr, "Error: not enough reference commands found for calibration.\n"); rv = EXIT_FAILURE);
+
+	calibration->slip = sum / calibration->samples;
+	calibration->jitter = sqrt(fmax(0, (sumSquares / calibration->samples) - (calibration->slip * calibration->slip)));
+
+	/* A slipping reference loop (II above 1, stalls) leaves the nominal distances unknown */
+	ASSERT_CALL(
+		fabs(calibration->slip) <= PC_CALIBRATION_MAX_SLIP,
+		fprintf(stderr, "Error: reference sequence slipped %.2f cycles per transition, check that its loop achieved II=1.\n", calibration->slip);
+		rv = EXIT_FAILURE
+	);
+
+_err:
+
+	return rv;
+}
+
+int pc_calibration_save(const char *fileName, const pc_calibration_t *calibration) {
+	int rv = EXIT_SUCCESS;
+	FILE *calFile = fopen(fileName, "w");
+
+	ASSERT_CALL(calFile, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+
+	fprintf(calFile, "# ProfCounter pipe timing calibration\n");
+	fprintf(calFile, "spacing %u\n", calibration->spacing);
+	fprintf(calFile, "samples %zu\n", calibration->samples);
+	fprintf(calFile, "slip %lf\n", calibration->slip);
+	fprintf(calFile, "jitter %lf\n", calibration->jitter);
+	fprintf(calFile, "deviation %" PRId64 " %" PRId64 "\n", calibration->minDeviation, calibration->maxDeviation);
+
+_err:
+	if(calFile)
+		fclose(calFile);
+
+	return rv;
+}
+
+int pc_calibration_load(const char *fileName, pc_calibration_t *calibration) {
+	int rv = EXIT_SUCCESS;
+	FILE *calFile = fopen(fileName, "r");
+
+	memset(calibration, 0, sizeof(pc_calibration_t));
+	ASSERT_CALL(calFile, rv = EXIT_FAILURE);
+
+	ASSERT_CALL(
+		6 == fscanf(
+			calFile, "# ProfCounter pipe timing calibration spacing %u samples %zu slip %lf jitter %lf deviation %" SCNd64 " %" SCNd64,
+			&(calibration->spacing), &(calibration->samples), &(calibration->slip), &(calibration->jitter),
+			&(calibration->minDeviation), &(calibration->maxDeviation)
+		),
+		fprintf(stderr, "Error: malformed calibration file: %s\n", fileName); rv = EXIT_FAILURE
+	);
+
+_err:
+	if(calFile)
+		fclose(calFile);
+
+	return rv;
+}
+
+void pc_apply_calibration(pc_trace_t *trace, const pc_calibration_t *calibration) {
+	trace->calibrated = true;
+	trace->calibration = *calibration;
+}
@@ -0,0 +1,231 @@
+/**
+ * ProfCounter asynchronous log drain
+ *
+ * Overlaps the log transfer, its decoding/export and the next kernel launch. Each pc_drain_enqueue() issues a non-blocking read of
+ * the log buffer into one of PC_DRAIN_SLOTS pinned host buffers, chained to the ProfCounter kernel event. When the read completes,
+ * an event callback hands the buffer to a worker thread, which decodes the log and calls the consumer. The host thread only blocks
+ * when all pinned buffers are still in use (i.e. it is at most PC_DRAIN_SLOTS runs ahead of the workers).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "pcdrain.h"
+
+/* Event callback: the read into a pinned buffer completed (or failed), queue it for the workers */
+static void CL_CALLBACK pc_drain_complete(cl_event event, cl_int status, void *arg) {
+	pc_drain_t *drain = (pc_drain_t *) arg;
+	unsigned i;
+
+	pthread_mutex_lock(&(drain->mutex));
+
+	for(i = 0; i < PC_DRAIN_SLOTS; i++) {
+		pc_slot_t *slot = &(drain->slots[i]);
+
+		if(PC_SLOT_TRANSFERRING == slot->state && event == slot->event) {
+			slot->failed = status < 0;
+			slot->state = PC_SLOT_READY;
+			drain->ready[(drain->readyHead + drain->readyLen) % PC_DRAIN_SLOTS] = i;
+			(drain->readyLen)++;
+			break;
+		}
+	}
+
+	pthread_cond_broadcast(&(drain->changed));
+	pthread_mutex_unlock(&(drain->mutex));
+}
+
+static void *pc_drain_worker(void *arg) {
+	pc_drain_t *drain = (pc_drain_t *) arg;
+
+	pthread_mutex_lock(&(drain->mutex));
+
+	while(true) {
+		pc_slot_t *slot;
+		pc_trace_t trace;
+		bool succeeded;
+
+		while(!(drain->readyLen) && !(drain->stopping))
+			pthread_cond_wait(&(drain->changed), &(drain->mutex));
+		if(!(drain->readyLen))
+			break;
+
+		slot = &(drain->slots[drain->ready[drain->readyHead]]);
+		drain->readyHead = (drain->readyHead + 1) % PC_DRAIN_SLOTS;
+		(drain->readyLen)--;
+		slot->state = PC_SLOT_CONSUMING;
+
+		/* Decode and consume outside the lock, so that other workers and the completion callbacks are not held */
+		pthread_mutex_unlock(&(drain->mutex));
+
+		clReleaseEvent(slot->event);
+		slot->event = NULL;
+
+		succeeded = !(slot->failed);
+		if(succeeded)
+			succeeded = EXIT_SUCCESS == pc_decode(slot->log, drain->logLen, &trace);
+		if(succeeded) {
+			succeeded = EXIT_SUCCESS == drain->consumer(slot->run, slot->log, drain->logLen, &trace, drain->consumerArg);
+			pc_trace_free(&trace);
+		}
+		else {
+			fprintf(stderr, "Error: could not drain log of run %u.\n", slot->run);
+		}
+
+		pthread_mutex_lock(&(drain->mutex));
+
+		if(!succeeded)
+			(drain->failures)++;
+		(drain->consumed)++;
+		slot->state = PC_SLOT_FREE;
+		pthread_cond_broadcast(&(drain->changed));
+	}
+
+	pthread_mutex_unlock(&(drain->mutex));
+
+	return NULL;
+}
+
+int pc_drain_init(
+	pc_drain_t *drain, cl_context context, cl_command_queue queue, size_t logLen, unsigned workersLen,
+	pc_drain_consumer_t consumer, void *consumerArg
+) {
+	int rv = EXIT_SUCCESS;
+	unsigned i;
+	cl_int fRet;
+
+	memset(drain, 0, sizeof(pc_drain_t));
+	pthread_mutex_init(&(drain->mutex), NULL);
+	pthread_cond_init(&(drain->changed), NULL);
+	drain->queue = queue;
+	drain->logLen = logLen;
+	drain->consumer = consumer;
+	drain->consumerArg = consumerArg;
+
+	ASSERT_CALL(
+		workersLen && workersLen <= PC_DRAIN_MAX_WORKERS,
+		fprintf(stderr, "Error: number of drain workers must be between 1 and %d.\n", PC_DRAIN_MAX_WORKERS); rv = EXIT_FAILURE
+	);
+
+	/* Buffers allocated by the runtime are pinned, and mapping them once gives host pointers that can be used as DMA targets */
+	for(i = 0; i < PC_DRAIN_SLOTS; i++) {
+		pc_slot_t *slot = &(drain->slots[i]);
+
+		slot->buffer = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, logLen * sizeof(uint64_t), NULL, &fRet);
+		ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clCreateBuffer failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+		slot->log = clEnqueueMapBuffer(
+			queue, slot->buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, logLen * sizeof(uint64_t), 0, NULL, NULL, &fRet
+		);
+		ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clEnqueueMapBuffer failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	}
+
+	for(i = 0; i < workersLen; i++) {
+		fRet = pthread_create(&(drain->workers[i]), NULL, pc_drain_worker, drain);
+		ASSERT_CALL(!fRet, fprintf(stderr, "Error: %s: drain worker\n", strerror(fRet)); rv = EXIT_FAILURE);
+		(drain->workersLen)++;
+	}
+
+_err:
+	if(EXIT_FAILURE == rv)
+		pc_drain_release(drain);
+
+	return rv;
+}
+
+int pc_drain_enqueue(pc_drain_t *drain, cl_mem logK, cl_uint waitListLen, const cl_event *waitList) {
+	int rv = EXIT_SUCCESS;
+	unsigned i;
+	cl_int fRet;
+	pc_slot_t *slot = NULL;
+
+	/* Wait for a free pinned buffer */
+	pthread_mutex_lock(&(drain->mutex));
+	while(!slot) {
+		for(i = 0; i < PC_DRAIN_SLOTS && !slot; i++) {
+			if(PC_SLOT_FREE == drain->slots[i].state)
+				slot = &(drain->slots[i]);
+		}
+		if(!slot)
+			pthread_cond_wait(&(drain->changed), &(drain->mutex));
+	}
+	slot->state = PC_SLOT_TRANSFERRING;
+	slot->failed = false;
+	slot->run = (drain->enqueued)++;
+	pthread_mutex_unlock(&(drain->mutex));
+
+	slot->event = NULL;
+	fRet = clEnqueueReadBuffer(drain->queue, logK, CL_FALSE, 0, drain->logLen * sizeof(uint64_t), slot->log, waitListLen, waitList, &(slot->event));
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clEnqueueReadBuffer failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+
+	/* If the callback cannot be registered, fall back to a blocking wait */
+	fRet = clSetEventCallback(slot->event, CL_COMPLETE, pc_drain_complete, drain);
+	if(CL_SUCCESS != fRet) {
+		fRet = clWaitForEvents(1, &(slot->event));
+		pc_drain_complete(slot->event, (CL_SUCCESS == fRet)? CL_COMPLETE : fRet, drain);
+	}
+
+	/* Make sure that the read is submitted, otherwise the callback might never be called */
+	clFlush(drain->queue);
+
+_err:
+	if(EXIT_FAILURE == rv) {
+		pthread_mutex_lock(&(drain->mutex));
+		slot->state = PC_SLOT_FREE;
+		(drain->failures)++;
+		(drain->consumed)++;
+		pthread_cond_broadcast(&(drain->changed));
+		pthread_mutex_unlock(&(drain->mutex));
+	}
+
+	return rv;
+}
+
+int pc_drain_finish(pc_drain_t *drain) {
+	int rv;
+
+	pthread_mutex_lock(&(drain->mutex));
+	while(drain->consumed < drain->enqueued)
+		pthread_cond_wait(&(drain->changed), &(drain->mutex));
+	rv = drain->failures? EXIT_FAILURE : EXIT_SUCCESS;
+	pthread_mutex_unlock(&(drain->mutex));
+
+	return rv;
+}
+
+void pc_drain_release(pc_drain_t *drain) {
+	unsigned i;
+
+	if(!(drain->queue))
+		return;
+
+	/* Transfers can only be waited for if there are workers to consume them */
+	if(drain->workersLen)
+		pc_drain_finish(drain);
+
+	pthread_mutex_lock(&(drain->mutex));
+	drain->stopping = true;
+	pthread_cond_broadcast(&(drain->changed));
+	pthread_mutex_unlock(&(drain->mutex));
+
+	for(i = 0; i < drain->workersLen; i++)
+		pthread_join(drain->workers[i], NULL);
+
+	for(i = 0; i < PC_DRAIN_SLOTS; i++) {
+		pc_slot_t *slot = &(drain->slots[i]);
+
+		if(slot->log)
+			clEnqueueUnmapMemObject(drain->queue, slot->buffer, slot->log, 0, NULL, NULL);
+		if(slot->event)
+			clReleaseEvent(slot->event);
+	}
+	clFinish(drain->queue);
+	for(i = 0; i < PC_DRAIN_SLOTS; i++) {
+		if(drain->slots[i].buffer)
+			clReleaseMemObject(drain->slots[i].buffer);
+	}
+
+	pthread_cond_destroy(&(drain->changed));
+	pthread_mutex_destroy(&(drain->mutex));
+	memset(drain, 0, sizeof(pc_drain_t));
+}
@@ -0,0 +1,439 @@
+/**
+ * ProfCounter live streaming
+ *
+ * Publishes the trace of a run while the DUT is still running, so that long executions can be followed without waiting for
+ * pc_collect(). A thread reads the log buffer every drain period, starting from the first record not yet decoded and stopping at
+ * the first empty one (the buffer is cleared by pc_arm()), decodes the new records with the state kept from the previous periods
+ * (counter wrap-around, last checkpoint of each work-item) and sends them to every consumer connected to a Unix domain socket,
+ * followed by the statistics of every region seen so far (see pcstream.h for the frames). pcwatch is a consumer for the terminal:
+ *
+ * pc_live_open(&live, &session, "/tmp/profcounter.sock", 100);
+ * do {
+ *     pc_arm(&session);
+ *     pc_live_watch(&live);
+ *     pc_wait_armed(&session);
+ *     (launch DUT and wait for it)
+ *     pc_live_wait(&live);
+ *     pc_collect(&session, &trace);
+ * } while(...);
+ * pc_live_close(&live);
+ *
+ * Reads go through their own command queue and rely on the runtime allowing a buffer to be read while a kernel writes to it (as
+ * XRT does for embedded platforms). Records only become visible once the beat holding them is written, and nothing is visible while
+ * the DUT holds the log writes (PROFCOUNTER_HOLD()). Telemetry and traffic records are left to pc_collect().
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "pclive.h"
+
+/* Checkpoint IDs, as indexes of the region table */
+#define PC_LIVE_CHECKPOINTS 128
+
+/* Entries probed in the work-item table before evicting one */
+#define PC_LIVE_ISSUER_PROBES 8
+
+static void pc_live_drop(pc_live_t *live, unsigned client) {
+	close(live->clients[client]);
+	live->clients[client] = live->clients[--(live->clientsLen)];
+}
+
+/* Send a whole buffer, false if the consumer is gone or too slow */
+static bool pc_live_write(int fd, const void *buffer, size_t bufferSz) {
+	const char *next = buffer;
+
+	while(bufferSz) {
+		ssize_t sent = send(fd, next, bufferSz, MSG_NOSIGNAL);
+
+		if(sent < 0 && EINTR == errno)
+			continue;
+		if(sent <= 0)
+			return false;
+
+		next += sent;
+		bufferSz -= sent;
+	}
+
+	return true;
+}
+
+static bool pc_live_send_to(pc_live_t *live, unsigned client, uint32_t type, const void *payload, size_t payloadSz) {
+	pc_live_frame_t frame = {type, payloadSz};
+
+	return pc_live_write(live->clients[client], &frame, sizeof(frame)) && (!payloadSz || pc_live_write(live->clients[client], payload, payloadSz));
+}
+
+/* Send a frame to every consumer, disconnecting the ones that fail */
+static void pc_live_publish(pc_live_t *live, uint32_t type, const void *payload, size_t payloadSz) {
+	unsigned i = live->clientsLen;
+
+	while(i--) {
+		if(!pc_live_send_to(live, i, type, payload, payloadSz))
+			pc_live_drop(live, i);
+	}
+}
+
+static void pc_live_header_fill(const pc_live_t *live, pc_live_header_t *header) {
+	memset(header, 0, sizeof(pc_live_header_t));
+	header->version = PC_LIVE_VERSION;
+	header->run = live->run;
+	header->counterWidth = live->stream.header.counterWidth;
+	header->prescaler = live->stream.header.prescaler;
+	header->kernelClockMHz = live->stream.header.kernelClockMHz;
+	header->dutClockMHz = live->stream.header.dutClockMHz;
+	header->flags = (live->stream.header.dutCycles? PC_LIVE_FLAG_DUT_CYCLES : 0) | (live->stream.header.cpu? PC_LIVE_FLAG_CPU : 0) |
+		(live->stream.header.ndrange? PC_LIVE_FLAG_NDRANGE : 0);
+}
+
+static void pc_live_send_header(pc_live_t *live) {
+	pc_live_header_t header;
+
+	pc_live_header_fill(live, &header);
+	pc_live_publish(live, PC_LIVE_FRAME_HEADER, &header, sizeof(header));
+	live->headerSent = true;
+}
+
+/* Accept pending connections. Consumers joining during a run get its header first */
+static void pc_live_accept(pc_live_t *live) {
+	int fd;
+	struct timeval timeout = {PC_LIVE_SEND_TIMEOUT / 1000, (PC_LIVE_SEND_TIMEOUT % 1000) * 1000};
+
+	while((fd = accept(live->listenFd, NULL, NULL)) >= 0) {
+		if(PC_LIVE_MAX_CLIENTS == live->clientsLen) {
+			close(fd);
+			continue;
+		}
+
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		live->clients[(live->clientsLen)++] = fd;
+
+		if(live->headerSent) {
+			pc_live_header_t header;
+
+			pc_live_header_fill(live, &header);
+			if(!pc_live_send_to(live, live->clientsLen - 1, PC_LIVE_FRAME_HEADER, &header, sizeof(header)))
+				pc_live_drop(live, live->clientsLen - 1);
+		}
+	}
+}
+
+static void pc_live_flush(pc_live_t *live) {
+	if(live->pendingEvents)
+		pc_live_publish(live, PC_LIVE_FRAME_EVENTS, live->events, live->pendingEvents * sizeof(pc_live_event_t));
+	if(live->pendingSamples)
+		pc_live_publish(live, PC_LIVE_FRAME_SAMPLES, live->samples, live->pendingSamples * sizeof(pc_live_sample_t));
+	live->pendingEvents = 0;
+	live->pendingSamples = 0;
+}
+
+/* Account the transition from the previous checkpoint of the same work-item */
+static int pc_live_region_add(pc_live_t *live, uint32_t issuer, unsigned id, uint64_t cycle) {
+	int rv = EXIT_SUCCESS;
+	unsigned home = (issuer * 2654435761u) & (PC_LIVE_ISSUERS - 1);
+	unsigned i;
+	pc_live_issuer_t *last = &(live->issuers[home]);
+
+	for(i = 0; i < PC_LIVE_ISSUER_PROBES; i++) {
+		pc_live_issuer_t *entry = &(live->issuers[(home + i) & (PC_LIVE_ISSUERS - 1)]);
+
+		if(!(entry->valid) || issuer == entry->issuer) {
+			last = entry;
+			break;
+		}
+	}
+
+	if(last->valid && issuer == last->issuer) {
+		uint32_t *index = &(live->regionIndex[last->id * PC_LIVE_CHECKPOINTS + id]);
+		pc_live_region_t *region;
+		uint64_t length = cycle - last->cycle;
+
+		if(!*index) {
+			pc_live_region_t *regions = realloc(live->regions, (live->regionsLen + 1) * sizeof(pc_live_region_t));
+
+			ASSERT_CALL(regions, fprintf(stderr, "Error: could not allocate memory for live regions.\n"); rv = EXIT_FAILURE);
+			live->regions = regions;
+			memset(&(live->regions[live->regionsLen]), 0, sizeof(pc_live_region_t));
+			live->regions[live->regionsLen].from = last->id;
+			live->regions[live->regionsLen].to = id;
+			*index = ++(live->regionsLen);
+		}
+
+		region = &(live->regions[*index - 1]);
+		(region->count)++;
+		region->mean += (length - region->mean) / region->count;
+		if(1 == region->count || length < region->min)
+			region->min = length;
+		if(1 == region->count || length > region->max)
+			region->max = length;
+		(region->windowCount)++;
+		region->windowMean += (length - region->windowMean) / region->windowCount;
+	}
+
+	last->issuer = issuer;
+	last->valid = true;
+	last->id = id;
+	last->cycle = cycle;
+
+_err:
+	return rv;
+}
+
+/* Decode records that follow the ones already decoded */
+static int pc_live_decode(pc_live_t *live, const uint64_t *records, size_t recordsLen) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+
+	for(i = 0; i < recordsLen; i++) {
+		unsigned tag = PC_RECORD_TAG(records[i]);
+		pc_stream_item_t item;
+		pc_event_t event;
+		pc_sample_t sample;
+
+		ASSERT_CALL(EXIT_SUCCESS == pc_stream_record(&(live->stream), records[i]), rv = EXIT_FAILURE);
+		if(PC_REC_HEADER == tag)
+			continue;
+
+		/* Logs without clocks record are announced with their first record */
+		if(PC_REC_CLOCKS == tag || !(live->headerSent))
+			pc_live_send_header(live);
+
+		while(PC_STREAM_NONE != (item = pc_stream_next(&(live->stream), &event, &sample))) {
+			if(PC_STREAM_SAMPLE == item) {
+				pc_live_sample_t *liveSample = &(live->samples[(live->pendingSamples)++]);
+
+				memset(liveSample, 0, sizeof(pc_live_sample_t));
+				liveSample->cycle = sample.cycle;
+				liveSample->id = sample.id;
+				liveSample->seen = sample.seen;
+				liveSample->hits = sample.hits;
+				(live->samplesLen)++;
+			}
+			else {
+				pc_live_event_t *liveEvent = &(live->events[(live->pendingEvents)++]);
+
+				memset(liveEvent, 0, sizeof(pc_live_event_t));
+				liveEvent->cycle = event.cycle;
+				liveEvent->id = (PC_EVENT_STAMP == event.type)? UINT32_MAX : event.id;
+				liveEvent->group = event.group;
+				liveEvent->local = event.local;
+				(live->eventsLen)++;
+
+				if(PC_EVENT_CHECKPOINT == event.type)
+					ASSERT_CALL(EXIT_SUCCESS == pc_live_region_add(live, (event.group << 8) | event.local, event.id, event.cycle), rv = EXIT_FAILURE);
+			}
+
+			if(PC_LIVE_FRAME_CAPACITY == live->pendingEvents || PC_LIVE_FRAME_CAPACITY == live->pendingSamples)
+				pc_live_flush(live);
+		}
+	}
+
+_err:
+	return rv;
+}
+
+/* Read and decode the records written since the previous period, then publish them and the region statistics */
+static int pc_live_poll(pc_live_t *live) {
+	int rv = EXIT_SUCCESS;
+	cl_int fRet;
+	size_t i;
+
+	while(live->consumed < live->session->logLen) {
+		size_t chunkLen = live->session->logLen - live->consumed;
+		size_t used;
+
+		if(chunkLen > PC_SESSION_READ_CHUNK)
+			chunkLen = PC_SESSION_READ_CHUNK;
+
+		fRet = clEnqueueReadBuffer(
+			live->queue, live->session->logK, CL_TRUE, live->consumed * sizeof(uint64_t), chunkLen * sizeof(uint64_t), live->chunk, 0, NULL, NULL
+		);
+		ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clEnqueueReadBuffer failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+
+		for(used = 0; used < chunkLen && live->chunk[used]; used++)
+			continue;
+		ASSERT_CALL(EXIT_SUCCESS == pc_live_decode(live, live->chunk, used), rv = EXIT_FAILURE);
+		live->consumed += used;
+
+		if(used < chunkLen)
+			break;
+	}
+
+_err:
+	pc_live_flush(live);
+	if(live->headerSent) {
+		pc_live_publish(live, PC_LIVE_FRAME_REGIONS, live->regions, live->regionsLen * sizeof(pc_live_region_t));
+		for(i = 0; i < live->regionsLen; i++) {
+			live->regions[i].windowCount = 0;
+			live->regions[i].windowMean = 0;
+		}
+	}
+
+	return rv;
+}
+
+static void *pc_live_thread(void *arg) {
+	pc_live_t *live = (pc_live_t *) arg;
+	struct timespec period = {live->period / 1000, (live->period % 1000) * 1000000};
+	bool finished = false;
+	pc_live_end_t end;
+
+	while(!finished) {
+		cl_int status;
+		cl_int fRet = clGetEventInfo(live->running, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+
+		pc_live_accept(live);
+
+		if(CL_SUCCESS != fRet || status < 0) {
+			live->failed = true;
+			break;
+		}
+		finished = CL_COMPLETE == status;
+
+		/* The log buffer is only cleared once the kernel starts (see pc_arm()), a stale log might be read before */
+		if(status <= CL_RUNNING && EXIT_SUCCESS != pc_live_poll(live)) {
+			live->failed = true;
+			break;
+		}
+
+		if(!finished)
+			nanosleep(&period, NULL);
+	}
+
+	if(!(live->headerSent))
+		pc_live_send_header(live);
+
+	memset(&end, 0, sizeof(pc_live_end_t));
+	end.run = live->run;
+	end.failed = live->failed;
+	end.records = live->consumed;
+	end.events = live->eventsLen;
+	end.samples = live->samplesLen;
+	pc_live_publish(live, PC_LIVE_FRAME_END, &end, sizeof(end));
+
+	return NULL;
+}
+
+int pc_live_open(pc_live_t *live, pc_session_t *session, const char *socketPath, unsigned period) {
+	int rv = EXIT_SUCCESS;
+	cl_int fRet;
+	cl_device_id device;
+	struct sockaddr_un address;
+
+	memset(live, 0, sizeof(pc_live_t));
+	live->listenFd = -1;
+	live->session = session;
+	live->period = period? period : PC_LIVE_DEFAULT_PERIOD;
+	live->socketPath = strdup(socketPath? socketPath : PC_LIVE_DEFAULT_SOCKET);
+	live->chunk = malloc(PC_SESSION_READ_CHUNK * sizeof(uint64_t));
+	live->regionIndex = calloc(PC_LIVE_CHECKPOINTS * PC_LIVE_CHECKPOINTS, sizeof(uint32_t));
+	live->issuers = calloc(PC_LIVE_ISSUERS, sizeof(pc_live_issuer_t));
+	ASSERT_CALL(
+		live->socketPath && live->chunk && live->regionIndex && live->issuers,
+		fprintf(stderr, "Error: could not allocate memory for live streaming.\n"); rv = EXIT_FAILURE
+	);
+
+	fRet = clGetCommandQueueInfo(session->queue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &device, NULL);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clGetCommandQueueInfo failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	live->queue = clCreateCommandQueue(session->context, device, 0, &fRet);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clCreateCommandQueue failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	ASSERT_CALL(strlen(live->socketPath) < sizeof(address.sun_path), fprintf(stderr, "Error: socket path too long: %s\n", live->socketPath); rv = EXIT_FAILURE);
+	strcpy(address.sun_path, live->socketPath);
+
+	/* Consumers are accepted by the watching thread, which must never block on it */
+	live->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	ASSERT_CALL(live->listenFd >= 0, fprintf(stderr, "Error: %s: %s\n", strerror(errno), live->socketPath); rv = EXIT_FAILURE);
+	unlink(live->socketPath);
+	ASSERT_CALL(
+		!bind(live->listenFd, (struct sockaddr *) &address, sizeof(address)) && !listen(live->listenFd, PC_LIVE_MAX_CLIENTS) &&
+		!fcntl(live->listenFd, F_SETFL, O_NONBLOCK),
+		fprintf(stderr, "Error: %s: %s\n", strerror(errno), live->socketPath); rv = EXIT_FAILURE
+	);
+
+_err:
+	if(EXIT_FAILURE == rv)
+		pc_live_close(live);
+
+	return rv;
+}
+
+int pc_live_watch(pc_live_t *live) {
+	int rv = EXIT_SUCCESS;
+	int fRet;
+
+	ASSERT_CALL(!(live->watching), fprintf(stderr, "Error: the previous run is still being watched.\n"); rv = EXIT_FAILURE);
+	ASSERT_CALL(live->session->running, fprintf(stderr, "Error: profCounter was not armed.\n"); rv = EXIT_FAILURE);
+
+	live->consumed = 0;
+	live->failed = false;
+	live->headerSent = false;
+	pc_stream_init(&(live->stream));
+	live->eventsLen = 0;
+	live->samplesLen = 0;
+	live->pendingEvents = 0;
+	live->pendingSamples = 0;
+	live->regionsLen = 0;
+	memset(live->regionIndex, 0, PC_LIVE_CHECKPOINTS * PC_LIVE_CHECKPOINTS * sizeof(uint32_t));
+	memset(live->issuers, 0, PC_LIVE_ISSUERS * sizeof(pc_live_issuer_t));
+
+	live->running = live->session->running;
+	clRetainEvent(live->running);
+	live->run = live->session->runs;
+
+	fRet = pthread_create(&(live->thread), NULL, pc_live_thread, live);
+	ASSERT_CALL(!fRet, fprintf(stderr, "Error: could not create live streaming thread.\n"); clReleaseEvent(live->running); rv = EXIT_FAILURE);
+	live->watching = true;
+
+_err:
+	return rv;
+}
+
+int pc_live_wait(pc_live_t *live) {
+	if(!(live->watching))
+		return EXIT_SUCCESS;
+
+	pthread_join(live->thread, NULL);
+	clReleaseEvent(live->running);
+	live->running = NULL;
+	live->watching = false;
+
+	return live->failed? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+void pc_live_close(pc_live_t *live) {
+	unsigned i;
+
+	pc_live_wait(live);
+
+	for(i = 0; i < live->clientsLen; i++)
+		close(live->clients[i]);
+	if(live->socketPath && live->listenFd >= 0) {
+		close(live->listenFd);
+		unlink(live->socketPath);
+	}
+	if(live->queue)
+		clReleaseCommandQueue(live->queue);
+	if(live->socketPath)
+		free(live->socketPath);
+	if(live->chunk)
+		free(live->chunk);
+	if(live->regions)
+		free(live->regions);
+	if(live->regionIndex)
+		free(live->regionIndex);
+	if(live->issuers)
+		free(live->issuers);
+
+	memset(live, 0, sizeof(pc_live_t));
+}
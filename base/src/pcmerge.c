@@ -0,0 +1,278 @@
+/**
+ * ProfCounter multi-instance merge tool
+ *
+ * Merges the raw logs of several profCounter instances (e.g. one per compute unit or SLR, saved by the host code as
+ * profcounter.log) into a single timeline, ordered by global time:
+ *
+ * pcmerge OUTPUT LOG[@<ns>]... [align=<sync|launch>] [symtab=<file>]
+ *
+ * Each log is placed on the global time base by its start: with align=sync (default), the sync record, i.e. the profCounter cycles
+ * from reset to start, which is shared by the instances of a device; with align=launch, only the offset given after the log file
+ * name, e.g. host-measured launch times in nanoseconds. Offsets are added to the sync stamp in sync mode, e.g. to place the logs of
+ * different devices. The timeline starts at the earliest start. Offsets are only split from the file name if all that follows the last
+ * '@' is a number.
+ *
+ * Logs are read in chunks and decoded incrementally, and a k-way merge over a min-heap keeps a single pending event per log, thus
+ * memory does not grow with the traces. The timeline is written as CSV (one event or sample per line). The exit status is 0 on
+ * success, 1 on errors.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "pcdecoder.h"
+
+/* Records read at a time from each log */
+#define PCMERGE_CHUNK 4096
+
+/* A log being merged, with its next event or sample */
+typedef struct {
+	const char *fileName;
+	FILE *file;
+	uint64_t chunk[PCMERGE_CHUNK];
+	size_t chunkLen;
+	size_t next;
+	bool ended;
+	pc_stream_t stream;
+	/* Global time of the start of the log (ns), and nanoseconds per timestamp count of events and of samples */
+	double offset;
+	double start;
+	double eventPeriod;
+	double samplePeriod;
+	/* Pending item and its global time (ns) */
+	pc_stream_item_t item;
+	pc_event_t event;
+	pc_sample_t sample;
+	double time;
+} pcmerge_input_t;
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s OUTPUT LOG[@<ns>]... [align=<sync|launch>] [symtab=<file>]\n", name);
+	fprintf(stderr, "\tOUTPUT\tmerged timeline (CSV)\n");
+	fprintf(stderr, "\tLOG\traw log saved by the host code (e.g. profcounter.log), optionally followed by its start offset in nanoseconds\n");
+	fprintf(stderr, "\talign\talign logs by their sync records (default) or by their offsets only\n");
+	fprintf(stderr, "\tsymtab\tcheckpoint symbol table used to name the checkpoints (e.g. probe.pcsym)\n");
+}
+
+/* Take the next item of a log, which is marked as ended if there is none */
+static int pcmerge_advance(pcmerge_input_t *input) {
+	int rv = EXIT_SUCCESS;
+
+	while(PC_STREAM_NONE == (input->item = pc_stream_next(&(input->stream), &(input->event), &(input->sample)))) {
+		uint64_t record;
+
+		if(input->next == input->chunkLen) {
+			input->chunkLen = fread(input->chunk, sizeof(uint64_t), PCMERGE_CHUNK, input->file);
+			input->next = 0;
+			ASSERT_CALL(!ferror(input->file), fprintf(stderr, "Error: could not read %s\n", input->fileName); rv = EXIT_FAILURE);
+		}
+
+		/* The log ends at the end of the file or at its first empty record */
+		if(!(input->chunkLen) || PC_REC_EMPTY == PC_RECORD_TAG(input->chunk[input->next])) {
+			input->ended = true;
+			goto _err;
+		}
+
+		record = input->chunk[(input->next)++];
+		ASSERT_CALL(
+			EXIT_SUCCESS == pc_stream_record(&(input->stream), record),
+			fprintf(stderr, "Error: could not decode %s\n", input->fileName); rv = EXIT_FAILURE
+		);
+	}
+
+_err:
+	return rv;
+}
+
+/* Global time of the pending item of an aligned log */
+static void pcmerge_time(pcmerge_input_t *input) {
+	if(PC_STREAM_SAMPLE == input->item)
+		input->time = input->start + input->sample.cycle * input->samplePeriod;
+	else
+		input->time = input->start + input->event.cycle * input->eventPeriod;
+}
+
+/* Place a log on the global time base, once its header, clocks and sync records were decoded */
+static int pcmerge_align(pcmerge_input_t *input, bool sync) {
+	int rv = EXIT_SUCCESS;
+	const pc_header_t *header = &(input->stream.header);
+
+	ASSERT_CALL(input->stream.started, fprintf(stderr, "Error: %s is empty\n", input->fileName); rv = EXIT_FAILURE);
+	ASSERT_CALL(
+		header->kernelClockMHz && (!(header->dutCycles) || header->dutClockMHz),
+		fprintf(stderr, "Error: %s has no clock frequencies\n", input->fileName); rv = EXIT_FAILURE
+	);
+	ASSERT_CALL(
+		!sync || header->synced,
+		fprintf(stderr, "Error: %s has no sync record (use align=launch with offsets)\n", input->fileName); rv = EXIT_FAILURE
+	);
+
+	input->samplePeriod = 1000.0 / header->kernelClockMHz;
+	input->eventPeriod = 1000.0 / (header->dutCycles? header->dutClockMHz : header->kernelClockMHz);
+	input->start = input->offset + (sync? (header->syncCycle * input->samplePeriod) : 0);
+
+_err:
+	return rv;
+}
+
+/* Heap order: earliest item first, then lowest log index */
+static bool pcmerge_before(const pcmerge_input_t *inputs, unsigned a, unsigned b) {
+	return inputs[a].time < inputs[b].time || (inputs[a].time == inputs[b].time && a < b);
+}
+
+static void pcmerge_sift_down(const pcmerge_input_t *inputs, unsigned *heap, unsigned heapLen, unsigned i) {
+	while(true) {
+		unsigned smallest = i;
+		unsigned left = 2 * i + 1;
+		unsigned right = 2 * i + 2;
+		unsigned swap;
+
+		if(left < heapLen && pcmerge_before(inputs, heap[left], heap[smallest]))
+			smallest = left;
+		if(right < heapLen && pcmerge_before(inputs, heap[right], heap[smallest]))
+			smallest = right;
+		if(smallest == i)
+			break;
+
+		swap = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = swap;
+		i = smallest;
+	}
+}
+
+static void pcmerge_print(FILE *f, const pcmerge_input_t *input, unsigned instance, double origin, const pc_symtab_t *symtab) {
+	char name[64];
+
+	fprintf(f, "%.3f,%u,", input->time - origin, instance);
+	if(PC_STREAM_SAMPLE == input->item) {
+		if(input->sample.seen) {
+			fprintf(f, "sample,%u,", input->sample.id);
+			pc_csv_string(f, pc_symbol_name(symtab, input->sample.id, name, sizeof(name)));
+			fprintf(f, ",");
+		}
+		else
+			fprintf(f, "sample,,,");
+		fprintf(f, ",,%" PRIu64 ",%u\n", input->sample.cycle, input->sample.hits);
+	}
+	else {
+		if(PC_EVENT_CHECKPOINT == input->event.type) {
+			fprintf(f, "checkpoint,%u,", input->event.id);
+			pc_csv_string(f, pc_symbol_name(symtab, input->event.id, name, sizeof(name)));
+			fprintf(f, ",");
+		}
+		else
+			fprintf(f, "stamp,,,");
+		if(input->stream.header.ndrange)
+			fprintf(f, "%u,%u,", input->event.group, input->event.local);
+		else
+			fprintf(f, ",,");
+		fprintf(f, "%" PRIu64 ",\n", input->event.cycle);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	int rv = EXIT_SUCCESS;
+	int i;
+	unsigned j;
+	bool sync = true;
+	const char *symtabFileName = NULL;
+	pc_symtab_t symtab = {0};
+	pcmerge_input_t *inputs = NULL;
+	unsigned inputsLen = 0;
+	unsigned *heap = NULL;
+	unsigned heapLen = 0;
+	double origin = 0;
+	FILE *outFile = NULL;
+
+	ASSERT_CALL(argc >= 3, usage(argv[0]); rv = EXIT_FAILURE);
+	inputs = calloc(argc - 2, sizeof(pcmerge_input_t));
+	heap = malloc((argc - 2) * sizeof(unsigned));
+	ASSERT_CALL(inputs && heap, fprintf(stderr, "Error: could not allocate memory for the logs.\n"); rv = EXIT_FAILURE);
+
+	for(i = 2; i < argc; i++) {
+		if(!strncmp(argv[i], "align=", 6)) {
+			ASSERT_CALL(!strcmp(argv[i] + 6, "sync") || !strcmp(argv[i] + 6, "launch"), usage(argv[0]); rv = EXIT_FAILURE);
+			sync = !strcmp(argv[i] + 6, "sync");
+		}
+		else if(!strncmp(argv[i], "symtab=", 7)) {
+			symtabFileName = argv[i] + 7;
+		}
+		else {
+			pcmerge_input_t *input = &(inputs[inputsLen++]);
+			char *at = strrchr(argv[i], '@');
+			char *end = NULL;
+			double offset = 0;
+
+			/* The offset is split from the file name in place, only if all that follows the last '@' is a number. Otherwise, '@' is */
+			/* part of the file name */
+			if(at && at[1] && strchr("+-.0123456789", at[1]))
+				offset = strtod(at + 1, &end);
+			if(end && !(*end) && isfinite(offset)) {
+				*at = '\0';
+				input->offset = offset;
+			}
+			input->fileName = argv[i];
+			pc_stream_init(&(input->stream));
+			input->file = fopen(input->fileName, "rb");
+			ASSERT_CALL(input->file, fprintf(stderr, "Error: %s: %s\n", strerror(errno), input->fileName); rv = EXIT_FAILURE);
+		}
+	}
+	ASSERT_CALL(inputsLen, fprintf(stderr, "Error: no log was provided.\n"); rv = EXIT_FAILURE);
+
+	if(symtabFileName)
+		ASSERT_CALL(EXIT_SUCCESS == pc_symtab_load(symtabFileName, &symtab), rv = EXIT_FAILURE);
+
+	/* Decode every log up to its first item, which follows the records needed to align it */
+	for(j = 0; j < inputsLen; j++) {
+		ASSERT_CALL(EXIT_SUCCESS == pcmerge_advance(&(inputs[j])), rv = EXIT_FAILURE);
+		ASSERT_CALL(EXIT_SUCCESS == pcmerge_align(&(inputs[j]), sync), rv = EXIT_FAILURE);
+		if(!j || inputs[j].start < origin)
+			origin = inputs[j].start;
+
+		if(!(inputs[j].ended)) {
+			pcmerge_time(&(inputs[j]));
+			heap[heapLen++] = j;
+		}
+	}
+	for(j = heapLen; j--;)
+		pcmerge_sift_down(inputs, heap, heapLen, j);
+
+	outFile = fopen(argv[1], "w");
+	ASSERT_CALL(outFile, fprintf(stderr, "Error: %s: %s\n", strerror(errno), argv[1]); rv = EXIT_FAILURE);
+	fprintf(outFile, "time_ns,instance,type,id,name,group,local,cycle,hits\n");
+
+	/* Print the earliest pending item, then replace it by the next item of its log */
+	while(heapLen) {
+		pcmerge_input_t *input = &(inputs[heap[0]]);
+
+		pcmerge_print(outFile, input, heap[0], origin, &symtab);
+		ASSERT_CALL(EXIT_SUCCESS == pcmerge_advance(input), rv = EXIT_FAILURE);
+		if(input->ended)
+			heap[0] = heap[--heapLen];
+		else
+			pcmerge_time(input);
+		pcmerge_sift_down(inputs, heap, heapLen, 0);
+	}
+
+_err:
+	if(outFile)
+		fclose(outFile);
+	for(j = 0; inputs && j < inputsLen; j++) {
+		if(inputs[j].file)
+			fclose(inputs[j].file);
+	}
+	if(heap)
+		free(heap);
+	if(inputs)
+		free(inputs);
+	pc_symtab_free(&symtab);
+
+	return rv;
+}
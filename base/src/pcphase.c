@@ -0,0 +1,345 @@
+/**
+ * ProfCounter per-iteration phase analysis
+ *
+ * Loop-structured kernels issue the same checkpoint sequence at every iteration of their outer loop (e.g. "level start" and "level
+ * end" for each BFS level). This analyser picks an anchor checkpoint (the most frequent one by default), segments the trace into
+ * iterations starting at each anchor occurrence, and finds the dominant checkpoint sequence of an iteration. The resulting latency
+ * series is summarised (spread, trend, dominant iterations) and can be correlated with a per-iteration payload provided by the host.
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "pcphase.h"
+
+/* Maximum number of transitions of the dominant sequence broken down in pc_print_phases() */
+#define PC_PHASE_MAX_COLUMNS 4
+/* Maximum number of dominant iterations reported by pc_print_phases() */
+#define PC_PHASE_MAX_DOMINANT 5
+
+/* FNV-1a hash of a checkpoint sequence, used to find the dominant sequence */
+static uint64_t pc_phase_hash(const pc_trace_t *trace, const size_t *checkpoints, size_t checkpointsLen) {
+	size_t i;
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for(i = 0; i < checkpointsLen; i++) {
+		hash ^= trace->events[checkpoints[i]].id;
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash ^ checkpointsLen;
+}
+
+static int pc_phase_compare_hashes(const void *a, const void *b) {
+	uint64_t hashA = *((const uint64_t *) a);
+	uint64_t hashB = *((const uint64_t *) b);
+
+	return (hashA > hashB) - (hashA < hashB);
+}
+
+/* Check if a checkpoint sequence starts with the dominant sequence */
+static bool pc_phase_matches(const pc_phases_t *phases, const pc_trace_t *trace, const size_t *checkpoints, size_t checkpointsLen) {
+	size_t i;
+
+	if(checkpointsLen < phases->patternLen)
+		return false;
+
+	for(i = 0; i < phases->patternLen; i++) {
+		if(trace->events[checkpoints[i]].id != phases->pattern[i])
+			return false;
+	}
+
+	return true;
+}
+
+int pc_phase_analyse(const pc_trace_t *trace, int anchor, pc_phases_t *phases) {
+	int rv = EXIT_SUCCESS;
+	size_t i, j;
+	size_t *checkpoints = NULL;
+	size_t checkpointsLen = 0;
+	size_t *starts = NULL;
+	uint64_t *hashes = NULL;
+	uint64_t *sortedHashes = NULL;
+	size_t count[128] = {0};
+	size_t firstSeen[128];
+	uint64_t modeHash = 0;
+	size_t modeCount = 0;
+	size_t candidates;
+	double sum = 0;
+	double sumSquares = 0;
+	double meanIndex;
+	double covariance = 0;
+	double varianceIndex = 0;
+
+	memset(phases, 0, sizeof(pc_phases_t));
+
+	/* Only checkpoints delimit phases, stamps are ignored */
+	checkpoints = malloc((trace->eventsLen + 1) * sizeof(size_t));
+	ASSERT_CALL(checkpoints, fprintf(stderr, "Error: could not allocate memory for phase analysis.\n"); rv = EXIT_FAILURE);
+	for(i = 0; i < trace->eventsLen; i++) {
+		if(PC_EVENT_CHECKPOINT != trace->events[i].type)
+			continue;
+
+		if(!count[trace->events[i].id])
+			firstSeen[trace->events[i].id] = checkpointsLen;
+		(count[trace->events[i].id])++;
+		checkpoints[checkpointsLen++] = i;
+	}
+
+	/* Most frequent checkpoint, the earliest in case of a tie */
+	if(PC_PHASE_AUTO_ANCHOR == anchor) {
+		for(i = 0; i < 128; i++) {
+			if(count[i] > 1 && (PC_PHASE_AUTO_ANCHOR == anchor || count[i] > count[anchor] || (count[i] == count[anchor] && firstSeen[i] < firstSeen[anchor])))
+				anchor = i;
+		}
+		ASSERT_CALL(anchor != PC_PHASE_AUTO_ANCHOR, fprintf(stderr, "Error: no repeating checkpoint found.\n"); rv = EXIT_FAILURE);
+	}
+	ASSERT_CALL(anchor >= 0 && anchor < 128 && count[anchor], fprintf(stderr, "Error: anchor checkpoint %d not found.\n", anchor); rv = EXIT_FAILURE);
+	phases->anchor = anchor;
+
+	/* Iterations start at every anchor occurrence */
+	starts = malloc((count[anchor] + 1) * sizeof(size_t));
+	hashes = malloc(count[anchor] * sizeof(uint64_t));
+	sortedHashes = malloc(count[anchor] * sizeof(uint64_t));
+	phases->iterations = calloc(count[anchor], sizeof(pc_iteration_t));
+	ASSERT_CALL(starts && hashes && sortedHashes && phases->iterations, fprintf(stderr, "Error: could not allocate memory for phase analysis.\n"); rv = EXIT_FAILURE);
+	for(i = 0; i < checkpointsLen; i++) {
+		if(trace->events[checkpoints[i]].id == (unsigned) anchor)
+			starts[(phases->iterationsLen)++] = i;
+	}
+	starts[phases->iterationsLen] = checkpointsLen;
+
+	/* Dominant sequence. The last iteration is only a candidate if it is the only one, as it may contain trailing checkpoints */
+	candidates = (phases->iterationsLen > 1)? (phases->iterationsLen - 1) : 1;
+	for(i = 0; i < phases->iterationsLen; i++)
+		hashes[i] = pc_phase_hash(trace, &(checkpoints[starts[i]]), starts[i + 1] - starts[i]);
+	memcpy(sortedHashes, hashes, candidates * sizeof(uint64_t));
+	qsort(sortedHashes, candidates, sizeof(uint64_t), pc_phase_compare_hashes);
+	for(i = 0; i < candidates; i = j) {
+		for(j = i + 1; j < candidates && sortedHashes[j] == sortedHashes[i]; j++)
+			continue;
+		if(j - i > modeCount) {
+			modeCount = j - i;
+			modeHash = sortedHashes[i];
+		}
+	}
+	for(i = 0; hashes[i] != modeHash; i++)
+		continue;
+	phases->patternLen = starts[i + 1] - starts[i];
+	phases->pattern = malloc(phases->patternLen * sizeof(unsigned));
+	ASSERT_CALL(phases->pattern, fprintf(stderr, "Error: could not allocate memory for phase analysis.\n"); rv = EXIT_FAILURE);
+	for(j = 0; j < phases->patternLen; j++)
+		phases->pattern[j] = trace->events[checkpoints[starts[i] + j]].id;
+
+	for(i = 0; i < phases->iterationsLen; i++) {
+		pc_iteration_t *iteration = &(phases->iterations[i]);
+		size_t len = starts[i + 1] - starts[i];
+		uint64_t end;
+
+		iteration->firstEvent = checkpoints[starts[i]];
+		iteration->start = trace->events[iteration->firstEvent].cycle;
+		iteration->checkpointsLen = len;
+		iteration->regular = (len == phases->patternLen) && pc_phase_matches(phases, trace, &(checkpoints[starts[i]]), len);
+
+		/* Iterations end when the next one starts */
+		if(i + 1 < phases->iterationsLen) {
+			end = trace->events[checkpoints[starts[i + 1]]].cycle;
+		}
+		/* The last iteration ends at the checkpoint that follows the dominant sequence, the rest is epilogue */
+		else if(len > phases->patternLen && pc_phase_matches(phases, trace, &(checkpoints[starts[i]]), len)) {
+			iteration->checkpointsLen = phases->patternLen;
+			iteration->regular = true;
+			end = trace->events[checkpoints[starts[i] + phases->patternLen]].cycle;
+		}
+		else {
+			end = trace->events[checkpoints[starts[i + 1] - 1]].cycle;
+		}
+
+		iteration->latency = end - iteration->start;
+		if(iteration->regular)
+			(phases->regularLen)++;
+		if(!i || iteration->latency < phases->min)
+			phases->min = iteration->latency;
+		if(!i || iteration->latency > phases->max) {
+			phases->max = iteration->latency;
+			phases->slowest = i;
+		}
+		phases->total += iteration->latency;
+		sum += iteration->latency;
+		sumSquares += (double) iteration->latency * iteration->latency;
+
+		if(i + 1 == phases->iterationsLen)
+			phases->epilogue = trace->events[trace->eventsLen - 1].cycle - end;
+	}
+	phases->prologue = phases->iterations[0].start - trace->events[0].cycle;
+
+	phases->mean = sum / phases->iterationsLen;
+	phases->stddev = sqrt(fmax(0, (sumSquares / phases->iterationsLen) - (phases->mean * phases->mean)));
+
+	/* Least-squares trend of latency over the iteration index */
+	meanIndex = (phases->iterationsLen - 1) / 2.0;
+	for(i = 0; i < phases->iterationsLen; i++) {
+		covariance += (i - meanIndex) * (phases->iterations[i].latency - phases->mean);
+		varianceIndex += (i - meanIndex) * (i - meanIndex);
+	}
+	phases->trend = (varianceIndex > 0)? (covariance / varianceIndex) : 0;
+
+_err:
+	if(checkpoints)
+		free(checkpoints);
+	if(starts)
+		free(starts);
+	if(hashes)
+		free(hashes);
+	if(sortedHashes)
+		free(sortedHashes);
+	if(EXIT_FAILURE == rv)
+		pc_phases_free(phases);
+
+	return rv;
+}
+
+void pc_phases_free(pc_phases_t *phases) {
+	if(phases->pattern)
+		free(phases->pattern);
+	if(phases->iterations)
+		free(phases->iterations);
+	memset(phases, 0, sizeof(pc_phases_t));
+}
+
+double pc_phase_correlate(const pc_phases_t *phases, const double *values, size_t valuesLen) {
+	size_t i;
+	size_t n = (valuesLen < phases->iterationsLen)? valuesLen : phases->iterationsLen;
+	double meanLatency = 0;
+	double meanValue = 0;
+	double covariance = 0;
+	double varianceLatency = 0;
+	double varianceValue = 0;
+
+	if(n < 3)
+		return NAN;
+
+	for(i = 0; i < n; i++) {
+		meanLatency += phases->iterations[i].latency;
+		meanValue += values[i];
+	}
+	meanLatency /= n;
+	meanValue /= n;
+
+	for(i = 0; i < n; i++) {
+		double dLatency = phases->iterations[i].latency - meanLatency;
+		double dValue = values[i] - meanValue;
+
+		covariance += dLatency * dValue;
+		varianceLatency += dLatency * dLatency;
+		varianceValue += dValue * dValue;
+	}
+
+	if(varianceLatency <= 0 || varianceValue <= 0)
+		return NAN;
+
+	return covariance / sqrt(varianceLatency * varianceValue);
+}
+
+void pc_print_phases(FILE *f, const pc_phases_t *phases, const pc_trace_t *trace, const pc_symtab_t *symtab, const double *values, size_t valuesLen) {
+	size_t i, j, k;
+	char name[64];
+	char nextName[64];
+	size_t dominant[PC_PHASE_MAX_DOMINANT];
+	size_t dominantLen = 0;
+	uint64_t dominantTotal = 0;
+	size_t columns = (phases->patternLen <= PC_PHASE_MAX_COLUMNS)? phases->patternLen : 0;
+	double correlation = values? pc_phase_correlate(phases, values, valuesLen) : NAN;
+
+	fprintf(f, "Per-iteration analysis (anchor: %s, %zu iterations, %zu following the dominant sequence):\n",
+		pc_symbol_name(symtab, phases->anchor, name, sizeof(name)), phases->iterationsLen, phases->regularLen);
+	fprintf(f, "Dominant sequence:");
+	for(i = 0; i < phases->patternLen; i++)
+		fprintf(f, "%s%s", i? " -> " : " ", pc_symbol_name(symtab, phases->pattern[i], name, sizeof(name)));
+	fprintf(f, "\n");
+	fprintf(f, "Cycles: %" PRIu64 " in iterations, %" PRIu64 " of prologue, %" PRIu64 " of epilogue\n", phases->total, phases->prologue, phases->epilogue);
+	fprintf(
+		f, "Latency: mean %.1f, stddev %.1f (%.1f%%), min %" PRIu64 ", max %" PRIu64 " (iteration %zu), trend %+.2f cycles per iteration\n",
+		phases->mean, phases->stddev, (phases->mean > 0)? (100 * phases->stddev / phases->mean) : 0, phases->min,
+		phases->max, phases->slowest, phases->trend
+	);
+
+	/* Dominant iterations: the slowest ones that together account for at least half of the time spent in iterations */
+	while(dominantLen < PC_PHASE_MAX_DOMINANT && dominantLen < phases->iterationsLen && 2 * dominantTotal < phases->total) {
+		size_t slowest = phases->iterationsLen;
+
+		for(i = 0; i < phases->iterationsLen; i++) {
+			for(j = 0; j < dominantLen && dominant[j] != i; j++)
+				continue;
+			if(j == dominantLen && (slowest == phases->iterationsLen || phases->iterations[i].latency > phases->iterations[slowest].latency))
+				slowest = i;
+		}
+
+		dominant[dominantLen++] = slowest;
+		dominantTotal += phases->iterations[slowest].latency;
+	}
+	fprintf(f, "Dominant iterations:");
+	for(i = 0; i < dominantLen; i++)
+		fprintf(f, " %zu (%.1f%%)", dominant[i], phases->total? (100.0 * phases->iterations[dominant[i]].latency / phases->total) : 0);
+	fprintf(f, "\n");
+
+	if(values) {
+		if(isnan(correlation))
+			fprintf(f, "Correlation between latency and payload: n/a\n");
+		else
+			fprintf(f, "Correlation between latency and payload: %+.3f\n", correlation);
+	}
+
+	/* Transitions of the dominant sequence */
+	for(k = 0; k < columns; k++) {
+		pc_symbol_name(symtab, phases->pattern[k], name, sizeof(name));
+		pc_symbol_name(symtab, (k + 1 < phases->patternLen)? phases->pattern[k + 1] : phases->anchor, nextName, sizeof(nextName));
+		fprintf(f, "Phase %zu: %s -> %s\n", k, name, (k + 1 < phases->patternLen)? nextName : "(next iteration)");
+	}
+
+	fprintf(f, "|  Iter |      Start |    Latency |  Share |");
+	for(k = 0; k < columns; k++)
+		fprintf(f, "    Phase %zu |", k);
+	fprintf(f, values? "      Payload |\n" : "\n");
+
+	for(i = 0; i < phases->iterationsLen; i++) {
+		const pc_iteration_t *iteration = &(phases->iterations[i]);
+		uint64_t previous = iteration->start;
+		size_t event = iteration->firstEvent;
+
+		fprintf(
+			f, "| %5zu | %10" PRIu64 " | %10" PRIu64 " | %5.1f%% |", i, (iteration->start - trace->events[0].cycle),
+			iteration->latency, phases->total? (100.0 * iteration->latency / phases->total) : 0
+		);
+
+		/* Irregular iterations are not broken down */
+		for(k = 0; k < columns; k++) {
+			uint64_t next;
+
+			if(!iteration->regular) {
+				fprintf(f, " %10s |", "--");
+				continue;
+			}
+
+			if(k + 1 < columns) {
+				for(event++; PC_EVENT_CHECKPOINT != trace->events[event].type; event++)
+					continue;
+				next = trace->events[event].cycle;
+			}
+			else {
+				next = iteration->start + iteration->latency;
+			}
+
+			fprintf(f, " %10" PRIu64 " |", (next - previous));
+			previous = next;
+		}
+
+		if(values && i < valuesLen)
+			fprintf(f, " %12.0f |\n", values[i]);
+		else
+			fprintf(f, values? " %12s |\n" : "\n", "--");
+	}
+}
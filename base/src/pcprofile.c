@@ -0,0 +1,359 @@
+/**
+ * ProfCounter performance profiles
+ *
+ * A profile holds the cycle distribution (sample count, mean, variance, extremes) of every region of a kernel, where a region is
+ * the transition between two consecutive checkpoints. Profiles accumulate any number of traces and can be saved as baselines.
+ * Comparing a profile against a baseline uses Welch's t-test on each region, so that only significant changes are reported.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "pcprofile.h"
+
+/* Continued fraction of the regularised incomplete beta function (modified Lentz's method) */
+static double pc_betacf(double a, double b, double x) {
+	int m;
+	double c = 1;
+	double d = 1 - (a + b) * x / (a + 1);
+	double h;
+
+	d = (fabs(d) < 1e-300)? 1e300 : (1 / d);
+	h = d;
+
+	for(m = 1; m <= 300; m++) {
+		double aa;
+		double delta;
+
+		aa = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+		d = 1 + aa * d;
+		d = (fabs(d) < 1e-300)? 1e300 : (1 / d);
+		c = 1 + aa / c;
+		c = (fabs(c) < 1e-300)? 1e-300 : c;
+		h *= d * c;
+
+		aa = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+		d = 1 + aa * d;
+		d = (fabs(d) < 1e-300)? 1e300 : (1 / d);
+		c = 1 + aa / c;
+		c = (fabs(c) < 1e-300)? 1e-300 : c;
+		delta = d * c;
+		h *= delta;
+
+		if(fabs(delta - 1) < 1e-12)
+			break;
+	}
+
+	return h;
+}
+
+/* Regularised incomplete beta function I_x(a, b) */
+static double pc_betai(double a, double b, double x) {
+	double front;
+
+	if(x <= 0)
+		return 0;
+	if(x >= 1)
+		return 1;
+
+	front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1 - x));
+
+	return (x < (a + 1) / (a + b + 2))? (front * pc_betacf(a, b, x) / a) : (1 - front * pc_betacf(b, a, 1 - x) / b);
+}
+
+/* Probability that a Student's t variable with df degrees of freedom is greater than t */
+static double pc_student_sf(double t, double df) {
+	double tail = 0.5 * pc_betai(df / 2, 0.5, df / (df + t * t));
+
+	return (t > 0)? tail : (1 - tail);
+}
+
+/* One-sided Welch's t-test: p-value of the hypothesis that the mean of current is greater than the mean of baseline */
+static double pc_welch_greater(const pc_region_t *baseline, const pc_region_t *current) {
+	/* Squared standard errors of the means, from the unbiased variance estimates */
+	double varBaseline = (baseline->samples > 1)? (baseline->variance / (baseline->samples - 1)) : 0;
+	double varCurrent = (current->samples > 1)? (current->variance / (current->samples - 1)) : 0;
+	double stdError2 = varBaseline + varCurrent;
+	double df;
+
+	/* No variability at all (e.g. a deterministic pipeline): any difference is significant */
+	if(stdError2 <= 0)
+		return (current->mean > baseline->mean)? 0 : 1;
+
+	df = (stdError2 * stdError2) / (
+		((baseline->samples > 1)? (varBaseline * varBaseline / (baseline->samples - 1)) : 0) +
+		((current->samples > 1)? (varCurrent * varCurrent / (current->samples - 1)) : 0)
+	);
+
+	return pc_student_sf((current->mean - baseline->mean) / sqrt(stdError2), df);
+}
+
+/* Accumulate the transitions of a single instruction stream (i.e. of one work-item) */
+static int pc_profile_add_events(pc_profile_t *profile, const pc_trace_t *trace) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+	const pc_event_t *previous = NULL;
+
+	for(i = 0; i < trace->eventsLen; i++) {
+		const pc_event_t *event = &(trace->events[i]);
+		pc_region_t *region;
+		uint64_t length;
+		double delta;
+
+		if(PC_EVENT_CHECKPOINT != event->type)
+			continue;
+
+		if(!previous) {
+			previous = event;
+			continue;
+		}
+
+		region = (pc_region_t *) pc_profile_lookup(profile, previous->id, event->id);
+		if(!region) {
+			pc_region_t *regions = realloc(profile->regions, (profile->regionsLen + 1) * sizeof(pc_region_t));
+
+			ASSERT_CALL(regions, fprintf(stderr, "Error: could not allocate memory for profile.\n"); rv = EXIT_FAILURE);
+			profile->regions = regions;
+			region = &(profile->regions[(profile->regionsLen)++]);
+			memset(region, 0, sizeof(pc_region_t));
+			region->from = previous->id;
+			region->to = event->id;
+		}
+
+		/* Welford's online update of mean and variance */
+		length = event->cycle - previous->cycle;
+		(region->samples)++;
+		delta = length - region->mean;
+		region->mean += delta / region->samples;
+		region->variance += (delta * (length - region->mean) - region->variance) / region->samples;
+		if(1 == region->samples || length < region->min)
+			region->min = length;
+		if(1 == region->samples || length > region->max)
+			region->max = length;
+
+		previous = event;
+	}
+
+_err:
+
+	return rv;
+}
+
+int pc_profile_add(pc_profile_t *profile, const pc_trace_t *trace) {
+	int rv = EXIT_SUCCESS;
+	pc_trace_t *items = NULL;
+	size_t itemsLen = 0;
+	size_t i;
+
+	/* Checkpoints of different work-items interleave in NDRange logs, transitions are only taken within each work-item */
+	if(trace->header.ndrange) {
+		ASSERT_CALL(EXIT_SUCCESS == pc_trace_split(trace, true, &items, &itemsLen), rv = EXIT_FAILURE);
+		for(i = 0; i < itemsLen; i++)
+			ASSERT_CALL(EXIT_SUCCESS == pc_profile_add_events(profile, &(items[i])), rv = EXIT_FAILURE);
+	}
+	else {
+		ASSERT_CALL(EXIT_SUCCESS == pc_profile_add_events(profile, trace), rv = EXIT_FAILURE);
+	}
+
+	(profile->runs)++;
+
+_err:
+	if(items) {
+		for(i = 0; i < itemsLen; i++)
+			pc_trace_free(&(items[i]));
+		free(items);
+	}
+
+	return rv;
+}
+
+void pc_profile_free(pc_profile_t *profile) {
+	if(profile->regions)
+		free(profile->regions);
+	profile->regions = NULL;
+	profile->regionsLen = 0;
+	profile->runs = 0;
+}
+
+const pc_region_t *pc_profile_lookup(const pc_profile_t *profile, unsigned from, unsigned to) {
+	size_t i;
+
+	for(i = 0; i < profile->regionsLen; i++) {
+		if(from == profile->regions[i].from && to == profile->regions[i].to)
+			return &(profile->regions[i]);
+	}
+
+	return NULL;
+}
+
+int pc_profile_save(const char *fileName, const pc_profile_t *profile) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+	FILE *profFile = fopen(fileName, "w");
+
+	ASSERT_CALL(profFile, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+
+	fprintf(profFile, "# ProfCounter profile baseline\n");
+	fprintf(profFile, "runs %zu\n", profile->runs);
+	fprintf(profFile, "regions %zu\n", profile->regionsLen);
+	for(i = 0; i < profile->regionsLen; i++) {
+		const pc_region_t *region = &(profile->regions[i]);
+
+		fprintf(
+			profFile, "region %u %u %zu %.17g %.17g %" PRIu64 " %" PRIu64 "\n", region->from, region->to, region->samples, region->mean,
+			region->variance, region->min, region->max
+		);
+	}
+
+_err:
+	if(profFile)
+		fclose(profFile);
+
+	return rv;
+}
+
+int pc_profile_load(const char *fileName, pc_profile_t *profile) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+	FILE *profFile = fopen(fileName, "r");
+
+	memset(profile, 0, sizeof(pc_profile_t));
+	ASSERT_CALL(profFile, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+
+	ASSERT_CALL(
+		2 == fscanf(profFile, "# ProfCounter profile baseline runs %zu regions %zu", &(profile->runs), &(profile->regionsLen)),
+		fprintf(stderr, "Error: malformed baseline file: %s\n", fileName); rv = EXIT_FAILURE
+	);
+
+	profile->regions = calloc(profile->regionsLen? profile->regionsLen : 1, sizeof(pc_region_t));
+	ASSERT_CALL(profile->regions, fprintf(stderr, "Error: could not allocate memory for profile.\n"); rv = EXIT_FAILURE);
+
+	for(i = 0; i < profile->regionsLen; i++) {
+		pc_region_t *region = &(profile->regions[i]);
+
+		ASSERT_CALL(
+			7 == fscanf(
+				profFile, " region %u %u %zu %lf %lf %" SCNu64 " %" SCNu64, &(region->from), &(region->to), &(region->samples),
+				&(region->mean), &(region->variance), &(region->min), &(region->max)
+			),
+			fprintf(stderr, "Error: malformed baseline file: %s\n", fileName); rv = EXIT_FAILURE
+		);
+	}
+
+_err:
+	if(profFile)
+		fclose(profFile);
+	if(EXIT_FAILURE == rv)
+		pc_profile_free(profile);
+
+	return rv;
+}
+
+int pc_profile_compare(
+	const pc_profile_t *baseline, const pc_profile_t *current, double threshold, double alpha,
+	pc_comparison_t **comparisons, size_t *comparisonsLen
+) {
+	int regressions = 0;
+	size_t i;
+
+	*comparisonsLen = 0;
+	*comparisons = malloc((baseline->regionsLen + current->regionsLen + 1) * sizeof(pc_comparison_t));
+	ASSERT_CALL(*comparisons, fprintf(stderr, "Error: could not allocate memory for comparison.\n"); regressions = -1);
+
+	/* Regions of the baseline, in baseline order */
+	for(i = 0; i < baseline->regionsLen; i++) {
+		pc_comparison_t *comparison = &((*comparisons)[(*comparisonsLen)++]);
+		const pc_region_t *region = pc_profile_lookup(current, baseline->regions[i].from, baseline->regions[i].to);
+
+		memset(comparison, 0, sizeof(pc_comparison_t));
+		comparison->from = baseline->regions[i].from;
+		comparison->to = baseline->regions[i].to;
+		comparison->baseline = baseline->regions[i];
+		comparison->pValue = 1;
+
+		if(!region) {
+			comparison->verdict = PC_REGION_MISSING;
+			continue;
+		}
+		comparison->current = *region;
+
+		if(comparison->baseline.mean > 0)
+			comparison->change = (comparison->current.mean - comparison->baseline.mean) / comparison->baseline.mean;
+		else
+			comparison->change = (comparison->current.mean > 0)? INFINITY : 0;
+
+		if(comparison->current.mean >= comparison->baseline.mean) {
+			comparison->pValue = pc_welch_greater(&(comparison->baseline), &(comparison->current));
+			if(comparison->change > threshold && comparison->pValue < alpha) {
+				comparison->verdict = PC_REGION_REGRESSED;
+				regressions++;
+			}
+		}
+		else {
+			comparison->pValue = pc_welch_greater(&(comparison->current), &(comparison->baseline));
+			if(-(comparison->change) > threshold && comparison->pValue < alpha)
+				comparison->verdict = PC_REGION_IMPROVED;
+		}
+	}
+
+	/* Regions that are not present in the baseline */
+	for(i = 0; i < current->regionsLen; i++) {
+		pc_comparison_t *comparison;
+
+		if(pc_profile_lookup(baseline, current->regions[i].from, current->regions[i].to))
+			continue;
+
+		comparison = &((*comparisons)[(*comparisonsLen)++]);
+		memset(comparison, 0, sizeof(pc_comparison_t));
+		comparison->from = current->regions[i].from;
+		comparison->to = current->regions[i].to;
+		comparison->current = current->regions[i];
+		comparison->pValue = 1;
+		comparison->verdict = PC_REGION_NEW;
+	}
+
+_err:
+
+	return regressions;
+}
+
+void pc_print_comparison(FILE *f, const pc_comparison_t *comparisons, size_t comparisonsLen, const pc_symtab_t *symtab) {
+	size_t i;
+	const char *verdicts[] = {"", "improved", "REGRESSED", "new", "missing"};
+	char fromName[64];
+	char toName[64];
+
+	fprintf(f, "|                                          | Baseline                | Current                 |          |          |           |\n");
+	fprintf(f, "| Region                                   |   Samples |        Mean |   Samples |        Mean |   Change |  p-value |           |\n");
+	for(i = 0; i < comparisonsLen; i++) {
+		const pc_comparison_t *comparison = &(comparisons[i]);
+		char region[128];
+
+		snprintf(
+			region, sizeof(region), "%s -> %s", pc_symbol_name(symtab, comparison->from, fromName, sizeof(fromName)),
+			pc_symbol_name(symtab, comparison->to, toName, sizeof(toName))
+		);
+		fprintf(f, "| %-40.40s |", region);
+
+		if(comparison->baseline.samples)
+			fprintf(f, " %9zu | %11.1f |", comparison->baseline.samples, comparison->baseline.mean);
+		else
+			fprintf(f, " %9s | %11s |", "--", "--");
+
+		if(comparison->current.samples)
+			fprintf(f, " %9zu | %11.1f |", comparison->current.samples, comparison->current.mean);
+		else
+			fprintf(f, " %9s | %11s |", "--", "--");
+
+		if(comparison->baseline.samples && comparison->current.samples)
+			fprintf(f, " %+7.2f%% | %8.2g |", 100 * comparison->change, comparison->pValue);
+		else
+			fprintf(f, " %8s | %8s |", "--", "--");
+
+		fprintf(f, " %-9s |\n", verdicts[comparison->verdict]);
+	}
+}
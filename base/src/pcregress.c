@@ -0,0 +1,120 @@
+/**
+ * ProfCounter performance regression tool
+ *
+ * Builds a profile (per-region cycle distributions, see pcprofile.h) from raw logs saved by the host code (profcounter.log), and
+ * either saves it as a baseline or compares it against a previously saved baseline:
+ *
+ * pcregress save BASELINE LOG...
+ * pcregress compare BASELINE LOG... [threshold=<percent>] [alpha=<level>] [symtab=<file>]
+ *
+ * When comparing, the exit status is 0 if no region regressed, 2 if at least one region regressed, and 1 on errors. This allows
+ * this tool to be used as a performance gate in regression flows.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "pcdecoder.h"
+#include "pcprofile.h"
+
+/* Exit status when at least one region regressed */
+#define PCREGRESS_EXIT_REGRESSION 2
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s save BASELINE LOG...\n", name);
+	fprintf(stderr, "       %s compare BASELINE LOG... [threshold=<percent>] [alpha=<level>] [symtab=<file>]\n", name);
+	fprintf(stderr, "\tBASELINE\tbaseline profile file\n");
+	fprintf(stderr, "\tLOG\traw log saved by the host code (e.g. profcounter.log). Multiple logs are accumulated\n");
+	fprintf(stderr, "\tthreshold\tminimum change of a region mean to be reported, in percent (default is 5)\n");
+	fprintf(stderr, "\talpha\tsignificance level of the t-test (default is 0.01)\n");
+	fprintf(stderr, "\tsymtab\tcheckpoint symbol table used to name the regions (e.g. probe.pcsym)\n");
+}
+
+int main(int argc, char *argv[]) {
+	int rv = EXIT_SUCCESS;
+	int i;
+	int regressions;
+	bool saveMode;
+	double threshold = 5;
+	double alpha = 0.01;
+	const char *symtabFileName = NULL;
+	uint64_t *log = NULL;
+	size_t logLen;
+	pc_trace_t trace = {0};
+	pc_profile_t current = {0};
+	pc_profile_t baseline = {0};
+	pc_symtab_t symtab = {0};
+	pc_comparison_t *comparisons = NULL;
+	size_t comparisonsLen;
+
+	ASSERT_CALL(argc >= 4, usage(argv[0]); rv = EXIT_FAILURE);
+	ASSERT_CALL(!strcmp(argv[1], "save") || !strcmp(argv[1], "compare"), usage(argv[0]); rv = EXIT_FAILURE);
+	saveMode = !strcmp(argv[1], "save");
+
+	/* Accumulate all logs into the current profile */
+	for(i = 3; i < argc; i++) {
+		if(!strncmp(argv[i], "threshold=", 10)) {
+			threshold = strtod(argv[i] + 10, NULL);
+			continue;
+		}
+		if(!strncmp(argv[i], "alpha=", 6)) {
+			alpha = strtod(argv[i] + 6, NULL);
+			continue;
+		}
+		if(!strncmp(argv[i], "symtab=", 7)) {
+			symtabFileName = argv[i] + 7;
+			continue;
+		}
+
+		ASSERT_CALL(EXIT_SUCCESS == pc_log_load(argv[i], &log, &logLen), rv = EXIT_FAILURE);
+		ASSERT_CALL(EXIT_SUCCESS == pc_decode(log, logLen, &trace), fprintf(stderr, "Error: could not decode %s\n", argv[i]); rv = EXIT_FAILURE);
+		ASSERT_CALL(EXIT_SUCCESS == pc_profile_add(&current, &trace), rv = EXIT_FAILURE);
+
+		pc_trace_free(&trace);
+		free(log);
+		log = NULL;
+	}
+	ASSERT_CALL(current.runs, fprintf(stderr, "Error: no log was provided.\n"); rv = EXIT_FAILURE);
+
+	if(saveMode) {
+		ASSERT_CALL(EXIT_SUCCESS == pc_profile_save(argv[2], &current), rv = EXIT_FAILURE);
+		printf("Baseline with %zu region(s) over %zu run(s) saved to %s.\n", current.regionsLen, current.runs, argv[2]);
+	}
+	else {
+		ASSERT_CALL(EXIT_SUCCESS == pc_profile_load(argv[2], &baseline), rv = EXIT_FAILURE);
+		if(symtabFileName)
+			ASSERT_CALL(EXIT_SUCCESS == pc_symtab_load(symtabFileName, &symtab), fprintf(stderr, "Error: could not load %s\n", symtabFileName); rv = EXIT_FAILURE);
+
+		regressions = pc_profile_compare(&baseline, &current, threshold / 100, alpha, &comparisons, &comparisonsLen);
+		ASSERT_CALL(regressions >= 0, rv = EXIT_FAILURE);
+
+		printf(
+			"Comparing %zu run(s) against baseline %s (%zu run(s)), threshold %.2f%%, alpha %g:\n",
+			current.runs, argv[2], baseline.runs, threshold, alpha
+		);
+		pc_print_comparison(stdout, comparisons, comparisonsLen, &symtab);
+
+		if(regressions) {
+			printf("%d region(s) regressed.\n", regressions);
+			rv = PCREGRESS_EXIT_REGRESSION;
+		}
+		else {
+			printf("No region regressed.\n");
+		}
+	}
+
+_err:
+	if(comparisons)
+		free(comparisons);
+	if(log)
+		free(log);
+	pc_trace_free(&trace);
+	pc_symtab_free(&symtab);
+	pc_profile_free(&baseline);
+	pc_profile_free(&current);
+
+	return rv;
+}
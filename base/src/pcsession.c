@@ -0,0 +1,432 @@
+/**
+ * ProfCounter host session
+ *
+ * Owns the profCounter side of the host code (command queue, kernel, log buffer and its readback), so that applications only
+ * provide their OpenCL context and program and launch their DUT between pc_wait_armed() and pc_collect():
+ *
+ * pc_session_open(&session, context, program, 0, prescaler);
+ * do {
+ *     pc_arm(&session);
+ *     pc_wait_armed(&session);
+ *     (launch DUT and wait for it)
+ *     pc_collect(&session, &trace);
+ * } while(...);
+ * pc_close(&session);
+ *
+ * Program binaries are memory-mapped, and programs and kernels are cached for the whole process, so that opening further sessions
+ * (or reloading the same binary) does not pay for creating and building them again. The time spent on startup is accumulated and
+ * can be reported with pc_print_startup().
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "pcsession.h"
+
+/* Polling interval of pc_wait_armed(), in microseconds */
+#define PC_SESSION_ARM_POLL 100
+
+/* Cached program, identified by its context and binary file name */
+typedef struct {
+	cl_context context;
+	char *fileName;
+	cl_program program;
+} pc_program_entry_t;
+
+/* Cached kernel, identified by its program and name */
+typedef struct {
+	cl_program program;
+	char *name;
+	cl_kernel kernel;
+} pc_kernel_entry_t;
+
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static pc_program_entry_t programCache[PC_SESSION_CACHE_LEN];
+static size_t programCacheLen = 0;
+static pc_kernel_entry_t kernelCache[PC_SESSION_CACHE_LEN];
+static size_t kernelCacheLen = 0;
+static pc_startup_t startupStats = {0};
+
+static double pc_session_now(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int pc_program_load(cl_context context, cl_device_id device, const char *fileName, cl_program *program) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+	int fd = -1;
+	struct stat fileStat;
+	void *binary = MAP_FAILED;
+	size_t binarySz = 0;
+	cl_int fRet;
+	cl_int binaryRet;
+	double then;
+
+	*program = NULL;
+
+	/* The lock is held during the whole load, so that concurrent requests for the same binary load it only once */
+	pthread_mutex_lock(&cacheMutex);
+
+	for(i = 0; i < programCacheLen; i++) {
+		if(context == programCache[i].context && !strcmp(fileName, programCache[i].fileName)) {
+			clRetainProgram(programCache[i].program);
+			*program = programCache[i].program;
+			(startupStats.programHits)++;
+			goto _err;
+		}
+	}
+
+	/* Map the binary instead of copying it to the heap, the runtime reads it directly from the page cache */
+	then = pc_session_now();
+	fd = open(fileName, O_RDONLY);
+	ASSERT_CALL(fd != -1, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+	ASSERT_CALL(!fstat(fd, &fileStat), fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+	binarySz = fileStat.st_size;
+	ASSERT_CALL(binarySz, fprintf(stderr, "Error: %s is empty.\n", fileName); rv = EXIT_FAILURE);
+	binary = mmap(NULL, binarySz, PROT_READ, MAP_PRIVATE, fd, 0);
+	ASSERT_CALL(MAP_FAILED != binary, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+	startupStats.loadTime += pc_session_now() - then;
+	startupStats.binarySz += binarySz;
+
+	then = pc_session_now();
+	*program = clCreateProgramWithBinary(context, 1, &device, &binarySz, (const unsigned char **) &binary, &binaryRet, &fRet);
+	ASSERT_CALL(
+		CL_SUCCESS == fRet && CL_SUCCESS == binaryRet,
+		fprintf(stderr, "Error: clCreateProgramWithBinary failed with return code %d.\n", (CL_SUCCESS == fRet)? binaryRet : fRet);
+		rv = EXIT_FAILURE
+	);
+	startupStats.createTime += pc_session_now() - then;
+
+	then = pc_session_now();
+	fRet = clBuildProgram(*program, 1, &device, NULL, NULL, NULL);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clBuildProgram failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	startupStats.buildTime += pc_session_now() - then;
+	(startupStats.programs)++;
+
+	/* If the cache is full, the program is still returned but not cached */
+	if(programCacheLen < PC_SESSION_CACHE_LEN) {
+		programCache[programCacheLen].fileName = strdup(fileName);
+		if(programCache[programCacheLen].fileName) {
+			clRetainProgram(*program);
+			programCache[programCacheLen].context = context;
+			programCache[programCacheLen].program = *program;
+			programCacheLen++;
+		}
+	}
+
+_err:
+	if(MAP_FAILED != binary)
+		munmap(binary, binarySz);
+	if(fd != -1)
+		close(fd);
+	if(EXIT_FAILURE == rv && *program) {
+		clReleaseProgram(*program);
+		*program = NULL;
+	}
+
+	pthread_mutex_unlock(&cacheMutex);
+
+	return rv;
+}
+
+int pc_kernel_create(cl_program program, const char *name, cl_kernel *kernel) {
+	int rv = EXIT_SUCCESS;
+	size_t i;
+	cl_int fRet;
+	double then;
+
+	*kernel = NULL;
+
+	pthread_mutex_lock(&cacheMutex);
+
+	for(i = 0; i < kernelCacheLen; i++) {
+		if(program == kernelCache[i].program && !strcmp(name, kernelCache[i].name)) {
+			clRetainKernel(kernelCache[i].kernel);
+			*kernel = kernelCache[i].kernel;
+			(startupStats.kernelHits)++;
+			goto _err;
+		}
+	}
+
+	then = pc_session_now();
+	*kernel = clCreateKernel(program, name, &fRet);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clCreateKernel (%s) failed with return code %d.\n", name, fRet); rv = EXIT_FAILURE);
+	startupStats.kernelTime += pc_session_now() - then;
+	(startupStats.kernels)++;
+
+	if(kernelCacheLen < PC_SESSION_CACHE_LEN) {
+		kernelCache[kernelCacheLen].name = strdup(name);
+		if(kernelCache[kernelCacheLen].name) {
+			clRetainKernel(*kernel);
+			kernelCache[kernelCacheLen].program = program;
+			kernelCache[kernelCacheLen].kernel = *kernel;
+			kernelCacheLen++;
+		}
+	}
+
+_err:
+	if(EXIT_FAILURE == rv)
+		*kernel = NULL;
+
+	pthread_mutex_unlock(&cacheMutex);
+
+	return rv;
+}
+
+void pc_cache_release(void) {
+	size_t i;
+
+	pthread_mutex_lock(&cacheMutex);
+
+	for(i = 0; i < kernelCacheLen; i++) {
+		clReleaseKernel(kernelCache[i].kernel);
+		free(kernelCache[i].name);
+	}
+	kernelCacheLen = 0;
+
+	for(i = 0; i < programCacheLen; i++) {
+		clReleaseProgram(programCache[i].program);
+		free(programCache[i].fileName);
+	}
+	programCacheLen = 0;
+
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+void pc_startup_get(pc_startup_t *startup) {
+	pthread_mutex_lock(&cacheMutex);
+	*startup = startupStats;
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+void pc_print_startup(FILE *f) {
+	pc_startup_t current;
+
+	pc_startup_get(&current);
+
+	fprintf(
+		f, "Host startup: %.3f ms (binary mapping %.3f ms for %.2f MiB, program creation %.3f ms, build %.3f ms, kernel creation %.3f ms).\n",
+		(current.loadTime + current.createTime + current.buildTime + current.kernelTime) * 1000, current.loadTime * 1000,
+		current.binarySz / (1024.0 * 1024.0), current.createTime * 1000, current.buildTime * 1000, current.kernelTime * 1000
+	);
+	fprintf(
+		f, "Object cache: %u program(s) created, %u reused; %u kernel(s) created, %u reused.\n",
+		current.programs, current.programHits, current.kernels, current.kernelHits
+	);
+}
+
+int pc_session_open(pc_session_t *session, cl_context context, cl_program program, size_t logLen, cl_uint prescaler) {
+	int rv = EXIT_SUCCESS;
+	cl_int fRet;
+	size_t devicesSz;
+	cl_device_id *devices = NULL;
+
+	memset(session, 0, sizeof(pc_session_t));
+	session->context = context;
+	session->logLen = logLen? logLen : PC_SESSION_DEFAULT_LOG_LEN;
+
+	/* The kernel runs on the (first) device the program was built for */
+	fRet = clGetProgramInfo(program, CL_PROGRAM_DEVICES, 0, NULL, &devicesSz);
+	ASSERT_CALL(CL_SUCCESS == fRet && devicesSz, fprintf(stderr, "Error: clGetProgramInfo failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	devices = malloc(devicesSz);
+	ASSERT_CALL(devices, fprintf(stderr, "Error: could not allocate memory for program devices.\n"); rv = EXIT_FAILURE);
+	fRet = clGetProgramInfo(program, CL_PROGRAM_DEVICES, devicesSz, devices, NULL);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clGetProgramInfo failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+
+	session->queue = clCreateCommandQueue(context, devices[0], 0, &fRet);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clCreateCommandQueue failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	ASSERT_CALL(EXIT_SUCCESS == pc_kernel_create(program, "profCounter", &(session->kernel)), rv = EXIT_FAILURE);
+	session->logK = clCreateBuffer(context, CL_MEM_READ_WRITE, session->logLen * sizeof(uint64_t), NULL, &fRet);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clCreateBuffer failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+
+	session->empty = calloc(session->logLen, sizeof(uint64_t));
+	session->log = malloc(session->logLen * sizeof(uint64_t));
+	ASSERT_CALL(session->empty && session->log, fprintf(stderr, "Error: could not allocate memory for log.\n"); rv = EXIT_FAILURE);
+
+	/* Arguments never change between runs, thus they are set only once */
+	fRet = clSetKernelArg(session->kernel, 0, sizeof(cl_mem), &(session->logK));
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clSetKernelArg (logK) failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	fRet = clSetKernelArg(session->kernel, 1, sizeof(cl_uint), &prescaler);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clSetKernelArg (prescaler) failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	ASSERT_CALL(EXIT_SUCCESS == pc_session_watermark(session, 0), rv = EXIT_FAILURE);
+	ASSERT_CALL(EXIT_SUCCESS == pc_session_interval(session, 0), rv = EXIT_FAILURE);
+	ASSERT_CALL(EXIT_SUCCESS == pc_session_finishes(session, 0), rv = EXIT_FAILURE);
+
+_err:
+	if(devices)
+		free(devices);
+	if(EXIT_FAILURE == rv)
+		pc_close(session);
+
+	return rv;
+}
+
+int pc_session_watermark(pc_session_t *session, cl_uint watermark) {
+	cl_int fRet = clSetKernelArg(session->kernel, 2, sizeof(cl_uint), &watermark);
+
+	if(CL_SUCCESS != fRet) {
+		fprintf(stderr, "Error: clSetKernelArg (watermark) failed with return code %d.\n", fRet);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int pc_session_interval(pc_session_t *session, cl_uint interval) {
+	cl_int fRet = clSetKernelArg(session->kernel, 3, sizeof(cl_uint), &interval);
+
+	if(CL_SUCCESS != fRet) {
+		fprintf(stderr, "Error: clSetKernelArg (interval) failed with return code %d.\n", fRet);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int pc_session_finishes(pc_session_t *session, cl_uint finishes) {
+	cl_int fRet = clSetKernelArg(session->kernel, 4, sizeof(cl_uint), &finishes);
+
+	if(CL_SUCCESS != fRet) {
+		fprintf(stderr, "Error: clSetKernelArg (finishes) failed with return code %d.\n", fRet);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int pc_session_drain(pc_session_t *session, unsigned workersLen, pc_drain_consumer_t consumer, void *consumerArg) {
+	if(EXIT_SUCCESS != pc_drain_init(&(session->drain), session->context, session->queue, session->logLen, workersLen, consumer, consumerArg))
+		return EXIT_FAILURE;
+	session->draining = true;
+
+	return EXIT_SUCCESS;
+}
+
+int pc_arm(pc_session_t *session) {
+	int rv = EXIT_SUCCESS;
+	cl_int fRet;
+
+	if(session->running) {
+		clReleaseEvent(session->running);
+		session->running = NULL;
+	}
+
+	/* Both commands are non-blocking: the queue is in-order, thus the log is only cleared after the previous readback */
+	fRet = clEnqueueWriteBuffer(session->queue, session->logK, CL_FALSE, 0, session->logLen * sizeof(uint64_t), session->empty, 0, NULL, NULL);
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clEnqueueWriteBuffer failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	fRet = clEnqueueTask(session->queue, session->kernel, 0, NULL, &(session->running));
+	ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clEnqueueTask failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+	clFlush(session->queue);
+
+	(session->runs)++;
+
+_err:
+	return rv;
+}
+
+int pc_wait_armed(pc_session_t *session) {
+	int rv = EXIT_SUCCESS;
+	cl_int fRet;
+	cl_int status;
+	unsigned waited;
+
+	ASSERT_CALL(session->running, fprintf(stderr, "Error: profCounter was not armed.\n"); rv = EXIT_FAILURE);
+
+	/* Poll the launch until it is running, instead of sleeping for a fixed time */
+	for(waited = 0; waited < PC_SESSION_ARM_TIMEOUT; waited += PC_SESSION_ARM_POLL) {
+		fRet = clGetEventInfo(session->running, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+		ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clGetEventInfo failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+		ASSERT_CALL(status >= 0, fprintf(stderr, "Error: profCounter launch failed with status %d.\n", status); rv = EXIT_FAILURE);
+		if(status <= CL_RUNNING)
+			break;
+
+		usleep(PC_SESSION_ARM_POLL);
+	}
+
+_err:
+	return rv;
+}
+
+int pc_collect(pc_session_t *session, pc_trace_t *trace) {
+	int rv = EXIT_SUCCESS;
+	cl_int fRet;
+	size_t offset;
+	size_t chunkLen;
+	size_t i;
+	bool emptyFound = false;
+
+	memset(trace, 0, sizeof(pc_trace_t));
+	ASSERT_CALL(session->running, fprintf(stderr, "Error: profCounter was not armed.\n"); rv = EXIT_FAILURE);
+
+	/* Only the used part of the log is read back: chunks are read until one contains an empty record */
+	session->logUsed = 0;
+	for(offset = 0; offset < session->logLen && !emptyFound; offset += chunkLen) {
+		chunkLen = session->logLen - offset;
+		if(chunkLen > PC_SESSION_READ_CHUNK)
+			chunkLen = PC_SESSION_READ_CHUNK;
+
+		fRet = clEnqueueReadBuffer(
+			session->queue, session->logK, CL_TRUE, offset * sizeof(uint64_t), chunkLen * sizeof(uint64_t), &(session->log[offset]),
+			1, &(session->running), NULL
+		);
+		ASSERT_CALL(CL_SUCCESS == fRet, fprintf(stderr, "Error: clEnqueueReadBuffer failed with return code %d.\n", fRet); rv = EXIT_FAILURE);
+
+		for(i = offset; i < offset + chunkLen && !emptyFound; i++) {
+			if(session->log[i])
+				(session->logUsed)++;
+			else
+				emptyFound = true;
+		}
+	}
+
+	ASSERT_CALL(EXIT_SUCCESS == pc_decode(session->log, session->logUsed, trace), rv = EXIT_FAILURE);
+
+_err:
+	return rv;
+}
+
+int pc_collect_async(pc_session_t *session) {
+	if(!(session->draining) || !(session->running)) {
+		fprintf(stderr, "Error: asynchronous collection requires pc_session_drain() and pc_arm().\n");
+		return EXIT_FAILURE;
+	}
+
+	return pc_drain_enqueue(&(session->drain), session->logK, 1, &(session->running));
+}
+
+int pc_session_wait(pc_session_t *session) {
+	return session->draining? pc_drain_finish(&(session->drain)) : EXIT_SUCCESS;
+}
+
+void pc_close(pc_session_t *session) {
+	if(session->draining)
+		pc_drain_release(&(session->drain));
+	if(session->running)
+		clReleaseEvent(session->running);
+	if(session->queue)
+		clFinish(session->queue);
+	if(session->logK)
+		clReleaseMemObject(session->logK);
+	if(session->kernel)
+		clReleaseKernel(session->kernel);
+	if(session->queue)
+		clReleaseCommandQueue(session->queue);
+	if(session->empty)
+		free(session->empty);
+	if(session->log)
+		free(session->log);
+
+	memset(session, 0, sizeof(pc_session_t));
+}
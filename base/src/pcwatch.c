@@ -0,0 +1,250 @@
+/**
+ * ProfCounter live trace consumer
+ *
+ * Connects to the socket of a live streaming service (see pclive.h and pcstream.h) and prints the trace of the running kernel as it
+ * is published: after every drain period, the regions taking most cycles so far (and their mean within the last period), or the
+ * share of the samples of each region in sampling mode:
+ *
+ * pcwatch [socket=<path>] [top=<regions>] [runs=<runs>] [symtab=<file>] [events]
+ *
+ * The exit status is 0 once the requested runs ended (or the service closed the socket), 1 on errors.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "pcdecoder.h"
+#include "pcstream.h"
+
+/* Samples per checkpoint ID, and of the samples taken before the first checkpoint */
+#define PCWATCH_SAMPLE_BINS 129
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [socket=<path>] [top=<regions>] [runs=<runs>] [symtab=<file>] [events]\n", name);
+	fprintf(stderr, "\tsocket\tsocket of the live streaming service (default is %s)\n", PC_LIVE_DEFAULT_SOCKET);
+	fprintf(stderr, "\ttop\tnumber of regions printed after every drain period (default is 10)\n");
+	fprintf(stderr, "\truns\texit after this number of runs, 0 to follow until the service closes (default is 1)\n");
+	fprintf(stderr, "\tsymtab\tcheckpoint symbol table used to name the regions (e.g. probe.pcsym)\n");
+	fprintf(stderr, "\tevents\tprint every event as it is received\n");
+}
+
+/* Read exactly bufferSz bytes, false on end of stream or errors */
+static bool readAll(int fd, void *buffer, size_t bufferSz) {
+	char *next = buffer;
+
+	while(bufferSz) {
+		ssize_t received = recv(fd, next, bufferSz, 0);
+
+		if(received < 0 && EINTR == errno)
+			continue;
+		if(received <= 0)
+			return false;
+
+		next += received;
+		bufferSz -= received;
+	}
+
+	return true;
+}
+
+/* Regions sorted by cycles spent so far (count times mean), descending */
+static int compareRegions(const void *a, const void *b) {
+	double spentA = ((const pc_live_region_t *) a)->count * ((const pc_live_region_t *) a)->mean;
+	double spentB = ((const pc_live_region_t *) b)->count * ((const pc_live_region_t *) b)->mean;
+
+	return (spentA < spentB) - (spentA > spentB);
+}
+
+static void printRegions(pc_live_region_t *regions, size_t regionsLen, unsigned top, const pc_symtab_t *symtab) {
+	size_t i;
+	char fromName[64];
+	char toName[64];
+	char region[136];
+
+	qsort(regions, regionsLen, sizeof(pc_live_region_t), compareRegions);
+	if(regionsLen > top)
+		regionsLen = top;
+
+	printf("| %-40.40s | %10s | %12s | %12s | %10s | %12s |\n", "Region", "Count", "Mean", "Max", "Window", "Window mean");
+	for(i = 0; i < regionsLen; i++) {
+		snprintf(
+			region, sizeof(region), "%s -> %s", pc_symbol_name(symtab, regions[i].from, fromName, sizeof(fromName)),
+			pc_symbol_name(symtab, regions[i].to, toName, sizeof(toName))
+		);
+		printf(
+			"| %-40.40s | %10" PRIu64 " | %12.1f | %12" PRIu64 " | %10" PRIu64 " | %12.1f |\n", region, regions[i].count, regions[i].mean,
+			regions[i].max, regions[i].windowCount, regions[i].windowMean
+		);
+	}
+}
+
+static void printSamples(const uint64_t *bins, uint64_t samplesLen, unsigned top, const pc_symtab_t *symtab) {
+	unsigned i;
+	unsigned printed;
+	bool used[PCWATCH_SAMPLE_BINS] = {false};
+	char name[64];
+
+	printf("| %-40.40s | %10s | %7s |\n", "Region", "Samples", "Share");
+	for(printed = 0; printed < top; printed++) {
+		unsigned largest = PCWATCH_SAMPLE_BINS;
+
+		for(i = 0; i < PCWATCH_SAMPLE_BINS; i++) {
+			if(!used[i] && bins[i] && (PCWATCH_SAMPLE_BINS == largest || bins[i] > bins[largest]))
+				largest = i;
+		}
+		if(PCWATCH_SAMPLE_BINS == largest)
+			break;
+
+		used[largest] = true;
+		printf(
+			"| %-40.40s | %10" PRIu64 " | %6.2f%% |\n", (PCWATCH_SAMPLE_BINS - 1 == largest)? "(start)" : pc_symbol_name(symtab, largest, name, sizeof(name)),
+			bins[largest], 100.0 * bins[largest] / samplesLen
+		);
+	}
+}
+
+int main(int argc, char *argv[]) {
+	int rv = EXIT_SUCCESS;
+	int i;
+	int fd = -1;
+	struct sockaddr_un address;
+	const char *socketPath = PC_LIVE_DEFAULT_SOCKET;
+	const char *symtabFileName = NULL;
+	unsigned top = 10;
+	unsigned runsLen = 1;
+	unsigned runsEnded = 0;
+	bool printEvents = false;
+	pc_symtab_t symtab = {0};
+	pc_live_frame_t frame;
+	char *payload = NULL;
+	size_t payloadCapacity = 0;
+	pc_live_header_t header = {0};
+	uint64_t eventsLen = 0;
+	uint64_t samplesLen = 0;
+	uint64_t bins[PCWATCH_SAMPLE_BINS] = {0};
+
+	for(i = 1; i < argc; i++) {
+		if(!strncmp(argv[i], "socket=", 7))
+			socketPath = argv[i] + 7;
+		else if(!strncmp(argv[i], "top=", 4))
+			top = strtoul(argv[i] + 4, NULL, 10);
+		else if(!strncmp(argv[i], "runs=", 5))
+			runsLen = strtoul(argv[i] + 5, NULL, 10);
+		else if(!strncmp(argv[i], "symtab=", 7))
+			symtabFileName = argv[i] + 7;
+		else if(!strcmp(argv[i], "events"))
+			printEvents = true;
+		else
+			ASSERT_CALL(false, usage(argv[0]); rv = EXIT_FAILURE);
+	}
+
+	if(symtabFileName)
+		ASSERT_CALL(EXIT_SUCCESS == pc_symtab_load(symtabFileName, &symtab), rv = EXIT_FAILURE);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	ASSERT_CALL(strlen(socketPath) < sizeof(address.sun_path), fprintf(stderr, "Error: socket path too long: %s\n", socketPath); rv = EXIT_FAILURE);
+	strcpy(address.sun_path, socketPath);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	ASSERT_CALL(fd >= 0 && !connect(fd, (struct sockaddr *) &address, sizeof(address)), fprintf(stderr, "Error: %s: %s\n", strerror(errno), socketPath); rv = EXIT_FAILURE);
+
+	while((!runsLen || runsEnded < runsLen) && readAll(fd, &frame, sizeof(frame))) {
+		if(frame.length > payloadCapacity) {
+			char *newPayload = realloc(payload, frame.length);
+
+			ASSERT_CALL(newPayload, fprintf(stderr, "Error: could not allocate memory for a %u-byte frame.\n", frame.length); rv = EXIT_FAILURE);
+			payload = newPayload;
+			payloadCapacity = frame.length;
+		}
+		ASSERT_CALL(readAll(fd, payload, frame.length), fprintf(stderr, "Error: truncated frame.\n"); rv = EXIT_FAILURE);
+
+		switch(frame.type) {
+			case PC_LIVE_FRAME_HEADER:
+				ASSERT_CALL(
+					sizeof(pc_live_header_t) == frame.length && PC_LIVE_VERSION == ((pc_live_header_t *) payload)->version,
+					fprintf(stderr, "Error: unsupported live streaming protocol.\n"); rv = EXIT_FAILURE
+				);
+				/* Consumers joining during a run start counting from there */
+				if(((pc_live_header_t *) payload)->run != header.run) {
+					eventsLen = 0;
+					samplesLen = 0;
+					memset(bins, 0, sizeof(bins));
+				}
+				memcpy(&header, payload, sizeof(pc_live_header_t));
+				printf(
+					"Run %u: %u-bit counter, prescaler %u, clocks %u/%u MHz%s%s.\n", header.run, header.counterWidth, header.prescaler,
+					header.kernelClockMHz, header.dutClockMHz, (header.flags & PC_LIVE_FLAG_DUT_CYCLES)? ", DUT cycles" : "",
+					(header.flags & PC_LIVE_FLAG_NDRANGE)? ", NDRange" : ""
+				);
+				break;
+			case PC_LIVE_FRAME_EVENTS: {
+				const pc_live_event_t *events = (const pc_live_event_t *) payload;
+				size_t j;
+				char name[64];
+
+				for(j = 0; printEvents && j < frame.length / sizeof(pc_live_event_t); j++) {
+					if(header.flags & PC_LIVE_FLAG_NDRANGE)
+						printf("%10" PRIu64 " %5u.%-3u ", events[j].cycle, events[j].group, events[j].local);
+					else
+						printf("%10" PRIu64 " ", events[j].cycle);
+					printf("%s\n", (UINT32_MAX == events[j].id)? "(stamp)" : pc_symbol_name(&symtab, events[j].id, name, sizeof(name)));
+				}
+				eventsLen += frame.length / sizeof(pc_live_event_t);
+				break;
+			}
+			case PC_LIVE_FRAME_SAMPLES: {
+				const pc_live_sample_t *samples = (const pc_live_sample_t *) payload;
+				size_t j;
+
+				for(j = 0; j < frame.length / sizeof(pc_live_sample_t); j++) {
+					ASSERT_CALL(
+						!samples[j].seen || samples[j].id < PCWATCH_SAMPLE_BINS - 1,
+						fprintf(stderr, "Error: sample of invalid checkpoint %u.\n", samples[j].id); rv = EXIT_FAILURE
+					);
+					bins[samples[j].seen? samples[j].id : (PCWATCH_SAMPLE_BINS - 1)]++;
+				}
+				samplesLen += frame.length / sizeof(pc_live_sample_t);
+				break;
+			}
+			case PC_LIVE_FRAME_REGIONS:
+				printf("Run %u: %" PRIu64 " events, %" PRIu64 " samples so far.\n", header.run, eventsLen, samplesLen);
+				if(samplesLen)
+					printSamples(bins, samplesLen, top, &symtab);
+				else if(frame.length)
+					printRegions((pc_live_region_t *) payload, frame.length / sizeof(pc_live_region_t), top, &symtab);
+				break;
+			case PC_LIVE_FRAME_END: {
+				const pc_live_end_t *end = (const pc_live_end_t *) payload;
+
+				ASSERT_CALL(sizeof(pc_live_end_t) == frame.length, fprintf(stderr, "Error: invalid end frame.\n"); rv = EXIT_FAILURE);
+				printf(
+					"Run %u %s: %" PRIu64 " records, %" PRIu64 " events, %" PRIu64 " samples.\n", end->run, end->failed? "failed" : "ended",
+					end->records, end->events, end->samples
+				);
+				runsEnded++;
+				break;
+			}
+			/* Unknown frames are skipped, so that newer services can add frames */
+			default:
+				break;
+		}
+		fflush(stdout);
+	}
+
+_err:
+	if(fd >= 0)
+		close(fd);
+	if(payload)
+		free(payload);
+	pc_symtab_free(&symtab);
+
+	return rv;
+}
@@ -1,12 +1,20 @@
 #include "profcounter.h"
 
 __attribute__((reqd_work_group_size(1,1,1)))
-__kernel void probe(__global unsigned * restrict timeline, char mustHold) {
+__kernel void probe(__global unsigned * restrict timeline, char mustHold, unsigned calibrationSpacing) {
 	int i, j;
 
 	/* Initialise timestamper */
 	PROFCOUNTER_INIT();
 
+	/* Calibration mode: issue the reference command sequence instead of the timeline */
+	if(calibrationSpacing) {
+		PROFCOUNTER_HOLD();
+		PROFCOUNTER_CALIBRATE(calibrationSpacing, 64);
+		PROFCOUNTER_FINISH();
+		return;
+	}
+
 	if(mustHold) {
 		/* Request values to be held; they are written only after PROFCOUNTER_FINISH() is called */
 		PROFCOUNTER_HOLD();
@@ -19,13 +27,13 @@ __kernel void probe(__global unsigned * restrict timeline, char mustHold) {
 	for(i = 0, j = 0; i < 10; j++) {
 		if(timeline[i] == j) {
 			/* Send command to save timestamp with checkpoint ID 10 */
-			PROFCOUNTER_CHECKPOINT_10();
+			PROFCOUNTER_CHECKPOINT(10, "timeline epoch");
 			i++;
 		}
 	}
 
 	/* Generate a timestamp with checkpoint ID 11 */
-	PROFCOUNTER_CHECKPOINT_11();
+	PROFCOUNTER_CHECKPOINT(11, "end of timeline");
 
 	/* Send command to shut down profCounter */
 	PROFCOUNTER_FINISH();
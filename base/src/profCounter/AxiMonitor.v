@@ -0,0 +1,242 @@
+`timescale 1ns / 1ps
+
+`include "records.vh"
+
+/**
+ * AxiMonitor
+ *
+ * Passive monitor of an AXI4 master of the DUT (see AXI_MONITOR in config.vh). Only the handshake, length and size signals are
+ * observed, nothing is ever driven. The monitor counts, since the previous snapshot:
+ *
+ * - Bytes requested by read and write bursts ((LEN + 1) << SIZE, counted at the address handshake);
+ * - Read and write data beats (counted at the data handshake);
+ * - Cycles with at least one read or write burst outstanding (from the address handshake up to RLAST or the write response).
+ *
+ * The record stream from SequentialWriter goes through a small queue. Every checkpoint record takes a snapshot of the counters,
+ * which are then restarted, and is forwarded followed by three traffic records (bytes, beats and busy cycles, see records.vh) with
+ * the traffic of the region ending at that checkpoint. Counters saturate at 2^27 - 1. Records arriving while the queue is full are
+ * dropped and reported on "dropped", so that they are accounted by the telemetry trailer.
+ *
+ * If ENABLE is 0, every record is forwarded unchanged.
+ */
+module AxiMonitor#(
+	parameter DEPTH = 16,
+	parameter ENABLE = 1
+) (
+	/* Standard pins */
+	clk,
+	rst_n,
+
+	/* Kernel start pulse, counters are cleared */
+	start,
+	/* Record stream from SequentialWriter */
+	inEnqueue,
+	inRecord,
+	/* Record stream with traffic records, towards the writer FIFO */
+	outEnqueue,
+	outRecord,
+	/* Asserted when no record is pending */
+	idle,
+	/* Asserted when a record is dropped because the queue is full */
+	dropped,
+
+	/* Monitored AXI4 master (inputs only) */
+	monARVALID,
+	monARREADY,
+	monARLEN,
+	monARSIZE,
+	monRVALID,
+	monRREADY,
+	monRLAST,
+	monAWVALID,
+	monAWREADY,
+	monAWLEN,
+	monAWSIZE,
+	monWVALID,
+	monWREADY,
+	monBVALID,
+	monBREADY
+);
+
+	/* Width of the traffic counters, as held by the traffic records */
+	localparam TRAFFIC_WIDTH = 27;
+	localparam [TRAFFIC_WIDTH-1:0] TRAFFIC_MAX = {TRAFFIC_WIDTH{1'b1}};
+	/* Queue entry: record, then the snapshot (read and write bytes, beats and busy cycles) */
+	localparam ENTRY_WIDTH = 64 + 6 * TRAFFIC_WIDTH;
+
+	input clk;
+	input rst_n;
+
+	input start;
+	input inEnqueue;
+	input [63:0] inRecord;
+	output outEnqueue;
+	output [63:0] outRecord;
+	output idle;
+	output dropped;
+
+	input monARVALID;
+	input monARREADY;
+	input [7:0] monARLEN;
+	input [2:0] monARSIZE;
+	input monRVALID;
+	input monRREADY;
+	input monRLAST;
+	input monAWVALID;
+	input monAWREADY;
+	input [7:0] monAWLEN;
+	input [2:0] monAWSIZE;
+	input monWVALID;
+	input monWREADY;
+	input monBVALID;
+	input monBREADY;
+
+	/* Traffic since the last snapshot */
+	reg [TRAFFIC_WIDTH-1:0] readBytes;
+	reg [TRAFFIC_WIDTH-1:0] writeBytes;
+	reg [TRAFFIC_WIDTH-1:0] readBeats;
+	reg [TRAFFIC_WIDTH-1:0] writeBeats;
+	reg [TRAFFIC_WIDTH-1:0] readBusy;
+	reg [TRAFFIC_WIDTH-1:0] writeBusy;
+	/* Bursts between the address handshake and their last beat (reads) or response (writes) */
+	reg [15:0] readOutstanding;
+	reg [15:0] writeOutstanding;
+
+	/* Handshakes of this cycle */
+	wire arHandshake;
+	wire rHandshake;
+	wire awHandshake;
+	wire wHandshake;
+	wire bHandshake;
+	/* Increments of this cycle */
+	wire [15:0] readBurstBytes;
+	wire [15:0] writeBurstBytes;
+	wire [15:0] readBytesInc;
+	wire [15:0] writeBytesInc;
+	wire readBusyInc;
+	wire writeBusyInc;
+
+	/* Snapshot is taken when a checkpoint record enters the queue. COMM_FINISH (-1) would otherwise look like a checkpoint */
+	wire snapshot;
+	wire [6*TRAFFIC_WIDTH-1:0] snapshotValues;
+
+	/* Output side: 0 forwards the queued record, 1 to 3 the traffic records that follow a checkpoint */
+	reg [1:0] phase;
+	wire queueEnqueue;
+	wire queueDequeue;
+	wire [ENTRY_WIDTH-1:0] queueIn;
+	wire [ENTRY_WIDTH-1:0] queueOut;
+	wire queueIsEmpty;
+	wire queueIsFull;
+	wire [15:0] queueCount;
+	wire [63:0] frontRecord;
+	wire frontIsCheckpoint;
+	wire [TRAFFIC_WIDTH-1:0] frontReadBytes;
+	wire [TRAFFIC_WIDTH-1:0] frontWriteBytes;
+	wire [TRAFFIC_WIDTH-1:0] frontReadBeats;
+	wire [TRAFFIC_WIDTH-1:0] frontWriteBeats;
+	wire [TRAFFIC_WIDTH-1:0] frontReadBusy;
+	wire [TRAFFIC_WIDTH-1:0] frontWriteBusy;
+
+	/* Saturating increment of a traffic counter */
+	function [TRAFFIC_WIDTH-1:0] saturate;
+		input [TRAFFIC_WIDTH-1:0] value;
+		input [15:0] increment;
+		reg [TRAFFIC_WIDTH:0] sum;
+		begin
+			sum = value + increment;
+			saturate = sum[TRAFFIC_WIDTH]? TRAFFIC_MAX : sum[TRAFFIC_WIDTH-1:0];
+		end
+	endfunction
+
+	assign arHandshake = monARVALID && monARREADY;
+	assign rHandshake = monRVALID && monRREADY;
+	assign awHandshake = monAWVALID && monAWREADY;
+	assign wHandshake = monWVALID && monWREADY;
+	assign bHandshake = monBVALID && monBREADY;
+
+	assign readBurstBytes = ({8'h0, monARLEN} + 'h1) << monARSIZE;
+	assign writeBurstBytes = ({8'h0, monAWLEN} + 'h1) << monAWSIZE;
+	assign readBytesInc = arHandshake? readBurstBytes : 'h0;
+	assign writeBytesInc = awHandshake? writeBurstBytes : 'h0;
+	assign readBusyInc = readOutstanding != 'h0;
+	assign writeBusyInc = writeOutstanding != 'h0;
+
+	assign snapshot = inEnqueue && 'hFFFFFFFFFFFFFFFF != inRecord && (inRecord[63:56] & `REC_CHECKPOINT);
+	assign snapshotValues = {readBytes, writeBytes, readBeats, writeBeats, readBusy, writeBusy};
+
+	/* Traffic counters. On a snapshot, the counters restart with the traffic of the current cycle */
+	always @(posedge clk) begin
+		if(!rst_n || start || !ENABLE) begin
+			readBytes <= 'h0;
+			writeBytes <= 'h0;
+			readBeats <= 'h0;
+			writeBeats <= 'h0;
+			readBusy <= 'h0;
+			writeBusy <= 'h0;
+		end
+		else begin
+			readBytes <= saturate(snapshot? 'h0 : readBytes, readBytesInc);
+			writeBytes <= saturate(snapshot? 'h0 : writeBytes, writeBytesInc);
+			readBeats <= saturate(snapshot? 'h0 : readBeats, rHandshake);
+			writeBeats <= saturate(snapshot? 'h0 : writeBeats, wHandshake);
+			readBusy <= saturate(snapshot? 'h0 : readBusy, readBusyInc);
+			writeBusy <= saturate(snapshot? 'h0 : writeBusy, writeBusyInc);
+		end
+	end
+
+	/* Outstanding bursts. These follow the monitored port regardless of the kernel state */
+	always @(posedge clk) begin
+		if(!rst_n || !ENABLE) begin
+			readOutstanding <= 'h0;
+			writeOutstanding <= 'h0;
+		end
+		else begin
+			readOutstanding <= readOutstanding + arHandshake - (rHandshake && monRLAST);
+			writeOutstanding <= writeOutstanding + awHandshake - bHandshake;
+		end
+	end
+
+	assign queueEnqueue = ENABLE && inEnqueue;
+	assign queueIn = {snapshotValues, inRecord};
+	assign dropped = queueEnqueue && queueIsFull;
+
+	assign frontRecord = queueOut[63:0];
+	assign frontIsCheckpoint = 'hFFFFFFFFFFFFFFFF != frontRecord && (frontRecord[63:56] & `REC_CHECKPOINT);
+	assign {frontReadBytes, frontWriteBytes, frontReadBeats, frontWriteBeats, frontReadBusy, frontWriteBusy} = queueOut[ENTRY_WIDTH-1:64];
+
+	/* Records other than checkpoints leave the queue at once, checkpoints after their three traffic records */
+	assign queueDequeue = !queueIsEmpty && (('h0 == phase && !frontIsCheckpoint) || 'h3 == phase);
+
+	assign outEnqueue = !ENABLE? inEnqueue : !queueIsEmpty;
+	assign outRecord = !ENABLE? inRecord :
+		('h1 == phase)? {`REC_TRAFFIC, `TRAFFIC_BYTES, frontReadBytes, frontWriteBytes} :
+		('h2 == phase)? {`REC_TRAFFIC, `TRAFFIC_BEATS, frontReadBeats, frontWriteBeats} :
+		('h3 == phase)? {`REC_TRAFFIC, `TRAFFIC_BUSY, frontReadBusy, frontWriteBusy} :
+		frontRecord;
+	assign idle = !ENABLE || (queueIsEmpty && 'h0 == phase);
+
+	always @(posedge clk) begin
+		if(!rst_n || !ENABLE)
+			phase <= 'h0;
+		else if(queueDequeue)
+			phase <= 'h0;
+		else if(!queueIsEmpty)
+			phase <= phase + 'h1;
+	end
+
+	/* Record queue, with the snapshot taken when each record arrived */
+	FIFO#(DEPTH, ENTRY_WIDTH) queue(
+		.clk(clk),
+		.rst_n(rst_n),
+
+		.enqueue(queueEnqueue),
+		.dequeue(queueDequeue),
+		.back(queueIn),
+		.front(queueOut),
+		.full(queueIsFull),
+		.empty(queueIsEmpty),
+		.count(queueCount)
+	);
+
+endmodule
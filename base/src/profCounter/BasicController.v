@@ -5,13 +5,22 @@
  *
  * Address Map | Name                    | Description
  *        0x00 | Control                 | Control Register
- *        0x04 | Global Interrupt Enable | Not supported
- *        0x08 | IP Interrupt Enable     | Not supported
- *        0x0C | IP Interrupt Status     | Not supported
+ *        0x04 | Global Interrupt Enable | Interrupt output enabled if bit [0] is set
+ *        0x08 | IP Interrupt Enable     | Bit [0] enables the done interrupt, bit [1] the log watermark interrupt
+ *        0x0C | IP Interrupt Status     | Same bits as IP Interrupt Enable, set on each enabled event. Each bit toggles when written with 1
  *   0x10-0x14 | Kernel argument "log"   | Pointer to global memory where the buffer for "log" variable is allocated
  *        0x18 | Reserved                | Reserved
  *        0x1C | Kernel pipe "p0"        | Not used, here for compatibility purposes (if applicable)
  *        0x20 | Reserved                | Reserved
+ *        0x24 | Kernel arg "prescaler"  | Log2 of the number of clock cycles per timestamp count (bits [4:0])
+ *        0x28 | Reserved                | Reserved
+ *        0x2C | Kernel arg "watermark"  | Number of records between log watermark interrupts (0 disables them)
+ *        0x30 | Reserved                | Reserved
+ *        0x34 | Records written         | Records of the current log written to global memory so far (read-only)
+ *        0x38 | Reserved                | Reserved
+ *        0x3C | Kernel arg "interval"   | Cycles between periodic samples (0 logs every event, see Sampler)
+ *        0x40 | Reserved                | Reserved
+ *        0x44 | Kernel arg "finishes"   | Number of COMM_FINISH commands that end an execution (0 or 1: the first, see CommandUnit)
  *
  * Control Register description
  * Bit(s) | Description                                     | Behaviour
@@ -22,9 +31,13 @@
  *    [2] | Idle, asserted when module is idle              | Read-only
  *    [1] | Done, asserted when module finished execution   | Read-only, reset on read
  *    [0] | Start, asserted by master to start execution    | Read/write, reset when handshake is performed
+ *
+ * The done interrupt is raised when the module goes back to idle after an execution. The log watermark interrupt is raised every
+ * time another "watermark" records are written to global memory, so that a host with access to this interface can drain the log
+ * in large chunks while the kernel runs. Both are cleared by writing 1 to their bits on IP Interrupt Status.
  */
 module BasicController#(
-	parameter ADDR_WIDTH = 6
+	parameter ADDR_WIDTH = 7
 ) (
 	/* Standard pins */
 	clk,
@@ -58,7 +71,17 @@ module BasicController#(
 	/* Asserted by this kernel when kernel is idling */
 	idle,
 	/* Base address for "log" global memory array */
-	offset
+	offset,
+	/* Timestamp prescaler (log2) */
+	prescaler,
+	/* Sampling interval in cycles (0 for event logging) */
+	interval,
+	/* Number of COMM_FINISH commands that end an execution */
+	finishes,
+	/* Number of records written to global memory since start */
+	written,
+	/* Interrupt line, asserted while an enabled interrupt is pending */
+	interrupt
 );
 
 	input clk;
@@ -87,6 +110,11 @@ module BasicController#(
 	input ready;
 	input idle;
 	output [63:0] offset;
+	output [4:0] prescaler;
+	output [31:0] interval;
+	output [31:0] finishes;
+	input [31:0] written;
+	output interrupt;
 
 	/* AXI4 write FSM registers */
 	reg [1:0] wState;
@@ -105,6 +133,20 @@ module BasicController#(
 	reg intRestart;
 	reg [63:0] intOffset;
 	reg [31:0] intPipe;
+	reg [31:0] intPrescaler;
+	reg intGie;
+	reg [1:0] intIer;
+	reg [1:0] intIsr;
+	reg [31:0] intWatermark;
+	reg [31:0] intInterval;
+	reg [31:0] intFinishes;
+	reg intInterrupt;
+
+	/* Interrupt sources */
+	reg idleRegistered;
+	reg [31:0] nextMark;
+	wire doneEvent;
+	wire watermarkEvent;
 
 	/* Assign AXI4 write signals */
 	assign axiAWREADY = rst_n && 'h0 == wState;
@@ -176,6 +218,21 @@ module BasicController#(
 						rData[3] <= ready;
 						rData[7] <= intRestart;
 					end
+				/* 0x04: global interrupt enable */
+				'h04:
+					begin
+						rData <= {31'h0, intGie};
+					end
+				/* 0x08: IP interrupt enable */
+				'h08:
+					begin
+						rData <= {30'h0, intIer};
+					end
+				/* 0x0C: IP interrupt status */
+				'h0C:
+					begin
+						rData <= {30'h0, intIsr};
+					end
 				/* 0x10: LSB of "log" base address */
 				'h10:
 					begin
@@ -191,6 +248,31 @@ module BasicController#(
 					begin
 						rData <= intPipe;
 					end
+				/* 0x24: timestamp prescaler */
+				'h24:
+					begin
+						rData <= intPrescaler;
+					end
+				/* 0x2C: log watermark */
+				'h2C:
+					begin
+						rData <= intWatermark;
+					end
+				/* 0x34: records written */
+				'h34:
+					begin
+						rData <= written;
+					end
+				/* 0x3C: sampling interval */
+				'h3C:
+					begin
+						rData <= intInterval;
+					end
+				/* 0x44: number of finishes */
+				'h44:
+					begin
+						rData <= intFinishes;
+					end
 				default:
 					begin
 						rData <= 'h0;
@@ -201,6 +283,31 @@ module BasicController#(
 
 	assign start = intStart;
 	assign offset = intOffset;
+	assign prescaler = intPrescaler[4:0];
+	assign interval = intInterval;
+	assign finishes = intFinishes;
+	assign interrupt = intInterrupt;
+
+	/* Done: module went back to idle. Watermark: another "watermark" records were written since the last one */
+	assign doneEvent = idle && !idleRegistered;
+	assign watermarkEvent = intWatermark != 'h0 && written != 'h0 && written >= nextMark;
+
+	/* Interrupt sources */
+	always @(posedge clk) begin
+		if(!rst_n) begin
+			idleRegistered <= 'b1;
+			nextMark <= 'h0;
+		end
+		else begin
+			idleRegistered <= idle;
+
+			/* The written counter is cleared on start, so is the next mark. Several marks may be crossed at once for small watermarks */
+			if('h0 == written)
+				nextMark <= intWatermark;
+			else if(watermarkEvent)
+				nextMark <= nextMark + intWatermark;
+		end
+	end
 
 	/* Register write logic */
 	always @(posedge clk) begin
@@ -210,6 +317,14 @@ module BasicController#(
 			intRestart <= 'b0;
 			intOffset <= 'h0;
 			intPipe <= 'h0;
+			intPrescaler <= 'h0;
+			intGie <= 'b0;
+			intIer <= 'h0;
+			intIsr <= 'h0;
+			intWatermark <= 'h0;
+			intInterval <= 'h0;
+			intFinishes <= 'h0;
+			intInterrupt <= 'b0;
 		end
 		else begin
 			/* If "start" bit is set in status register, generate a start signal. It clears after handshake */
@@ -239,6 +354,38 @@ module BasicController#(
 			/* 0x1C: pipe "p0" content */
 			if(axiWVALID && axiWREADY && 'h1C == wAddr)
 				intPipe <= (axiWDATA & wMask) | (intPipe & ~wMask);
+
+			/* 0x24: timestamp prescaler */
+			if(axiWVALID && axiWREADY && 'h24 == wAddr)
+				intPrescaler <= (axiWDATA & wMask) | (intPrescaler & ~wMask);
+
+			/* 0x04: global interrupt enable */
+			if(axiWVALID && axiWREADY && 'h04 == wAddr && axiWSTRB[0])
+				intGie <= axiWDATA[0];
+
+			/* 0x08: IP interrupt enable */
+			if(axiWVALID && axiWREADY && 'h08 == wAddr && axiWSTRB[0])
+				intIer <= axiWDATA[1:0];
+
+			/* 0x0C: IP interrupt status. Bits toggle on write, enabled events set them */
+			if(axiWVALID && axiWREADY && 'h0C == wAddr && axiWSTRB[0])
+				intIsr <= (intIsr ^ axiWDATA[1:0]) | (intIer & {watermarkEvent, doneEvent});
+			else
+				intIsr <= intIsr | (intIer & {watermarkEvent, doneEvent});
+
+			/* 0x2C: log watermark */
+			if(axiWVALID && axiWREADY && 'h2C == wAddr)
+				intWatermark <= (axiWDATA & wMask) | (intWatermark & ~wMask);
+
+			/* 0x3C: sampling interval */
+			if(axiWVALID && axiWREADY && 'h3C == wAddr)
+				intInterval <= (axiWDATA & wMask) | (intInterval & ~wMask);
+
+			/* 0x44: number of finishes */
+			if(axiWVALID && axiWREADY && 'h44 == wAddr)
+				intFinishes <= (axiWDATA & wMask) | (intFinishes & ~wMask);
+
+			intInterrupt <= intGie && (intIsr != 'h0);
 		end
 	end
 
@@ -9,10 +9,16 @@
  *
  * Command                     | Description
  * COMM_NOP              (0x0) | NOP
- * COMM_CHECKPOINT (0x1 - 0xC) | Save checkpoint, i.e. save the checkpoint ID + timestamp
+ * COMM_CHECKPOINT (0x1 - 0xC) | Save checkpoint, i.e. save the checkpoint ID + timestamp. The checkpoint bank is forwarded on "bank"
  * COMM_STAMP            (0xD) | Save timestamp
  * COMM_HOLD             (0xE) | Hold: timestamp values are only written when COMM_FINISH is issued (e.g. to avoid competition on global memory)
  * COMM_FINISH           (0xF) | Finish kernel execution
+ *
+ * With NDRange DUTs every work-item issues its own COMM_FINISH, thus execution only finishes on the "finishes"-th one (latched on
+ * start, 0 or 1 for the first one). Earlier COMM_FINISH commands are generated as COMM_NOP, so that the other modules keep running.
+ *
+ * The number of commands received since start is kept for the telemetry trailer (see records.vh). The issuer of the command
+ * (bits [31:11] of the pipe word, see commands.vh) is forwarded on "source".
  */
 module CommandUnit(
 	/* Standard pins */
@@ -21,8 +27,10 @@ module CommandUnit(
 
 	/* Starts command unit */
 	start,
-	/* When a COMM_FINISH command is received through the pipe, the module finishes execution and asserts done when finished */
+	/* When the last COMM_FINISH command is received through the pipe, the module finishes execution and asserts done when finished */
 	done,
+	/* Number of COMM_FINISH commands that end an execution */
+	finishes,
 
 	/* AXI4-Stream pipe sink */
 	pipeTDATA,
@@ -30,7 +38,13 @@ module CommandUnit(
 	pipeTREADY,
 
 	/* Generated command */
-	command
+	command,
+	/* Checkpoint bank of the generated command (see commands.vh) */
+	bank,
+	/* Issuer of the generated command, for NDRange DUTs (see commands.vh) */
+	source,
+	/* Number of commands received since start */
+	received
 );
 
 	input clk;
@@ -38,20 +52,54 @@ module CommandUnit(
 
 	input start;
 	output done;
+	input [31:0] finishes;
 
 	input [31:0] pipeTDATA;
 	input pipeTVALID;
 	output pipeTREADY;
 
 	output [3:0] command;
+	output [6:0] bank;
+	output [`COMM_SOURCE_WIDTH-1:0] source;
+	output [47:0] received;
 
 	reg [3:0] state;
+	reg [47:0] received;
+	/* COMM_FINISH commands still expected before finishing */
+	reg [31:0] pending;
+	wire finish;
+	wire lastFinish;
 
 	assign done = 'h0 == state;
 	/* This module is always ready to receive pipe commands (as long as the kernel is running) */
-	assign pipeTREADY = !done;
-	/* Command is only generated when kernel is running and value from pipe is valid */
-	assign command = ('h1 == state && pipeTVALID)? pipeTDATA[3:0] : `COMM_NOP;
+	assign pipeTREADY = 'h1 == state;
+	/* A COMM_FINISH command was received, and it is the last expected one */
+	assign finish = 'h1 == state && pipeTVALID && `COMM_FINISH == pipeTDATA[3:0];
+	assign lastFinish = finish && pending <= 'h1;
+	/* Command is only generated when kernel is running and value from pipe is valid (earlier COMM_FINISH commands are dropped) */
+	assign command = ('h1 == state && pipeTVALID && (!finish || lastFinish))? pipeTDATA[3:0] : `COMM_NOP;
+	/* Bank is only meaningful for COMM_CHECKPOINT commands */
+	assign bank = pipeTDATA[10:4];
+	/* Source is only meaningful for NDRange DUTs */
+	assign source = pipeTDATA[31:11];
+
+	/* Command counter, cleared on start */
+	always @(posedge clk) begin
+		if(!rst_n || start)
+			received <= 'h0;
+		else if('h1 == state && pipeTVALID && `COMM_NOP != pipeTDATA[3:0])
+			received <= received + 'h1;
+	end
+
+	/* Finish counter, loaded on start */
+	always @(posedge clk) begin
+		if(!rst_n)
+			pending <= 'h1;
+		else if(start)
+			pending <= ('h0 == finishes)? 'h1 : finishes;
+		else if(finish)
+			pending <= pending - 'h1;
+	end
 
 	/* Main FSM */
 	always @(posedge clk) begin
@@ -62,13 +110,21 @@ module CommandUnit(
 			/* State 0x0: kernel is idle */
 			if('h0 == state) begin
 				if(start) begin
-					state <= 'h1;
+					state <= 'h2;
 				end
 			end
+			/* State 0x2: first cycle after start, the writer enqueues the clocks record (see SequentialWriter) */
+			else if('h2 == state) begin
+				state <= 'h3;
+			end
+			/* State 0x3: second cycle after start, the writer enqueues the sync record */
+			else if('h3 == state) begin
+				state <= 'h1;
+			end
 			/* State 0x1: kernel is running and ready to receive orders */
 			else if('h1 == state) begin
-				/* COMM_FINISH command received, stop kernel */
-				if(pipeTVALID && `COMM_FINISH == pipeTDATA[3:0]) begin
+				/* Last COMM_FINISH command received, stop kernel */
+				if(lastFinish) begin
 					state <= 'h0;
 				end
 			end
@@ -0,0 +1,104 @@
+`timescale 1ns / 1ps
+
+/**
+ * AsyncFIFO
+ *
+ * First-word fall-through FIFO between two unrelated clocks. The read and write pointers cross domains as Gray codes through
+ * two-flop synchronisers, so at most one bit changes per crossing. Full and empty are computed from the synchronised pointers of the
+ * other side and are therefore pessimistic: an element dequeued (enqueued) becomes visible to the other side a few cycles later.
+ *
+ * The FIFO holds 2^ADDR_WIDTH elements, ADDR_WIDTH must be at least 2.
+ */
+module AsyncFIFO#(
+	parameter ADDR_WIDTH = 4,
+	parameter DATA_WIDTH = 32
+) (
+	/* Write side */
+	wclk,
+	wrst_n,
+	enqueue,
+	back,
+	full,
+
+	/* Read side */
+	rclk,
+	rrst_n,
+	dequeue,
+	front,
+	empty
+);
+
+	input wclk;
+	input wrst_n;
+	input enqueue;
+	input [DATA_WIDTH-1:0] back;
+	output full;
+
+	input rclk;
+	input rrst_n;
+	input dequeue;
+	output [DATA_WIDTH-1:0] front;
+	output empty;
+
+	/* Pointers have one extra bit to tell full from empty */
+	reg [ADDR_WIDTH:0] wBin;
+	reg [ADDR_WIDTH:0] wGray;
+	reg [ADDR_WIDTH:0] rBin;
+	reg [ADDR_WIDTH:0] rGray;
+	/* Synchronisers: read pointer into the write domain and write pointer into the read domain */
+	(* ASYNC_REG = "TRUE" *) reg [ADDR_WIDTH:0] rGraySync1;
+	(* ASYNC_REG = "TRUE" *) reg [ADDR_WIDTH:0] rGraySync2;
+	(* ASYNC_REG = "TRUE" *) reg [ADDR_WIDTH:0] wGraySync1;
+	(* ASYNC_REG = "TRUE" *) reg [ADDR_WIDTH:0] wGraySync2;
+	wire [ADDR_WIDTH:0] wBinNext;
+	wire [ADDR_WIDTH:0] rBinNext;
+
+	/* Distributed memory, written on the write clock and read asynchronously */
+	reg [DATA_WIDTH-1:0] mem [0:(1 << ADDR_WIDTH)-1];
+
+	/* Full when the write pointer is one lap ahead of the read pointer, i.e. the two MSBs of the Gray codes differ and the rest match */
+	assign full = wGray == {~rGraySync2[ADDR_WIDTH:ADDR_WIDTH-1], rGraySync2[ADDR_WIDTH-2:0]};
+	assign empty = rGray == wGraySync2;
+	assign front = mem[rBin[ADDR_WIDTH-1:0]];
+
+	assign wBinNext = wBin + (enqueue && !full);
+	assign rBinNext = rBin + (dequeue && !empty);
+
+	/* Write domain */
+	always @(posedge wclk) begin
+		if(!wrst_n) begin
+			wBin <= 'h0;
+			wGray <= 'h0;
+			rGraySync1 <= 'h0;
+			rGraySync2 <= 'h0;
+		end
+		else begin
+			wBin <= wBinNext;
+			wGray <= (wBinNext >> 1) ^ wBinNext;
+			rGraySync1 <= rGray;
+			rGraySync2 <= rGraySync1;
+		end
+	end
+
+	always @(posedge wclk) begin
+		if(enqueue && !full)
+			mem[wBin[ADDR_WIDTH-1:0]] <= back;
+	end
+
+	/* Read domain */
+	always @(posedge rclk) begin
+		if(!rrst_n) begin
+			rBin <= 'h0;
+			rGray <= 'h0;
+			wGraySync1 <= 'h0;
+			wGraySync2 <= 'h0;
+		end
+		else begin
+			rBin <= rBinNext;
+			rGray <= (rBinNext >> 1) ^ rBinNext;
+			wGraySync1 <= wGray;
+			wGraySync2 <= wGraySync1;
+		end
+	end
+
+endmodule
@@ -29,7 +29,9 @@ module FIFO#(
 	front,
 	/* Status signals */
 	full,
-	empty
+	empty,
+	/* Number of stored elements */
+	count
 );
 
 	input clk;
@@ -41,6 +43,7 @@ module FIFO#(
 	output [DATA_WIDTH-1:0] front;
 	output full;
 	output empty;
+	output [15:0] count;
 
 	reg [`CLOG2(SIZE)-1:0] backPointer;
 	reg [`CLOG2(SIZE)-1:0] frontPointer;
@@ -55,6 +58,7 @@ module FIFO#(
 	assign front = rawDetected? rawReg : ramReadData;
 	assign full = SIZE == occupied;
 	assign empty = 'h0 == occupied;
+	assign count = occupied;
 
 	/* Enqueue only happens when FIFO is not full */
 	assign commitEnqueue = enqueue && !full;
@@ -0,0 +1,153 @@
+`timescale 1ns / 1ps
+
+`include "commands.vh"
+
+/**
+ * PipeCrossing
+ *
+ * Moves the commands of pipe p0 from the DUT clock domain to the ProfCounter clock domain (see DUT_CLOCK_DOMAIN in config.vh).
+ * Commands are timestamped on the DUT side, when they are accepted from the pipe, by a Timestamper running on the DUT clock. Each
+ * command crosses an AsyncFIFO together with its timestamp, so that timestamps count DUT cycles and are not affected by the crossing
+ * latency.
+ *
+ * The start pulse crosses to the DUT side as a toggle. As with CommandUnit, the pipe is only ready between start and the last
+ * expected COMM_FINISH ("finishes"). The prescaler and the number of finishes are quasi-static (set by the host before start) and are
+ * simply synchronised.
+ */
+module PipeCrossing#(
+	parameter COUNTER_WIDTH = 56
+) (
+	/* ProfCounter clock domain */
+	clk,
+	rst_n,
+	/* Kernel start pulse */
+	start,
+	/* Log2 of the number of DUT cycles per timestamp count */
+	prescaler,
+	/* Number of COMM_FINISH commands that end an execution (see CommandUnit) */
+	finishes,
+	/* AXI4-Stream towards CommandUnit */
+	outTDATA,
+	outTVALID,
+	outTREADY,
+	/* Timestamp of the command at outTDATA (DUT cycles) */
+	timestamp,
+
+	/* DUT clock domain */
+	dutClk,
+	dutRst_n,
+	/* AXI4-Stream pipe sink */
+	pipeTDATA,
+	pipeTVALID,
+	pipeTREADY
+);
+
+	input clk;
+	input rst_n;
+	input start;
+	input [4:0] prescaler;
+	input [31:0] finishes;
+	output [31:0] outTDATA;
+	output outTVALID;
+	input outTREADY;
+	output [63:0] timestamp;
+
+	input dutClk;
+	input dutRst_n;
+	input [31:0] pipeTDATA;
+	input pipeTVALID;
+	output pipeTREADY;
+
+	/* Start toggle, flipped on every start pulse */
+	reg startToggle;
+	(* ASYNC_REG = "TRUE" *) reg [2:0] dutStartSync;
+	(* ASYNC_REG = "TRUE" *) reg [4:0] dutPrescalerSync1;
+	(* ASYNC_REG = "TRUE" *) reg [4:0] dutPrescalerSync2;
+	(* ASYNC_REG = "TRUE" *) reg [31:0] dutFinishesSync1;
+	(* ASYNC_REG = "TRUE" *) reg [31:0] dutFinishesSync2;
+	/* COMM_FINISH commands still expected on the DUT side */
+	reg [31:0] dutPending;
+	wire dutFinish;
+	wire dutStart;
+	wire dutAccept;
+	wire [3:0] dutCommand;
+	wire dutStamperDone;
+	wire [63:0] dutTimestamp;
+	wire fifoFull;
+	wire fifoEmpty;
+	wire [COUNTER_WIDTH+31:0] fifoFront;
+
+	/* Start pulse crossing */
+	always @(posedge clk) begin
+		if(!rst_n)
+			startToggle <= 1'b0;
+		else if(start)
+			startToggle <= ~startToggle;
+	end
+	always @(posedge dutClk) begin
+		if(!dutRst_n) begin
+			dutStartSync <= 'h0;
+			dutPrescalerSync1 <= 'h0;
+			dutPrescalerSync2 <= 'h0;
+			dutFinishesSync1 <= 'h0;
+			dutFinishesSync2 <= 'h0;
+		end
+		else begin
+			dutStartSync <= {dutStartSync[1:0], startToggle};
+			dutPrescalerSync1 <= prescaler;
+			dutPrescalerSync2 <= dutPrescalerSync1;
+			dutFinishesSync1 <= finishes;
+			dutFinishesSync2 <= dutFinishesSync1;
+		end
+	end
+	assign dutStart = dutStartSync[2] != dutStartSync[1];
+
+	/* The pipe is only ready while the DUT-side counter is running, i.e. between start and the last COMM_FINISH */
+	assign pipeTREADY = !dutStamperDone && !dutStart && !fifoFull;
+	assign dutAccept = pipeTVALID && pipeTREADY;
+	assign dutFinish = dutAccept && `COMM_FINISH == pipeTDATA[3:0];
+	/* All commands cross, but only the last COMM_FINISH stops the DUT-side counter */
+	assign dutCommand = (dutAccept && (!dutFinish || dutPending <= 'h1))? pipeTDATA[3:0] : `COMM_NOP;
+
+	/* DUT-side finish counter, loaded on start */
+	always @(posedge dutClk) begin
+		if(!dutRst_n)
+			dutPending <= 'h1;
+		else if(dutStart)
+			dutPending <= ('h0 == dutFinishesSync2)? 'h1 : dutFinishesSync2;
+		else if(dutFinish)
+			dutPending <= dutPending - 'h1;
+	end
+
+	/* DUT-side cycle counter */
+	Timestamper#(COUNTER_WIDTH) dutStamper(
+		.clk(dutClk),
+		.rst_n(dutRst_n),
+
+		.start(dutStart),
+		.done(dutStamperDone),
+		.command(dutCommand),
+		.prescaler(dutPrescalerSync2),
+		.timestamp(dutTimestamp)
+	);
+
+	/* Commands and their timestamps */
+	AsyncFIFO#(4, COUNTER_WIDTH + 32) fifo(
+		.wclk(dutClk),
+		.wrst_n(dutRst_n),
+		.enqueue(dutAccept),
+		.back({dutTimestamp[COUNTER_WIDTH-1:0], pipeTDATA}),
+		.full(fifoFull),
+
+		.rclk(clk),
+		.rrst_n(rst_n),
+		.dequeue(outTREADY),
+		.front(fifoFront),
+		.empty(fifoEmpty)
+	);
+
+	assign outTDATA = fifoFront[31:0];
+	assign outTVALID = !fifoEmpty;
+	assign timestamp = fifoFront[COUNTER_WIDTH+31:32];
+
+endmodule
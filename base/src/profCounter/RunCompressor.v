@@ -0,0 +1,142 @@
+`timescale 1ns / 1ps
+
+`include "records.vh"
+
+/**
+ * RunCompressor
+ *
+ * Collapses runs of event records (stamps and checkpoints) into repeat records before they reach the writer FIFO (see RUN_COMPRESSION
+ * in config.vh). A run is a sequence of consecutive records with the same tag, each one the same distance (delta) after the previous
+ * one, e.g. a checkpoint inside a steady-state loop. The run is held here while it grows and is written as a single record when it
+ * ends:
+ *
+ * - A run of one record is written unchanged (i.e. with its absolute timestamp);
+ * - A longer run is written as a repeat record (tag, count, delta), meaning "count records with this tag, the first one delta after
+ *   the previous record of the log, each following one delta after its predecessor".
+ *
+ * Timestamps are tracked on the lattice reconstructed by the host (previous record + k * delta), and a record only extends the run if
+ * it is at most TOLERANCE counts after the next lattice point. Expanded timestamps are therefore never later than the measured ones
+ * nor more than TOLERANCE counts earlier, and exact when TOLERANCE is 0. Since the lattice never gets ahead of the measured
+ * timestamps, the timestamps seen by the host still increase monotonically (which its wrap-around detection relies on).
+ *
+ * Runs end on a different tag, on a delta out of tolerance, when the count saturates and on COMM_FINISH, whose marker is then
+ * forwarded in the following cycle.
+ *
+ * Other records (log header, clocks record) are forwarded unchanged. If ENABLE is 0, every record is forwarded unchanged.
+ */
+module RunCompressor#(
+	parameter COUNTER_WIDTH = 56,
+	parameter TOLERANCE = 0,
+	parameter ENABLE = 1
+) (
+	/* Standard pins */
+	clk,
+	rst_n,
+
+	/* Kernel start pulse, any run state is cleared */
+	start,
+	/* Record stream from SequentialWriter */
+	inEnqueue,
+	inRecord,
+	/* Compressed record stream towards the writer FIFO */
+	outEnqueue,
+	outRecord,
+	/* Asserted when no record is pending */
+	idle
+);
+
+	/* Largest run count of a repeat record */
+	localparam [15:0] MAX_COUNT = 16'hFFFF;
+	localparam [COUNTER_WIDTH-1:0] COUNTER_TOLERANCE = TOLERANCE;
+
+	input clk;
+	input rst_n;
+
+	input start;
+	input inEnqueue;
+	input [63:0] inRecord;
+	output outEnqueue;
+	output [63:0] outRecord;
+	output idle;
+
+	/* Run being held: tag, number of records, delta and lattice timestamp of its last record */
+	reg runActive;
+	reg [7:0] runTag;
+	reg [15:0] runCount;
+	reg [COUNTER_WIDTH-1:0] runDelta;
+	reg [COUNTER_WIDTH-1:0] runTime;
+	/* The COMM_FINISH marker is forwarded the cycle after the last run is written */
+	reg finishPending;
+
+	wire [7:0] inTag;
+	wire [COUNTER_WIDTH-1:0] inTime;
+	wire isFinish;
+	wire isEvent;
+	/* Distance from the last record of the run, and from the next lattice point (both modulo the counter width) */
+	wire [COUNTER_WIDTH-1:0] delta;
+	wire [COUNTER_WIDTH-1:0] late;
+	wire [55:0] runTimestamp;
+	wire match;
+	wire [63:0] runRecord;
+
+	assign inTag = inRecord[63:56];
+	assign inTime = inRecord[COUNTER_WIDTH-1:0];
+	/* COMM_FINISH is enqueued as -1 (see SequentialWriter), its tag would otherwise look like a checkpoint */
+	assign isFinish = 'hFFFFFFFFFFFFFFFF == inRecord;
+	assign isEvent = !isFinish && (`REC_STAMP == inTag || (inTag & `REC_CHECKPOINT));
+
+	assign delta = inTime - runTime;
+	assign late = delta - runDelta;
+	/* Repeat records hold a 32-bit delta */
+	assign match = runActive && inTag == runTag && runCount != MAX_COUNT && runDelta <= 'hFFFFFFFF &&
+		late <= COUNTER_TOLERANCE;
+
+	/* A single record keeps its absolute timestamp, longer runs become a repeat record */
+	assign runTimestamp = runTime;
+	assign runRecord = ('h1 == runCount)? {runTag, runTimestamp} : {`REC_REPEAT, runTag, runCount, runDelta[31:0]};
+
+	/* Events are only written when they end a run, other records always produce one */
+	assign outEnqueue = !ENABLE? inEnqueue : finishPending || (inEnqueue && (!isEvent || (runActive && !match)));
+	assign outRecord = !ENABLE? inRecord :
+		finishPending? 'hFFFFFFFFFFFFFFFF :
+		(isEvent || isFinish) && runActive? runRecord :
+		inRecord;
+	assign idle = !runActive && !finishPending;
+
+	always @(posedge clk) begin
+		if(!rst_n || start || !ENABLE) begin
+			runActive <= 1'b0;
+			runTag <= 'h0;
+			runCount <= 'h0;
+			runDelta <= 'h0;
+			/* The host decoder starts from timestamp 0 as well */
+			runTime <= 'h0;
+			finishPending <= 1'b0;
+		end
+		else begin
+			finishPending <= 1'b0;
+
+			if(inEnqueue && isEvent) begin
+				/* Record is on the lattice of the run, extend it */
+				if(match) begin
+					runCount <= runCount + 'h1;
+					runTime <= runTime + runDelta;
+				end
+				/* Otherwise the run (if any) is written and this record starts a new one, one delta after the last written record */
+				else begin
+					runActive <= 1'b1;
+					runTag <= inTag;
+					runCount <= 'h1;
+					runDelta <= delta;
+					runTime <= inTime;
+				end
+			end
+			/* Last run is written, COMM_FINISH follows */
+			else if(inEnqueue && isFinish && runActive) begin
+				runActive <= 1'b0;
+				finishPending <= 1'b1;
+			end
+		end
+	end
+
+endmodule
@@ -0,0 +1,123 @@
+`timescale 1ns / 1ps
+
+`include "commands.vh"
+`include "records.vh"
+
+/**
+ * Sampler
+ *
+ * Periodic sampling of the DUT position, enabled when the "interval" kernel argument is not zero. Checkpoints then produce no record
+ * and only update the current checkpoint, i.e. the region the DUT is in. Every "interval" cycles from start, a sample record is
+ * generated with the timestamp, the current checkpoint and the number of checkpoints since the previous sample (see records.vh), so
+ * the log grows with the execution time and not with the checkpoint rate.
+ *
+ * The interval is taken on start, and "sampling" tells the writer to drop stamps and checkpoints for the whole execution. Samples
+ * are generated until COMM_FINISH is received. A sample falling on a cycle where the writer enqueues another record (log
+ * header, clocks or sync record) is generated in the following cycle. The number of checkpoints saturates at 4095.
+ */
+module Sampler(
+	/* Standard pins */
+	clk,
+	rst_n,
+
+	/* Kernel start pulse, the sampling state is cleared */
+	start,
+	/* Cycles between samples, 0 disables sampling */
+	interval,
+	/* Asserted if the current execution is sampled */
+	sampling,
+	/* Command generated by commandUnit */
+	command,
+	/* Checkpoint ID of the command (only meaningful for COMM_CHECKPOINT) */
+	checkpointId,
+	/* Current timestamp */
+	timestamp,
+	/* Asserted when the writer enqueues another record in this cycle */
+	busy,
+	/* Sample record */
+	sampleEnqueue,
+	sampleRecord
+);
+
+	localparam [11:0] HITS_MAX = 12'hFFF;
+
+	input clk;
+	input rst_n;
+
+	input start;
+	input [31:0] interval;
+	output sampling;
+	input [3:0] command;
+	input [6:0] checkpointId;
+	input [63:0] timestamp;
+	input busy;
+	output sampleEnqueue;
+	output [63:0] sampleRecord;
+
+	/* Asserted from start to COMM_FINISH */
+	reg running;
+	/* Interval of the current execution */
+	reg [31:0] period;
+	/* Cycles left to the next sample */
+	reg [31:0] countdown;
+	/* A sample is due but was not generated yet */
+	reg pending;
+	/* Last checkpoint seen, whether there was one, and checkpoints since the previous sample */
+	reg [6:0] current;
+	reg seen;
+	reg [11:0] hits;
+
+	wire isCheckpoint;
+	wire due;
+
+	assign isCheckpoint = `COMM_NOP != command && command < `COMM_STAMP;
+	assign sampling = 'h0 != period;
+	assign due = running && sampling && 'h0 == countdown;
+
+	/* Samples never follow COMM_FINISH, whose marker must be the last record of the execution */
+	assign sampleEnqueue = running && (due || pending) && !busy && `COMM_FINISH != command;
+	assign sampleRecord = {`REC_SAMPLE, current, seen, hits, timestamp[35:0]};
+
+	always @(posedge clk) begin
+		if(!rst_n) begin
+			running <= 'b0;
+			period <= 'h0;
+			countdown <= 'h0;
+			pending <= 'b0;
+		end
+		else if(start) begin
+			running <= 'b1;
+			period <= interval;
+			countdown <= interval - 'h1;
+			pending <= 'b0;
+		end
+		else if(running) begin
+			if(`COMM_FINISH == command)
+				running <= 'b0;
+
+			countdown <= ('h0 == countdown)? (period - 'h1) : (countdown - 'h1);
+			pending <= (due || pending) && !sampleEnqueue;
+		end
+	end
+
+	/* Current checkpoint is kept across samples, hit count restarts with each sample */
+	always @(posedge clk) begin
+		if(!rst_n || start) begin
+			current <= 'h0;
+			seen <= 'b0;
+			hits <= 'h0;
+		end
+		else begin
+			if(isCheckpoint) begin
+				current <= checkpointId;
+				seen <= 'b1;
+			end
+
+			if(sampleEnqueue)
+				hits <= isCheckpoint? 'h1 : 'h0;
+			else if(isCheckpoint && HITS_MAX != hits)
+				hits <= hits + 'h1;
+		end
+	end
+
+endmodule
@@ -1,20 +1,81 @@
 `timescale 1ns / 1ps
 
 `include "commands.vh"
+`include "records.vh"
 
-module SequentialWriter(
+/**
+ * SequentialWriter
+ *
+ * AXI4 Master that writes the timestamp records onto the "log" global memory array. Each record is 64-bit wide, and when the
+ * AXI4 data bus is wider than that, up to DATA_WIDTH/64 consecutive records are packed into a single beat. A partially-filled beat
+ * is only written when COMM_FINISH is received, in which case the byte strobes mask the unused record slots.
+ *
+ * When the kernel starts, a header record describing the timestamp format is enqueued before any other record, followed by a
+ * record with the clock frequencies and a sync record with the cycles since reset (see records.vh). CommandUnit generates no command
+ * in the two cycles after start for this purpose. Instances sharing a reset thus stamp their starts on a common time base.
+ *
+ * The writer also keeps telemetry about itself: FIFO high-water mark and dropped records, cycles blocked on each AXI4 channel and
+ * a histogram of write latencies. When COMM_FINISH is dequeued, these are written as a trailer of telemetry records after the last
+ * event, so that a single log tells whether lost or late records come from the writer or from memory contention.
+ *
+ * If RUN_COMPRESSION is set, records go through a RunCompressor before the FIFO, which collapses runs of records with the same tag
+ * and delta into repeat records (see records.vh). The FIFO, the telemetry and the memory writes then account for compressed records.
+ *
+ * If AXI_MONITOR is set, records first go through an AxiMonitor, which follows every checkpoint with the traffic of the monitored
+ * DUT port since the previous one (see records.vh).
+ *
+ * If NDRANGE is set, stamps and checkpoints carry the issuing work-group and local ID hash ("source") above a 35-bit timestamp, and
+ * the header flags the log as such (see records.vh). COUNTER_WIDTH must then be at most 35.
+ *
+ * If the "interval" kernel argument is not zero, the execution is sampled: stamps and checkpoints are not written, and a Sampler
+ * generates a sample record every "interval" cycles instead, with the timestamp taken from "clock".
+ *
+ * The number of records acknowledged by global memory since start is also provided, for the log watermark interrupt.
+ */
+module SequentialWriter#(
+	parameter DATA_WIDTH = 64,
+	parameter COUNTER_WIDTH = 56,
+	parameter FIFO_DEPTH = 256,
+	/* Clock frequencies (MHz) and timestamp domain, recorded in the clocks record */
+	parameter KERNEL_CLOCK_MHZ = 0,
+	parameter DUT_CLOCK_MHZ = 0,
+	parameter DUT_TIMESTAMPS = 0,
+	/* Run compression of the record stream, with the tolerance (in counts) of the expanded timestamps */
+	parameter RUN_COMPRESSION = 0,
+	parameter RUN_TOLERANCE = 0,
+	/* Traffic records from the monitored DUT port */
+	parameter AXI_MONITOR = 0,
+	/* Issuer of stamps and checkpoints in the records, for NDRange DUTs */
+	parameter NDRANGE = 0
+) (
 	/* Standard pins */
 	clk,
 	rst_n,
 
+	/* Kernel start pulse, the log header is enqueued */
+	start,
+	/* Log2 of the number of cycles per timestamp count, recorded in the log header */
+	prescaler,
 	/* Base address of "log" global memory where the timestamps are saved */
 	offset,
 	/* Command generated by commandUnit */
 	command,
+	/* Checkpoint bank of the command generated by commandUnit */
+	bank,
+	/* Issuer of the command generated by commandUnit (see commands.vh) */
+	source,
 	/* Timestamp value to be written */
 	value,
+	/* Free-running timestamp of ProfCounter, for samples */
+	clock,
+	/* Cycles between samples, 0 logs every event */
+	interval,
+	/* Number of commands received by commandUnit, recorded in the telemetry trailer */
+	received,
 	/* Asserted when this module is done/idling */
 	idle,
+	/* Number of records written to global memory (acknowledged) since start */
+	written,
 
 	/* AXI4 Master to global memory */
 	axiAWVALID,
@@ -29,16 +90,56 @@ module SequentialWriter(
 	axiWLAST,
 	axiBRESP,
 	axiBVALID,
-	axiBREADY
+	axiBREADY,
+
+	/* Monitored AXI4 master of the DUT (see AxiMonitor) */
+	monARVALID,
+	monARREADY,
+	monARLEN,
+	monARSIZE,
+	monRVALID,
+	monRREADY,
+	monRLAST,
+	monAWVALID,
+	monAWREADY,
+	monAWLEN,
+	monAWSIZE,
+	monWVALID,
+	monWREADY,
+	monBVALID,
+	monBREADY
 );
 
+	/* Number of 64-bit records packed per AXI4 beat */
+	localparam RECORDS_PER_BEAT = DATA_WIDTH / 64;
+	/* Number of bytes per AXI4 beat */
+	localparam STRB_WIDTH = DATA_WIDTH / 8;
+	/* Counter width as recorded in the log header */
+	localparam [7:0] HEADER_COUNTER_WIDTH = COUNTER_WIDTH;
+	/* Clocks record */
+	localparam [15:0] CLOCKS_KERNEL_MHZ = KERNEL_CLOCK_MHZ;
+	localparam [15:0] CLOCKS_DUT_MHZ = DUT_CLOCK_MHZ;
+	localparam [0:0] CLOCKS_DUT_TIMESTAMPS = DUT_TIMESTAMPS;
+	/* Header flag of NDRange logs */
+	localparam [0:0] HEADER_NDRANGE = NDRANGE;
+	/* AXI4 burst size encoding for a full beat */
+	localparam AXI_SIZE = (512 == DATA_WIDTH)? 3'b110 : ((256 == DATA_WIDTH)? 3'b101 : ((128 == DATA_WIDTH)? 3'b100 : 3'b011));
+
 	input clk;
 	input rst_n;
 
+	input start;
+	input [4:0] prescaler;
 	input [63:0] offset;
 	input [3:0] command;
+	input [6:0] bank;
+	input [`COMM_SOURCE_WIDTH-1:0] source;
 	input [63:0] value;
+	input [63:0] clock;
+	input [31:0] interval;
+	input [47:0] received;
 	output idle;
+	output [31:0] written;
 
 	output axiAWVALID;
 	input axiAWREADY;
@@ -47,38 +148,139 @@ module SequentialWriter(
 	output [2:0] axiAWSIZE;
 	output axiWVALID;
 	input axiWREADY;
-	output [63:0] axiWDATA;
-	output [7:0] axiWSTRB;
+	output [DATA_WIDTH-1:0] axiWDATA;
+	output [STRB_WIDTH-1:0] axiWSTRB;
 	output axiWLAST;
 	input [1:0] axiBRESP;
 	input axiBVALID;
 	output axiBREADY;
 
+	input monARVALID;
+	input monARREADY;
+	input [7:0] monARLEN;
+	input [2:0] monARSIZE;
+	input monRVALID;
+	input monRREADY;
+	input monRLAST;
+	input monAWVALID;
+	input monAWREADY;
+	input [7:0] monAWLEN;
+	input [2:0] monAWSIZE;
+	input monWVALID;
+	input monWREADY;
+	input monBVALID;
+	input monBREADY;
+
 	reg [7:0] state;
 	reg hold;
+	/* Start delayed by one and two cycles, the clocks and sync records are enqueued */
+	reg startRegistered;
+	reg syncRegistered;
+	/* Cycles since reset, and their value on start for the sync record */
+	reg [55:0] uptime;
+	reg [55:0] syncStamp;
 	reg [63:0] addrCounter;
 	reg [63:0] wAddr;
-	reg [63:0] wData;
+	reg [DATA_WIDTH-1:0] wData;
+	reg [STRB_WIDTH-1:0] wStrb;
+	/* Next free record slot in the beat being packed */
+	reg [3:0] slot;
+	/* Asserted while the telemetry trailer is being packed, then while the last beat is flushed */
+	reg trailer;
+	reg flush;
+	reg [3:0] trailerField;
+
+	/* Telemetry, cleared on start and frozen when COMM_FINISH is dequeued (i.e. the trailer does not account for itself) */
+	reg frozen;
+	reg [47:0] telHighWater;
+	reg [47:0] telDropped;
+	reg [47:0] telWrites;
+	reg [47:0] telAwBlocked;
+	reg [47:0] telWBlocked;
+	reg [47:0] telBBlocked;
+	reg [47:0] telHistogram [0:7];
+	/* Cycles since AWVALID was asserted for the current write (saturating) */
+	reg [15:0] latency;
+	wire [2:0] latencyBin;
+	reg [47:0] trailerValue;
+	wire [63:0] trailerRecord;
+	/* Records written since start, and records in the beat being written */
+	reg [31:0] writtenCounter;
+	reg [4:0] beatRecords;
+	/* Record being packed: a telemetry field during the trailer, otherwise the FIFO front */
+	wire [63:0] record;
+	integer i;
+	integer j;
+
+	/* Checkpoint ID of the current command (see commands.vh) */
+	wire [10:0] checkpointId;
+	/* Payload of stamps and checkpoints: timestamp, preceded by the issuer with NDRANGE */
+	wire [55:0] eventPayload;
+
+	/* Periodic samples */
+	wire sampling;
+	wire commandEnqueue;
+	wire sampleEnqueue;
+	wire [63:0] sampleRecord;
+
+	/* Record stream, before traffic records and compression */
+	wire recordEnqueue;
+	wire [63:0] recordIn;
+	wire monitorEnqueue;
+	wire [63:0] monitorOut;
+	wire monitorIdle;
+	wire monitorDropped;
+	wire compressorIdle;
 
 	wire fifoEnqueue;
 	wire fifoDequeue;
 	wire [63:0] fifoIn;
 	wire [63:0] fifoOut;
 	wire fifoIsEmpty;
+	wire fifoIsFull;
+	wire [15:0] fifoCount;
 
-	assign idle = 'h00 == state && fifoIsEmpty;
+	assign idle = 'h00 == state && monitorIdle && compressorIdle && fifoIsEmpty && 'h0 == slot && !trailer && !flush;
 
 	assign axiAWVALID = 'h01 == state;
 	assign axiAWADDR = wAddr;
-	assign axiAWLEN = 8'h01;
-	assign axiAWSIZE = 3'b011;
+	/* Single-beat bursts (AWLEN is the number of beats minus one) */
+	assign axiAWLEN = 8'h00;
+	assign axiAWSIZE = AXI_SIZE;
 	assign axiWVALID = 'h02 == state;
 	assign axiWDATA = wData;
-	assign axiWSTRB = 8'hFF;
+	assign axiWSTRB = wStrb;
 	assign axiWLAST = 1'b1;
 
 	assign axiBREADY = 'h03 == state;
 
+	assign written = writtenCounter;
+
+	/* Register start signal */
+	always @(posedge clk) begin
+		if(!rst_n) begin
+			startRegistered <= 1'b0;
+			syncRegistered <= 1'b0;
+		end
+		else begin
+			startRegistered <= start;
+			syncRegistered <= startRegistered;
+		end
+	end
+
+	/* Free-running cycle counter, not prescaled, latched on start for the sync record */
+	always @(posedge clk) begin
+		if(!rst_n) begin
+			uptime <= 'h0;
+			syncStamp <= 'h0;
+		end
+		else begin
+			uptime <= uptime + 'h1;
+			if(start)
+				syncStamp <= uptime;
+		end
+	end
+
 	/* Hold logic. If COMM_HOLD is received, FIFO dequeuing is paused until a COMM_FINISH is issued */
 	always @(posedge clk) begin
 		if(!rst_n) begin
@@ -101,24 +303,60 @@ module SequentialWriter(
 			addrCounter <= 'h00;
 			wAddr <= 'h00;
 			wData <= 'h00;
+			wStrb <= 'h00;
+			slot <= 'h0;
+			trailer <= 1'b0;
+			flush <= 1'b0;
+			trailerField <= 'h0;
 		end
 		else begin
-			/* Idle state */
+			/* Idle state, records are packed into the current beat */
 			if('h00 == state) begin
-				/* FIFO is not empty, there is stuff to save */
-				if(!hold && !fifoIsEmpty) begin
-					/* If value is -1 (64-bit), this is a COMM_FINISH command. Reset address counter */
-					if('hFFFFFFFFFFFFFFFF == fifoOut) begin
-						addrCounter <= 'h0;
-					end
-					/* Else, it is a normal stamp request. Process it accordingly */
-					else begin
-						addrCounter <= addrCounter + 'h08;
+				/* Trailer is packed, flush the partially-filled beat (if any) and reset address counter */
+				if(flush) begin
+					if(slot != 'h0) begin
 						wAddr <= offset + addrCounter;
-						wData <= fifoOut;
 
 						state <= 'h01;
 					end
+
+					addrCounter <= 'h0;
+					slot <= 'h0;
+					flush <= 1'b0;
+				end
+				/* FIFO is not empty (or the trailer is being packed), there is stuff to save */
+				else if(trailer || (!hold && !fifoIsEmpty)) begin
+					/* If value is -1 (64-bit), this is a COMM_FINISH command. The telemetry trailer follows the last event */
+					if(!trailer && 'hFFFFFFFFFFFFFFFF == fifoOut) begin
+						trailer <= 1'b1;
+						trailerField <= 'h0;
+					end
+					/* Else, it is a normal stamp request or a telemetry field. Pack it into the next free slot */
+					else begin
+						wData[slot * 64 +: 64] <= record;
+						wStrb[slot * 8 +: 8] <= 8'hFF;
+
+						if(trailer) begin
+							trailerField <= trailerField + 'h1;
+
+							if((`TEL_FIELDS - 1) == trailerField) begin
+								trailer <= 1'b0;
+								flush <= 1'b1;
+							end
+						end
+
+						/* Beat is full, write it */
+						if((RECORDS_PER_BEAT - 1) == slot) begin
+							addrCounter <= addrCounter + STRB_WIDTH;
+							wAddr <= offset + addrCounter;
+							slot <= 'h0;
+
+							state <= 'h01;
+						end
+						else begin
+							slot <= slot + 'h1;
+						end
+					end
 				end
 			end
 			/* Wait for AXI4 Slave to be ready to receive address */
@@ -136,6 +374,8 @@ module SequentialWriter(
 			/* Wait for AXI4 Slave to acknowledge that data was received */
 			else if('h03 == state) begin
 				if(axiBVALID) begin
+					wStrb <= 'h00;
+
 					state <= 'h00;
 				end
 			end
@@ -145,16 +385,172 @@ module SequentialWriter(
 		end
 	end
 
-	/* Elements are enqueued every time command is not COMM_NOP or COMM_HOLD */
-	assign fifoEnqueue = command != `COMM_NOP && command != `COMM_HOLD;
-	/* Elements are dequeued every time this FSM goes to idle and hold period is over (if applicable) */
-	assign fifoDequeue = 'h00 == state && !hold;
+	/* Telemetry logic */
+	always @(posedge clk) begin
+		if(!rst_n || start) begin
+			frozen <= 1'b0;
+			telHighWater <= 'h0;
+			telDropped <= 'h0;
+			telWrites <= 'h0;
+			telAwBlocked <= 'h0;
+			telWBlocked <= 'h0;
+			telBBlocked <= 'h0;
+			for(i = 0; i < 8; i = i + 1)
+				telHistogram[i] <= 'h0;
+		end
+		else if(!frozen) begin
+			/* COMM_FINISH is being dequeued, values are kept for the trailer */
+			if('h00 == state && !hold && !fifoIsEmpty && 'hFFFFFFFFFFFFFFFF == fifoOut)
+				frozen <= 1'b1;
+
+			if(fifoCount > telHighWater)
+				telHighWater <= fifoCount;
+			/* Records are dropped by a full writer FIFO or a full monitor queue */
+			telDropped <= telDropped + (fifoEnqueue && fifoIsFull) + monitorDropped;
+
+			if('h01 == state && !axiAWREADY)
+				telAwBlocked <= telAwBlocked + 'h1;
+			if('h02 == state && !axiWREADY)
+				telWBlocked <= telWBlocked + 'h1;
+			if('h03 == state && !axiBVALID)
+				telBBlocked <= telBBlocked + 'h1;
+
+			if('h03 == state && axiBVALID) begin
+				telWrites <= telWrites + 'h1;
+				telHistogram[latencyBin] <= telHistogram[latencyBin] + 'h1;
+			end
+		end
+	end
+
+	/* Records written, counted when each beat is acknowledged. Unused slots of the last beat are masked by the byte strobes */
+	always @(*) begin
+		beatRecords = 'h0;
+		for(j = 0; j < RECORDS_PER_BEAT; j = j + 1)
+			beatRecords = beatRecords + wStrb[j * 8];
+	end
+	always @(posedge clk) begin
+		if(!rst_n || start)
+			writtenCounter <= 'h0;
+		else if('h03 == state && axiBVALID)
+			writtenCounter <= writtenCounter + beatRecords;
+	end
+
+	/* Write latency, counted from the cycle AWVALID is asserted up to the cycle BVALID is received (inclusive) */
+	always @(posedge clk) begin
+		if('h00 == state)
+			latency <= 'h1;
+		else if(latency != 'hFFFF)
+			latency <= latency + 'h1;
+	end
+	assign latencyBin = (latency >= 'd256)? 'h7 : (latency >= 'd128)? 'h6 : (latency >= 'd64)? 'h5 : (latency >= 'd32)? 'h4 :
+		(latency >= 'd16)? 'h3 : (latency >= 'd8)? 'h2 : (latency >= 'd4)? 'h1 : 'h0;
+
+	/* Telemetry trailer fields (see records.vh) */
+	always @(*) begin
+		case(trailerField)
+			`TEL_FIFO_HIGH_WATER:
+				trailerValue = telHighWater;
+			`TEL_FIFO_DEPTH:
+				trailerValue = FIFO_DEPTH;
+			`TEL_DROPPED:
+				trailerValue = telDropped;
+			`TEL_RECEIVED:
+				trailerValue = received;
+			`TEL_WRITES:
+				trailerValue = telWrites;
+			`TEL_AW_BLOCKED:
+				trailerValue = telAwBlocked;
+			`TEL_W_BLOCKED:
+				trailerValue = telWBlocked;
+			`TEL_B_BLOCKED:
+				trailerValue = telBBlocked;
+			default:
+				trailerValue = telHistogram[trailerField[2:0]];
+		endcase
+	end
+	assign trailerRecord = {`REC_TELEMETRY, 4'h0, trailerField, trailerValue};
+	assign record = trailer? trailerRecord : fifoOut;
+
+	/* Elements are enqueued on start (log header), the two cycles after (clocks and sync records) and every time command is not */
+	/* COMM_NOP or COMM_HOLD. CommandUnit only generates commands from the third cycle after start, so these never happen at the same */
+	/* cycle. When sampling, COMM_FINISH is the only command enqueued, and samples are enqueued in cycles without any other record */
+	assign commandEnqueue = command != `COMM_NOP && command != `COMM_HOLD && (!sampling || `COMM_FINISH == command);
+	assign recordEnqueue = start || startRegistered || syncRegistered || commandEnqueue || sampleEnqueue;
+	/* Elements are dequeued every time this FSM goes to idle and hold period is over (if applicable), except during the trailer */
+	assign fifoDequeue = 'h00 == state && !hold && !trailer && !flush;
 	/* The input data is based on the command. If COMM_STAMP, the timestamp is enqueued, if COMM_FINISH, -1 is enqueued */
 	/* For other values different from COMM_NOP and COMM_HOLD, the checkpoint ID is saved with the timestamp (COMM_CHECKPOINT) */
-	assign fifoIn = (`COMM_FINISH == command)? 'hFFFFFFFFFFFFFFFF : ((`COMM_STAMP == command)? value : {command[3:0] - 4'h1, value[59:0]});
+	assign checkpointId = bank * `COMM_CHECKPOINTS_PER_BANK + command - 'h1;
+	assign eventPayload = NDRANGE? {source, value[34:0]} : value[55:0];
+	assign recordIn = start? {`REC_HEADER, `LOG_VERSION, HEADER_COUNTER_WIDTH, 2'b00, HEADER_NDRANGE, prescaler, `LOG_MAGIC} :
+		startRegistered? {`REC_CLOCKS, 23'h0, CLOCKS_DUT_TIMESTAMPS, CLOCKS_KERNEL_MHZ, CLOCKS_DUT_MHZ} :
+		syncRegistered? {`REC_SYNC, syncStamp} :
+		sampleEnqueue? sampleRecord :
+		(`COMM_FINISH == command)? 'hFFFFFFFFFFFFFFFF :
+		(`COMM_STAMP == command)? {`REC_STAMP, eventPayload} :
+		{`REC_CHECKPOINT | {1'b0, checkpointId[6:0]}, eventPayload};
+
+	/* Periodic samples, never generated if "interval" is zero */
+	Sampler sampler(
+		.clk(clk),
+		.rst_n(rst_n),
+
+		.start(start),
+		.interval(interval),
+		.sampling(sampling),
+		.command(command),
+		.checkpointId(checkpointId[6:0]),
+		.timestamp(clock),
+		.busy(start || startRegistered || syncRegistered || commandEnqueue),
+		.sampleEnqueue(sampleEnqueue),
+		.sampleRecord(sampleRecord)
+	);
+
+	/* Traffic records, a pass-through if disabled */
+	AxiMonitor#(16, AXI_MONITOR) monitor(
+		.clk(clk),
+		.rst_n(rst_n),
+
+		.start(start),
+		.inEnqueue(recordEnqueue),
+		.inRecord(recordIn),
+		.outEnqueue(monitorEnqueue),
+		.outRecord(monitorOut),
+		.idle(monitorIdle),
+		.dropped(monitorDropped),
+
+		.monARVALID(monARVALID),
+		.monARREADY(monARREADY),
+		.monARLEN(monARLEN),
+		.monARSIZE(monARSIZE),
+		.monRVALID(monRVALID),
+		.monRREADY(monRREADY),
+		.monRLAST(monRLAST),
+		.monAWVALID(monAWVALID),
+		.monAWREADY(monAWREADY),
+		.monAWLEN(monAWLEN),
+		.monAWSIZE(monAWSIZE),
+		.monWVALID(monWVALID),
+		.monWREADY(monWREADY),
+		.monBVALID(monBVALID),
+		.monBREADY(monBREADY)
+	);
+
+	/* Run compression, a pass-through if disabled */
+	RunCompressor#(COUNTER_WIDTH, RUN_TOLERANCE, RUN_COMPRESSION) compressor(
+		.clk(clk),
+		.rst_n(rst_n),
+
+		.start(start),
+		.inEnqueue(monitorEnqueue),
+		.inRecord(monitorOut),
+		.outEnqueue(fifoEnqueue),
+		.outRecord(fifoIn),
+		.idle(compressorIdle)
+	);
 
 	/* Request FIFO */
-	FIFO#(256, 64) fifo(
+	FIFO#(FIFO_DEPTH, 64) fifo(
 		.clk(clk),
 		.rst_n(rst_n),
 
@@ -162,9 +558,10 @@ module SequentialWriter(
 		.dequeue(fifoDequeue),
 		.back(fifoIn),
 		.front(fifoOut),
-		/* If FIFO is full, stamp requests are dropped (sorry for that...) */
-		.full(),
-		.empty(fifoIsEmpty)
+		/* If FIFO is full, stamp requests are dropped (sorry for that...), but at least they are counted */
+		.full(fifoIsFull),
+		.empty(fifoIsEmpty),
+		.count(fifoCount)
 	);
 
 endmodule
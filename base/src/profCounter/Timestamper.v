@@ -2,7 +2,15 @@
 
 `include "commands.vh"
 
-module Timestamper(
+/**
+ * Timestamper
+ *
+ * Cycle counter of COUNTER_WIDTH bits. The counter is incremented once every 2^prescaler clock cycles, trading resolution for
+ * range when a narrow counter is used on long executions.
+ */
+module Timestamper#(
+	parameter COUNTER_WIDTH = 56
+) (
 	/* Standard pins */
 	clk,
 	rst_n,
@@ -13,6 +21,8 @@ module Timestamper(
 	done,
 	/* commandUnit command */
 	command,
+	/* Log2 of the number of cycles per count */
+	prescaler,
 
 	/* Current timestamp */
 	timestamp
@@ -24,19 +34,24 @@ module Timestamper(
 	input start;
 	output done;
 	input [3:0] command;
+	input [4:0] prescaler;
 
 	output [63:0] timestamp;
 
 	reg [3:0] state;
-	reg [63:0] counter;
+	reg [COUNTER_WIDTH-1:0] counter;
+	reg [31:0] prescaleCounter;
+	wire [31:0] prescaleMask;
 
 	assign done = 'h0 == state;
 	assign timestamp = counter;
+	assign prescaleMask = (32'h1 << prescaler) - 32'h1;
 
 	/* Counter logic */
 	always @(posedge clk) begin
 		if(!rst_n) begin
 			counter <= 'h00;
+			prescaleCounter <= 'h00;
 			state <= 'h0;
 		end
 		else begin
@@ -44,12 +59,17 @@ module Timestamper(
 			if('h0 == state) begin
 				if(start) begin
 					counter <= 'h00;
+					prescaleCounter <= 'h00;
 					state <= 'h1;
 				end
 			end
 			/* State 0x1: perform cycle count */
 			else if('h1 == state) begin
-				counter <= counter + 'h01;
+				prescaleCounter <= prescaleCounter + 'h01;
+
+				/* Count once every 2^prescaler cycles */
+				if(prescaleMask == (prescaleCounter & prescaleMask))
+					counter <= counter + 'h01;
 
 				/* COMM_FINISH command: stop counting */
 				if(`COMM_FINISH == command)
@@ -6,4 +6,17 @@
 `define COMM_HOLD 'hE
 `define COMM_FINISH 'hF
 
+/**
+ * COMM_CHECKPOINT commands (0x1 - 0xC) carry the checkpoint bank on bits [10:4] of the pipe word. The checkpoint ID is
+ * bank * COMM_CHECKPOINTS_PER_BANK + (command - 1), from 0 to 127. Words with bank 0 are the original 12 checkpoint commands.
+ */
+`define COMM_CHECKPOINTS_PER_BANK 12
+
+/**
+ * With NDRANGE (config.vh), bits [31:11] of every pipe word identify the issuing work-item: linear work-group ID (modulo 8192) on
+ * bits [23:11] and a hash of the linear local ID on bits [31:24]. Both travel with the command, so commands issued by different
+ * work-items never mix, whatever their interleaving in the pipe. Without NDRANGE, these bits are ignored.
+ */
+`define COMM_SOURCE_WIDTH 21
+
 `endif
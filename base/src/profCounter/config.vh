@@ -0,0 +1,48 @@
+`ifndef CONFIG_VH
+`define CONFIG_VH
+
+/**
+ * Synthesis-time configuration of ProfCounter
+ *
+ * The packaging script removes all user parameters from the top-level module, therefore the configurable aspects of this
+ * kernel are set here and propagated to the submodules by profCounter.v.
+ */
+
+/* Width of the m_axi_gmem data bus. Supported values are 64, 128, 256 and 512. This value must match the "dataWidth" attribute */
+/* of port m_axi_gmem in profCounter.xml */
+`define GMEM_DATA_WIDTH 512
+
+/* Width of the cycle counter (up to 56 bits). Narrower counters wrap around sooner, which is handled by the host decoder as long */
+/* as consecutive records are less than 2^COUNTER_WIDTH counts apart */
+`define COUNTER_WIDTH 56
+
+/* Depth of the writer FIFO, in records (up to 1024). Records arriving while it is full are dropped, which is reported by the */
+/* telemetry trailer along with its high-water mark (see records.vh) */
+`define FIFO_DEPTH 256
+
+/* Clock frequencies in MHz, recorded in the log header (0 if unknown). KERNEL_CLOCK_MHZ is the clock of ProfCounter (ap_clk, */
+/* selected by CLKID), DUT_CLOCK_MHZ is only used when DUT_CLOCK_DOMAIN is defined */
+`define KERNEL_CLOCK_MHZ 0
+`define DUT_CLOCK_MHZ 0
+
+/* Define DUT_CLOCK_DOMAIN when the DUT kernel runs on a different clock than ProfCounter. Pipe p0 is then sampled on ap_clk_2, */
+/* which must be connected to the DUT clock, and commands are timestamped in DUT cycles before crossing to ap_clk */
+/* `define DUT_CLOCK_DOMAIN */
+
+/* Define RUN_COMPRESSION to collapse runs of records with the same tag and the same distance to their predecessor (e.g. a checkpoint */
+/* in a steady-state loop) into repeat records, which the host decoder expands again. Expanded timestamps are up to RUN_TOLERANCE */
+/* counts earlier than the measured ones */
+/* `define RUN_COMPRESSION */
+`define RUN_TOLERANCE 0
+
+/* Define AXI_MONITOR to add the mon interface, a passive tap on an AXI4 master of the DUT (connected after linking, see README). Every */
+/* checkpoint is then followed by the bytes, beats and busy cycles of that port since the previous checkpoint. The monitored port must */
+/* be on the ProfCounter clock (i.e. DUT_CLOCK_DOMAIN undefined), and run compression is disabled */
+/* `define AXI_MONITOR */
+
+/* Define NDRANGE for DUTs with several work-items (compiled with PROFCOUNTER_NDRANGE, see profcounter.h). Bits [31:11] of every pipe */
+/* word then carry the issuing work-group and local ID, which are kept on bits [55:35] of the record. The counter is limited to 35 */
+/* bits and run compression is disabled */
+/* `define NDRANGE */
+
+`endif
@@ -18,6 +18,16 @@ puts "Injecting ProfCounter calls"
 disassemble $db_path__/a.o.3 $db_path__/temp
 exec bash $::env(PROFCOUNTERSRCROOT)/transform.sh $db_path__/temp.ll
 
+# Automatic loop instrumentation is only performed if PROFCOUNTERAUTO is set (see instrument.sh)
+if {[info exists ::env(PROFCOUNTERAUTO)] && "" != $::env(PROFCOUNTERAUTO)} {
+	set autobase__ 12
+	if {[info exists ::env(PROFCOUNTERAUTOBASE)] && "" != $::env(PROFCOUNTERAUTOBASE)} {
+		set autobase__ $::env(PROFCOUNTERAUTOBASE)
+	}
+	puts "Injecting automatic loop checkpoints"
+	puts [exec bash $::env(PROFCOUNTERSRCROOT)/instrument.sh $db_path__/temp.ll $::env(PROFCOUNTERAUTOSYMTAB) $::env(PROFCOUNTERAUTO) $autobase__ 2>@1]
+}
+
 puts "Performing final transform"
 transform -loop-bound -cdfg-build $db_path__/temp.ll -o $db_path__/a.o.3.bc -f -phase build-ssdm
 
@@ -67,7 +67,25 @@ set_property sdx_kernel_type rtl [ipx::current_core]
 ipx::create_xgui_files [ipx::current_core]
 ipx::associate_bus_interfaces -busif m_axi_gmem -clock ap_clk [ipx::current_core]
 ipx::associate_bus_interfaces -busif s_axi_control -clock ap_clk [ipx::current_core]
-ipx::associate_bus_interfaces -busif p0 -clock ap_clk [ipx::current_core]
+# Pipe p0 belongs to the DUT clock (ap_clk_2) if clock-domain crossing is enabled (DUT_CLOCK_DOMAIN in config.vh)
+set config_file [open "${path_to_hdl}/config.vh" r]
+set config [read $config_file]
+close $config_file
+if {[regexp -line {^\s*`define\s+DUT_CLOCK_DOMAIN\M} $config]} {
+    ipx::associate_bus_interfaces -busif p0 -clock ap_clk_2 [ipx::current_core]
+    ipx::associate_bus_interfaces -clock ap_clk_2 -reset ap_rst_n_2 [ipx::current_core]
+} else {
+    ipx::associate_bus_interfaces -busif p0 -clock ap_clk [ipx::current_core]
+}
+# Passive tap on an AXI4 master of the DUT, if enabled (AXI_MONITOR in config.vh). It is not an OpenCL argument, thus it is not listed
+# in profCounter.xml and must be connected after linking (see README)
+if {[regexp -line {^\s*`define\s+AXI_MONITOR\M} $config]} {
+    ipx::infer_bus_interface {mon_ARVALID mon_ARREADY mon_ARADDR mon_ARLEN mon_ARSIZE mon_RVALID mon_RREADY mon_RLAST mon_AWVALID mon_AWREADY mon_AWADDR mon_AWLEN mon_AWSIZE mon_WVALID mon_WREADY mon_WLAST mon_BVALID mon_BREADY} xilinx.com:interface:aximm_rtl:1.0 [ipx::current_core]
+    set_property interface_mode monitor [ipx::get_bus_interfaces mon -of_objects [ipx::current_core]]
+    ipx::associate_bus_interfaces -busif mon -clock ap_clk [ipx::current_core]
+}
+# Interrupt line (done and log watermark interrupts, see BasicController.v)
+ipx::infer_bus_interface interrupt xilinx.com:signal:interrupt_rtl:1.0 [ipx::current_core]
 set_property supported_families { } [ipx::current_core]
 set_property auto_family_support_level level_2 [ipx::current_core]
 ipx::update_checksums [ipx::current_core]
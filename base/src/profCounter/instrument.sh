@@ -0,0 +1,333 @@
+#!/bin/bash
+
+if [ $# -lt 3 ]; then
+	echo "Usage: instrument.sh LLFILE SYMFILE FUNCTIONS [BASEID]" 1>&2
+	echo -e "\tLLFILE\tLLVM assembly file to be instrumented (after transform.sh)" 1>&2
+	echo -e "\tSYMFILE\tfile where the ID to loop mapping is written (symbol table format, see symtab.sh)" 1>&2
+	echo -e "\tFUNCTIONS\tcomma-separated list of functions to be instrumented, or \"all\"" 1>&2
+	echo -e "\tBASEID\tfirst checkpoint ID to be used (default is 12, i.e. right after the IDs of PROFCOUNTER_CHECKPOINT_0() to _11())" 1>&2
+	exit 1
+fi
+
+# Automatic loop-level instrumentation. For every loop of the selected functions, three checkpoints are inserted:
+# - header: at the beginning of the loop header (after the phi nodes), issued at every iteration;
+# - latch: right before the branch of the block(s) that jump back to the header, issued at the end of every iteration;
+# - exit: at the beginning of the block(s) where execution continues after the loop, issued once per loop execution. A block that
+#   is also reached from outside the loop (e.g. the header of the next loop) is not instrumented itself: each edge leaving the loop
+#   towards it is split by a new block holding the checkpoint.
+# Loops are found from the backward branches in the LLVM assembly, i.e. a branch to a block that appears before the branching
+# block is a back-edge, and every block in between belongs to the loop. This holds for the block order produced by clang.
+# Only functions that access the pipe p0 can be instrumented, since the checkpoints are pipe writes just like the ones inserted by
+# transform.sh. The pipe is only kept if the kernel calls PROFCOUNTER_FINISH().
+# With PROFCOUNTER_NDRANGE, transform.sh stores run-time words (command ORed with the issuer) to the pipe. The issuer register is
+# taken from one of these ORs and ORed into every inserted checkpoint as well. It must be computed in the entry block, so that it is
+# available at every loop, otherwise the function is not instrumented.
+
+BASEID=${4:-12}
+TMPFILE=$1.instrument
+
+# The ll file is read twice: the first pass only collects the source lines of the debug locations
+awk -v symFile="$2" -v functions="$3" -v baseId="$BASEID" '
+	function checkpoint(id, word) {
+		word = int(id / 12) * 16 + (id % 12) + 1;
+		if("" == issuer)
+			return "  store i32 " word ", i32 addrspace(4)* %p0";
+
+		issued++;
+		return "  %pc.instrument." issued " = or i32 " issuer ", " word "\n  store i32 %pc.instrument." issued ", i32 addrspace(4)* %p0";
+	}
+
+	# Issuer register of NDRange functions (empty if the pipe words are constant), or "?" if none is available at every loop
+	function findIssuer(i, j, word, reg, found) {
+		found = "";
+		for(i = 1; i <= n; i++) {
+			if(!match(L[i], /^  store i32 %[-A-Za-z$._0-9]+, i32 addrspace\(4\)\* %p0/))
+				continue;
+			word = L[i];
+			sub(/^  store i32 /, "", word);
+			sub(/,.*/, "", word);
+			found = "?";
+
+			# The word is the issuer ORed with a constant command
+			reg = "";
+			for(j = 1; j <= n; j++) {
+				if(index(L[j], "  " word " = or i32 ") == 1) {
+					reg = substr(L[j], length(word) + 13);
+					sub(/, !dbg.*/, "", reg);
+					if(match(reg, /^%[-A-Za-z$._0-9]+, [0-9]+$/))
+						reg = substr(reg, 1, index(reg, ",") - 1);
+					else if(match(reg, /^[0-9]+, %[-A-Za-z$._0-9]+$/))
+						reg = substr(reg, index(reg, "%"));
+					else
+						reg = "";
+					break;
+				}
+			}
+			if("" == reg)
+				continue;
+
+			# The issuer dominates every loop if it is a function argument or is computed in the entry block
+			for(j = bEnd[1] + 1; j <= n && index(L[j], "  " reg " = ") != 1; j++);
+			if(j > n)
+				return reg;
+		}
+		return found;
+	}
+
+	function blockLine(b, i) {
+		for(i = bStart[b]; i <= bEnd[b]; i++) {
+			if(match(L[i], /!dbg ![0-9]+/) && (substr(L[i], RSTART + 6, RLENGTH - 6) in dbgLine))
+				return dbgLine[substr(L[i], RSTART + 6, RLENGTH - 6)];
+		}
+		return 0;
+	}
+
+	function afterPhis(b, i) {
+		for(i = bStart[b] + 1; i < bEnd[b] && L[i] ~ /^  %[^ ]+ = phi /; i++);
+		return i;
+	}
+
+	function insert(i, text) {
+		before[i] = before[i] text "\n";
+	}
+
+	# Replace every occurrence of "from" that is not followed by more characters of a name
+	function relabel(line, from, to, out, p, c) {
+		out = "";
+		while(p = index(line, from)) {
+			c = substr(line, p + length(from), 1);
+			out = out substr(line, 1, p - 1) ((c ~ /[-A-Za-z$._0-9]/)? from : to);
+			line = substr(line, p + length(from));
+		}
+		return out line;
+	}
+
+	# True if block t is only reached from blocks first to last
+	function reachedFrom(t, first, last, i, k, p) {
+		k = split(preds[t], p, " ");
+		for(i = 1; i <= k; i++) {
+			if(p[i] < first || p[i] > last)
+				return 0;
+		}
+		return 1;
+	}
+
+	# Split the edge from block b to block t with a new block holding "text", appended to the function. Edges split before (by an
+	# outer loop) lead to their new block, which is then chained
+	function splitEdge(b, t, text, i, name, succName) {
+		name = "pc.exit." (++splits);
+		succName = ((b, t) in edge)? edge[b, t] : bName[t];
+		for(i = bStart[b]; i <= bEnd[b]; i++)
+			L[i] = relabel(L[i], "label %" succName, "label %" name);
+		if(!((b, t) in edge)) {
+			for(i = bStart[t] + 1; i < bEnd[t] && L[i] ~ /^  %[^ ]+ = phi /; i++)
+				L[i] = relabel(L[i], ", %" bName[b] " ]", ", %" name " ]");
+		}
+		edge[b, t] = name;
+		insert(n, "\n" name ":\n" text "\n  br label %" succName);
+	}
+
+	function process(i, j, b, s, h, k, nb, nl, id, line, rest, target, latchLine, exitLine) {
+		split("", before);
+		split("", bOrder);
+		split("", succ);
+		split("", loopEnd);
+		split("", preds);
+		split("", edge);
+
+		# Split function into basic blocks. The entry block may have no label
+		nb = 1;
+		bName[1] = "entry";
+		bStart[1] = 1;
+		bTerm[1] = 0;
+		for(i = 2; i < n; i++) {
+			if(L[i] ~ /^[-A-Za-z$._0-9]+:/ || L[i] ~ /^; <label>:[0-9]+/) {
+				bEnd[nb] = i - 1;
+				nb++;
+				line = L[i];
+				sub(/^; <label>:/, "", line);
+				sub(/[: ].*/, "", line);
+				bName[nb] = line;
+				bStart[nb] = i;
+				bOrder[line] = nb;
+				bTerm[nb] = 0;
+			}
+			else if(L[i] ~ /^  (br|switch|indirectbr|invoke) /) {
+				bTerm[nb] = i;
+			}
+
+			# Successors are all labels referenced by the block terminator (including multi-line switches)
+			rest = L[i];
+			while(match(rest, /label %[-A-Za-z$._0-9]+/)) {
+				succ[nb] = succ[nb] " " substr(rest, RSTART + 7, RLENGTH - 7);
+				rest = substr(rest, RSTART + RLENGTH);
+			}
+		}
+		bEnd[nb] = n - 1;
+		for(b = 1; b <= nb; b++) {
+			k = split(succ[b], s, " ");
+			for(j = 1; j <= k; j++) {
+				if(bOrder[s[j]])
+					preds[bOrder[s[j]]] = preds[bOrder[s[j]]] " " b;
+			}
+		}
+
+		issuer = findIssuer();
+		if("?" == issuer) {
+			print "instrument.sh: issuer of function " fName " not found in its entry block, function is not instrumented" > "/dev/stderr";
+			for(i = 1; i <= n; i++)
+				print L[i];
+			return;
+		}
+
+		# Find back-edges. The loop spans from its header to its last latch
+		for(b = 1; b <= nb; b++) {
+			k = split(succ[b], s, " ");
+			for(j = 1; j <= k; j++) {
+				h = bOrder[s[j]];
+				if(h && h <= b) {
+					latches[h] = latches[h] " " b;
+					if(loopEnd[h] < b)
+						loopEnd[h] = b;
+				}
+			}
+		}
+
+		# Instrument loops in header order
+		nl = 0;
+		for(h = 1; h <= nb; h++) {
+			if(!loopEnd[h])
+				continue;
+
+			if(nextId + 2 > 127) {
+				if(!exhausted)
+					print "instrument.sh: checkpoint IDs exhausted, remaining loops are not instrumented" > "/dev/stderr";
+				exhausted = 1;
+				break;
+			}
+
+			id = nextId;
+			nextId += 3;
+			nl++;
+
+			insert(afterPhis(h), checkpoint(id));
+
+			k = split(latches[h], s, " ");
+			latchLine = blockLine(s[1]);
+			for(j = 1; j <= k; j++) {
+				if(!(s[j] in done)) {
+					insert(bTerm[s[j]], checkpoint(id + 1));
+					done[s[j]] = 1;
+				}
+			}
+			for(j in done)
+				delete done[j];
+
+			exitLine = 0;
+			for(b = h; b <= loopEnd[h]; b++) {
+				k = split(succ[b], s, " ");
+				for(j = 1; j <= k; j++) {
+					target = bOrder[s[j]];
+					if(target <= loopEnd[h] || (target in done) || ((b, target) in done))
+						continue;
+
+					if(reachedFrom(target, h, loopEnd[h])) {
+						insert(afterPhis(target), checkpoint(id + 2));
+						done[target] = 1;
+					}
+					else {
+						splitEdge(b, target, checkpoint(id + 2));
+						done[b, target] = 1;
+					}
+					if(!exitLine)
+						exitLine = blockLine(target);
+				}
+			}
+			for(j in done)
+				delete done[j];
+
+			printf("%d\t%s\t%d\t%s loop %s header\n", id, fFile, blockLine(h), fName, bName[h]) > symFile;
+			printf("%d\t%s\t%d\t%s loop %s latch\n", id + 1, fFile, latchLine, fName, bName[h]) > symFile;
+			printf("%d\t%s\t%d\t%s loop %s exit\n", id + 2, fFile, exitLine, fName, bName[h]) > symFile;
+		}
+		for(h = 1; h <= nb; h++)
+			delete latches[h];
+
+		if(nl)
+			print "instrument.sh: " nl " loop(s) instrumented in function " fName > "/dev/stderr";
+
+		for(i = 1; i <= n; i++)
+			printf("%s%s\n", before[i], L[i]);
+	}
+
+	BEGIN {
+		nextId = baseId;
+		all = ("all" == functions);
+		k = split(functions, list, ",");
+		for(i = 1; i <= k; i++)
+			selected[list[i]] = 1;
+		printf("") > symFile;
+	}
+
+	# First pass: source line of each debug location, and source file of each function
+	FNR == NR {
+		if(match($0, /^![0-9]+ = (distinct )?!DIFile\(filename: "[^"]*"/)) {
+			line = substr($0, RSTART, RLENGTH - 1);
+			sub(/^.*filename: "/, "", line);
+			dbgFile[substr($1, 2)] = line;
+		}
+		else if(match($0, /^![0-9]+ = (distinct )?!DISubprogram\(.*[ (]file: ![0-9]+/)) {
+			line = substr($0, RSTART, RLENGTH);
+			sub(/^.*file: !/, "", line);
+			dbgSubprogramFile[substr($1, 2)] = line;
+		}
+		if(match($0, /^![0-9]+ = metadata !\{i32 [0-9]+, i32 [0-9]+, /)) {
+			line = $0;
+			sub(/^[^{]*\{i32 /, "", line);
+			sub(/,.*/, "", line);
+			dbgLine[substr($1, 2)] = line;
+		}
+		else if(match($0, /^![0-9]+ = (distinct )?!DILocation\(line: [0-9]+/)) {
+			line = $0;
+			sub(/^.*line: /, "", line);
+			sub(/[^0-9].*/, "", line);
+			dbgLine[substr($1, 2)] = line;
+		}
+		next;
+	}
+
+	# Second pass: functions are buffered and instrumented as a whole
+	/^define / {
+		inFunc = 1;
+		n = 0;
+		match($0, /@[-A-Za-z$._0-9]+\(/);
+		fName = substr($0, RSTART + 1, RLENGTH - 2);
+		# Without debug information, the function name stands for the file
+		fFile = fName;
+		if(match($0, /!dbg ![0-9]+/) && (dbgSubprogramFile[substr($0, RSTART + 6, RLENGTH - 6)] in dbgFile))
+			fFile = dbgFile[dbgSubprogramFile[substr($0, RSTART + 6, RLENGTH - 6)]];
+		usesPipe = 0;
+	}
+
+	inFunc {
+		L[++n] = $0;
+		if($0 ~ /%p0[^-A-Za-z$._0-9]/ || $0 ~ /%p0$/)
+			usesPipe = 1;
+
+		if($0 ~ /^}/) {
+			inFunc = 0;
+			if(usesPipe && (all || (fName in selected)))
+				process();
+			else
+				for(i = 1; i <= n; i++)
+					print L[i];
+		}
+		next;
+	}
+
+	{
+		print;
+	}
+' "$1" "$1" > "$TMPFILE" && mv "$TMPFILE" "$1"
+
+exit
@@ -0,0 +1,23 @@
+# Connects the mon interface of profCounter (AXI_MONITOR in config.vh) to an AXI4 master of the DUT, after the system is linked.
+# Called by xocc with --xp param:compiler.userPostSysLinkTcl=<path to this script>. Environment variables:
+# PROFCOUNTERMONITOR: DUT port to be monitored, as <compute unit>/<port> (e.g. bfs_1/m_axi_gmem)
+# PROFCOUNTERINSTANCE: profCounter compute unit (profCounter_1 if unset)
+
+set monitored__ [get_bd_intf_pins $::env(PROFCOUNTERMONITOR)]
+if {"" == $monitored__} {
+	error "ProfCounter: DUT port $::env(PROFCOUNTERMONITOR) not found"
+}
+
+set instance__ profCounter_1
+if {[info exists ::env(PROFCOUNTERINSTANCE)] && "" != $::env(PROFCOUNTERINSTANCE)} {
+	set instance__ $::env(PROFCOUNTERINSTANCE)
+}
+set monitor__ [get_bd_intf_pins $instance__/mon]
+if {"" == $monitor__} {
+	error "ProfCounter: $instance__/mon not found, was profCounter packaged with AXI_MONITOR defined?"
+}
+
+# The monitor joins the existing net between the DUT port and the memory interconnect, nothing is driven by it
+set net__ [get_bd_intf_nets -of_objects $monitored__]
+connect_bd_intf_net -intf_net $net__ $monitor__
+puts "ProfCounter: $instance__/mon monitors $::env(PROFCOUNTERMONITOR)"
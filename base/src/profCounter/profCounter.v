@@ -1,5 +1,7 @@
 `timescale 1ns / 1ps
 
+`include "config.vh"
+
 /**
  * ProfCounter RTL kernel
  *
@@ -11,16 +13,44 @@
  * Send COMM_CHECKPOINT via pipe "p0"   | Saves current clock cycle (timestamp) to global memory along with the checkpoint ID.
  *                                      | COMM_CHECKPOINT is a multi-valued command, ranging from 0x1 to 0xC in current implementation.
  *                                      | Each value corresponds to a checkpoint ID (command 0x1 is ID 0, command 0x2 is ID 1 and so on).
+ *                                      | Bits [10:4] of the pipe word select a bank of 12 further IDs, up to ID 127 (see commands.vh).
  *                                      | This is useful to keep track in the code of where the timestamp was requested.
  * Send COMM_HOLD via pipe "p0"         | Timestamps are enqueued and only written to global memory after 0x3 is issued,
  *                                      | preventing competition on global memory that could affect the kernel under test.
  *                                      | This command stays valid until a COMM_FINISH is issued.
  * Send COMM_FINISH via pipe "p0"       | Stops ProfCounter execution
+ *
+ * The width of the AXI4 Master to global memory is set by GMEM_DATA_WIDTH in config.vh. Records are packed into full-width beats.
+ * The cycle counter has COUNTER_WIDTH bits (config.vh) and counts once every 2^prescaler cycles, where prescaler is a kernel argument.
+ * On COMM_FINISH, a trailer with the writer telemetry (FIFO usage, AXI4 stalls, write latencies) is appended to the log.
+ *
+ * If DUT_CLOCK_DOMAIN is defined (config.vh), pipe p0 belongs to a second clock domain (ap_clk_2, the DUT clock). Commands are then
+ * timestamped in DUT cycles and cross to ap_clk through PipeCrossing.
+ *
+ * If RUN_COMPRESSION is defined (config.vh), runs of identical records (same tag and delta) are written as repeat records.
+ *
+ * If AXI_MONITOR is defined (config.vh), the mon interface passively taps an AXI4 master of the DUT, and every checkpoint is followed
+ * by records with the bytes, beats and busy cycles of that port since the previous checkpoint. Run compression is then disabled.
+ *
+ * If NDRANGE is defined (config.vh), bits [31:11] of the pipe word identify the issuing work-item (see commands.vh) and are kept in
+ * the stamp and checkpoint records, above a timestamp of at most 35 bits. Run compression is then disabled. As every work-item issues
+ * its own COMM_FINISH, the "finishes" argument sets how many of them end the execution (see CommandUnit).
+ *
+ * If the "interval" argument is not zero, checkpoints only update the current region and a sample record is written every "interval"
+ * cycles instead (see Sampler), so that the log grows with the execution time rather than with the checkpoint rate.
+ *
+ * The interrupt line is raised when an execution is done and, if the "watermark" argument is not zero, every time another "watermark"
+ * records are written to global memory (see BasicController).
  */
 module profCounter(
 	/* Standard pins */
 	ap_clk,
 	ap_rst_n,
+`ifdef DUT_CLOCK_DOMAIN
+	/* DUT clock, pipe p0 belongs to this domain */
+	ap_clk_2,
+	ap_rst_n_2,
+`endif
 
 	/* AXI4 Master to global memory */
 	m_axi_gmem_AWVALID,
@@ -86,12 +116,41 @@ module profCounter(
 	/* AXI4-Stream pipe sink */
 	p0_TDATA,
 	p0_TVALID,
-	p0_TREADY
+	p0_TREADY,
+
+`ifdef AXI_MONITOR
+	/* Monitored AXI4 master of the DUT (inputs only) */
+	mon_ARVALID,
+	mon_ARREADY,
+	mon_ARADDR,
+	mon_ARLEN,
+	mon_ARSIZE,
+	mon_RVALID,
+	mon_RREADY,
+	mon_RLAST,
+	mon_AWVALID,
+	mon_AWREADY,
+	mon_AWADDR,
+	mon_AWLEN,
+	mon_AWSIZE,
+	mon_WVALID,
+	mon_WREADY,
+	mon_WLAST,
+	mon_BVALID,
+	mon_BREADY,
+`endif
+
+	/* Interrupt to host */
+	interrupt
 );
 
 	/* Standard pins */
 	input ap_clk;
 	input ap_rst_n;
+`ifdef DUT_CLOCK_DOMAIN
+	input ap_clk_2;
+	input ap_rst_n_2;
+`endif
 
 	/* AXI4 Master to global memory */
 	output m_axi_gmem_AWVALID;
@@ -101,10 +160,8 @@ module profCounter(
 	output [2:0] m_axi_gmem_AWSIZE;
 	output m_axi_gmem_WVALID;
 	input m_axi_gmem_WREADY;
-	// XXX: was 32-bit
-	output [63:0] m_axi_gmem_WDATA;
-	// XXX: was 4-bit
-	output [7:0] m_axi_gmem_WSTRB;
+	output [`GMEM_DATA_WIDTH-1:0] m_axi_gmem_WDATA;
+	output [(`GMEM_DATA_WIDTH/8)-1:0] m_axi_gmem_WSTRB;
 	output m_axi_gmem_WLAST;
 	input m_axi_gmem_BVALID;
 	output m_axi_gmem_BREADY;
@@ -131,8 +188,7 @@ module profCounter(
 	output [3:0] m_axi_gmem_ARREGION;
 	input m_axi_gmem_RVALID;
 	output m_axi_gmem_RREADY;
-	// XXX: was 32-bit
-	input [63:0] m_axi_gmem_RDATA;
+	input [`GMEM_DATA_WIDTH-1:0] m_axi_gmem_RDATA;
 	input m_axi_gmem_RLAST;
 	input m_axi_gmem_RID;
 	input [1:0] m_axi_gmem_RRESP;
@@ -141,14 +197,14 @@ module profCounter(
 	/* AXI4 Slave to OpenCL kernel controller */
 	input s_axi_control_AWVALID;
 	output s_axi_control_AWREADY;
-	input [5:0] s_axi_control_AWADDR;
+	input [6:0] s_axi_control_AWADDR;
 	input s_axi_control_WVALID;
 	output s_axi_control_WREADY;
 	input [31:0] s_axi_control_WDATA;
 	input [3:0] s_axi_control_WSTRB;
 	input s_axi_control_ARVALID;
 	output s_axi_control_ARREADY;
-	input [5:0] s_axi_control_ARADDR;
+	input [6:0] s_axi_control_ARADDR;
 	output s_axi_control_RVALID;
 	input s_axi_control_RREADY;
 	output [31:0] s_axi_control_RDATA;
@@ -162,6 +218,50 @@ module profCounter(
 	input p0_TVALID;
 	output p0_TREADY;
 
+	/* Interrupt to host */
+	output interrupt;
+
+`ifdef AXI_MONITOR
+	/* Monitored AXI4 master of the DUT. Addresses and WLAST are only there for the interface to be inferred */
+	input mon_ARVALID;
+	input mon_ARREADY;
+	input [63:0] mon_ARADDR;
+	input [7:0] mon_ARLEN;
+	input [2:0] mon_ARSIZE;
+	input mon_RVALID;
+	input mon_RREADY;
+	input mon_RLAST;
+	input mon_AWVALID;
+	input mon_AWREADY;
+	input [63:0] mon_AWADDR;
+	input [7:0] mon_AWLEN;
+	input [2:0] mon_AWSIZE;
+	input mon_WVALID;
+	input mon_WREADY;
+	input mon_WLAST;
+	input mon_BVALID;
+	input mon_BREADY;
+`endif
+
+	/* Every checkpoint carries its own traffic records with AXI_MONITOR, and its own issuer with NDRANGE: no runs to be compressed */
+`ifdef AXI_MONITOR
+	localparam MONITOR = 1;
+`else
+	localparam MONITOR = 0;
+`endif
+`ifdef NDRANGE
+	localparam SOURCES = 1;
+	localparam TIMESTAMP_WIDTH = (`COUNTER_WIDTH > 35)? 35 : `COUNTER_WIDTH;
+`else
+	localparam SOURCES = 0;
+	localparam TIMESTAMP_WIDTH = `COUNTER_WIDTH;
+`endif
+`ifdef RUN_COMPRESSION
+	localparam COMPRESSION = !MONITOR && !SOURCES;
+`else
+	localparam COMPRESSION = 0;
+`endif
+
 	/* Registered reset */
 	reg ap_rst_n_registered;
 
@@ -173,14 +273,26 @@ module profCounter(
 	wire controlStartPulse;
 	reg controlIdle;
 	wire [63:0] controlOffset;
+	wire [4:0] controlPrescaler;
+	wire [31:0] controlInterval;
+	wire [31:0] controlFinishes;
 	/* commandUnit I/Os */
 	wire commanderDone;
 	wire [3:0] commanderOut;
+	wire [6:0] commanderBank;
+	wire [20:0] commanderSource;
+	wire [47:0] commanderReceived;
 	/* timestamper I/Os */
 	wire stamperDone;
 	wire [63:0] stamperOut;
 	/* sequentialWriter I/Os */
 	wire writerIdle;
+	wire [31:0] writerWritten;
+	wire [63:0] writerValue;
+	/* Pipe towards commandUnit (p0 itself, or its crossing to ap_clk) */
+	wire [31:0] commanderTDATA;
+	wire commanderTVALID;
+	wire commanderTREADY;
 
 	/* Unused AXI4 pins, set to neutral values */
 	assign m_axi_gmem_AWID = 1'b0;
@@ -256,7 +368,12 @@ module profCounter(
 		.done(profCounterDoneReady),
 		.ready(profCounterDoneReady),
 		.idle(controlIdle),
-		.offset(controlOffset)
+		.offset(controlOffset),
+		.prescaler(controlPrescaler),
+		.interval(controlInterval),
+		.finishes(controlFinishes),
+		.written(writerWritten),
+		.interrupt(interrupt)
 	);
 
 	CommandUnit commander(
@@ -265,32 +382,85 @@ module profCounter(
 
 		.start(controlStartPulse),
 		.done(commanderDone),
+		.finishes(controlFinishes),
 
-		.pipeTDATA(p0_TDATA),
-		.pipeTVALID(p0_TVALID),
-		.pipeTREADY(p0_TREADY),
+		.pipeTDATA(commanderTDATA),
+		.pipeTVALID(commanderTVALID),
+		.pipeTREADY(commanderTREADY),
 
-		.command(commanderOut)
+		.command(commanderOut),
+		.bank(commanderBank),
+		.source(commanderSource),
+		.received(commanderReceived)
 	);
 
-	Timestamper stamper(
+	Timestamper#(TIMESTAMP_WIDTH) stamper(
 		.clk(ap_clk),
 		.rst_n(ap_rst_n_registered),
 
 		.start(controlStartPulse),
 		.done(stamperDone),
 		.command(commanderOut),
+		.prescaler(controlPrescaler),
 		.timestamp(stamperOut)
 	);
 
-	SequentialWriter writer(
+`ifdef DUT_CLOCK_DOMAIN
+	/* Registered reset of the DUT domain */
+	reg ap_rst_n_2_registered;
+	/* Timestamp (DUT cycles) of the command at commanderTDATA */
+	wire [63:0] crossingTimestamp;
+
+	always @(posedge ap_clk_2) begin
+		ap_rst_n_2_registered <= ap_rst_n_2;
+	end
+
+	PipeCrossing#(TIMESTAMP_WIDTH) crossing(
 		.clk(ap_clk),
 		.rst_n(ap_rst_n_registered),
+		.start(controlStartPulse),
+		.prescaler(controlPrescaler),
+		.finishes(controlFinishes),
+		.outTDATA(commanderTDATA),
+		.outTVALID(commanderTVALID),
+		.outTREADY(commanderTREADY),
+		.timestamp(crossingTimestamp),
 
+		.dutClk(ap_clk_2),
+		.dutRst_n(ap_rst_n_2_registered),
+		.pipeTDATA(p0_TDATA),
+		.pipeTVALID(p0_TVALID),
+		.pipeTREADY(p0_TREADY)
+	);
+
+	assign writerValue = crossingTimestamp;
+`else
+	assign commanderTDATA = p0_TDATA;
+	assign commanderTVALID = p0_TVALID;
+	assign p0_TREADY = commanderTREADY;
+	assign writerValue = stamperOut;
+`endif
+
+`ifdef DUT_CLOCK_DOMAIN
+	SequentialWriter#(`GMEM_DATA_WIDTH, TIMESTAMP_WIDTH, `FIFO_DEPTH, `KERNEL_CLOCK_MHZ, `DUT_CLOCK_MHZ, 1, COMPRESSION, `RUN_TOLERANCE, MONITOR, SOURCES) writer(
+`else
+	SequentialWriter#(`GMEM_DATA_WIDTH, TIMESTAMP_WIDTH, `FIFO_DEPTH, `KERNEL_CLOCK_MHZ, `KERNEL_CLOCK_MHZ, 0, COMPRESSION, `RUN_TOLERANCE, MONITOR, SOURCES) writer(
+`endif
+		.clk(ap_clk),
+		.rst_n(ap_rst_n_registered),
+
+		.start(controlStartPulse),
+		.prescaler(controlPrescaler),
 		.offset(controlOffset),
 		.command(commanderOut),
-		.value(stamperOut),
+		.bank(commanderBank),
+		.source(commanderSource),
+		.value(writerValue),
+		.clock(stamperOut),
+		.interval(controlInterval),
+		.received(commanderReceived),
 		.idle(writerIdle),
+		.written(writerWritten),
 
 		.axiAWVALID(m_axi_gmem_AWVALID),
 		.axiAWREADY(m_axi_gmem_AWREADY),
@@ -306,7 +476,42 @@ module profCounter(
 
 		.axiBRESP(m_axi_gmem_BRESP),
 		.axiBVALID(m_axi_gmem_BVALID),
-		.axiBREADY(m_axi_gmem_BREADY)
+		.axiBREADY(m_axi_gmem_BREADY),
+
+`ifdef AXI_MONITOR
+		.monARVALID(mon_ARVALID),
+		.monARREADY(mon_ARREADY),
+		.monARLEN(mon_ARLEN),
+		.monARSIZE(mon_ARSIZE),
+		.monRVALID(mon_RVALID),
+		.monRREADY(mon_RREADY),
+		.monRLAST(mon_RLAST),
+		.monAWVALID(mon_AWVALID),
+		.monAWREADY(mon_AWREADY),
+		.monAWLEN(mon_AWLEN),
+		.monAWSIZE(mon_AWSIZE),
+		.monWVALID(mon_WVALID),
+		.monWREADY(mon_WREADY),
+		.monBVALID(mon_BVALID),
+		.monBREADY(mon_BREADY)
+`else
+		/* No monitored port */
+		.monARVALID(1'b0),
+		.monARREADY(1'b0),
+		.monARLEN(8'h00),
+		.monARSIZE(3'b000),
+		.monRVALID(1'b0),
+		.monRREADY(1'b0),
+		.monRLAST(1'b0),
+		.monAWVALID(1'b0),
+		.monAWREADY(1'b0),
+		.monAWLEN(8'h00),
+		.monAWSIZE(3'b000),
+		.monWVALID(1'b0),
+		.monWREADY(1'b0),
+		.monBVALID(1'b0),
+		.monBREADY(1'b0)
+`endif
 	);
 
 endmodule
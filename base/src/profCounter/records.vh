@@ -0,0 +1,90 @@
+`ifndef RECORDS_VH
+`define RECORDS_VH
+
+/**
+ * Log record format
+ *
+ * Every record written to the "log" global memory array is a 64-bit word. The 8 most significant bits hold the record tag, the
+ * remaining 56 bits hold the record payload. The first three records of every execution are the header, the clocks and the sync record.
+ *
+ * Tag         | Record     | Payload
+ * 0x00        | Empty      | Never written, marks the end of the log
+ * 0x01        | Stamp      | Timestamp (see below for NDRANGE)
+ * 0x02        | Repeat     | [55:48] tag of the repeated record, [47:32] count, [31:0] delta. Only written with RUN_COMPRESSION
+ * 0x10        | Header     | [55:48] format version, [47:40] counter width, [37] NDRange log, [36:32] prescaler, [31:0] magic
+ *             |            | number
+ * 0x11        | Telemetry  | [51:48] field (see below), [47:0] value. Written after the last event, when COMM_FINISH is received
+ * 0x12        | Clocks     | [33] recorded by the CPU backend (host only), [32] timestamps count DUT cycles, [31:16] ProfCounter
+ *             |            | clock (MHz), [15:0] DUT clock (MHz)
+ * 0x13        | Traffic    | [55:54] field (see below), [53:27] read value, [26:0] write value. Only written with AXI_MONITOR
+ * 0x14        | Sample     | [55:49] current checkpoint ID, [48] a checkpoint was seen, [47:36] checkpoints since the previous
+ *             |            | sample, [35:0] timestamp. Only written when the "interval" argument is not zero
+ * 0x15        | Sync       | ProfCounter cycles from reset to start (not prescaled)
+ * 0x80 - 0xFF | Checkpoint | Timestamp (see below for NDRANGE). The checkpoint ID is the 7 least significant bits of the tag
+ *
+ * The telemetry trailer describes how the writer coped with the execution, one record per field:
+ *
+ * Field       | Value
+ * 0x0         | FIFO high-water mark (records)
+ * 0x1         | FIFO depth (records)
+ * 0x2         | Records dropped because the FIFO was full
+ * 0x3         | Commands received from the pipe
+ * 0x4         | Beats written to global memory
+ * 0x5         | Cycles with AWVALID asserted and AWREADY deasserted
+ * 0x6         | Cycles with WVALID asserted and WREADY deasserted
+ * 0x7         | Cycles with BREADY asserted and BVALID deasserted
+ * 0x8 - 0xF   | Write latency histogram (cycles from AWVALID to BVALID): <4, 4-7, 8-15, 16-31, 32-63, 64-127, 128-255, >=256
+ *
+ * A repeat record stands for "count" stamp or checkpoint records with the given tag. The first one is "delta" counts after the
+ * previous stamp or checkpoint of the log (0 if there is none), each following one is "delta" counts after its predecessor (see
+ * RunCompressor).
+ *
+ * With AXI_MONITOR, every checkpoint is followed by three traffic records with the traffic of the monitored DUT port since the
+ * previous checkpoint (or since start), one per field (see AxiMonitor):
+ *
+ * Field       | Read and write values
+ * 0x0         | Bytes requested by bursts ((LEN + 1) << SIZE at the address handshake)
+ * 0x1         | Data beats
+ * 0x2         | Cycles with at least one burst outstanding
+ *
+ * A sample records the position of the DUT every "interval" cycles (see Sampler): the last checkpoint passed, i.e. the region being
+ * executed, and how many checkpoints were passed since the previous sample. Its timestamp always counts ProfCounter cycles (with
+ * the prescaler), wraps around at 36 bits and does not carry the issuer. Stamps and checkpoints are not written when sampling.
+ *
+ * The sync record places the start of the execution on the time base of the reset, which is shared by all instances of a design.
+ * Logs of several instances can then be merged into a single timeline (see pcmerge).
+ *
+ * With NDRANGE (flagged by bit 37 of the header), stamps and checkpoints carry their issuer: [55:48] local ID hash, [47:35]
+ * work-group ID, [34:0] timestamp (bits [31:11] of the pipe word, see commands.vh). The counter width is then at most 35.
+ */
+
+`define REC_EMPTY 8'h00
+`define REC_STAMP 8'h01
+`define REC_REPEAT 8'h02
+`define REC_HEADER 8'h10
+`define REC_TELEMETRY 8'h11
+`define REC_CLOCKS 8'h12
+`define REC_TRAFFIC 8'h13
+`define REC_SAMPLE 8'h14
+`define REC_SYNC 8'h15
+`define REC_CHECKPOINT 8'h80
+
+`define LOG_VERSION 8'h01
+`define LOG_MAGIC 32'h50434E54
+
+`define TEL_FIFO_HIGH_WATER 4'h0
+`define TEL_FIFO_DEPTH 4'h1
+`define TEL_DROPPED 4'h2
+`define TEL_RECEIVED 4'h3
+`define TEL_WRITES 4'h4
+`define TEL_AW_BLOCKED 4'h5
+`define TEL_W_BLOCKED 4'h6
+`define TEL_B_BLOCKED 4'h7
+`define TEL_LATENCY_HISTOGRAM 4'h8
+`define TEL_FIELDS 16
+
+`define TRAFFIC_BYTES 2'h0
+`define TRAFFIC_BEATS 2'h1
+`define TRAFFIC_BUSY 2'h2
+
+`endif
@@ -0,0 +1,49 @@
+#!/bin/bash
+
+if [ $# -lt 2 ]; then
+	echo "Usage: symtab.sh CLFILE SYMFILE [CPPFLAGS...]" 1>&2
+	echo -e "\tCLFILE\tOpenCL kernel source instrumented with PROFCOUNTER_* macros" 1>&2
+	echo -e "\tSYMFILE\tSymbol table to be generated (one \"ID<tab>file<tab>line<tab>label\" entry per checkpoint location)" 1>&2
+	echo -e "\tCPPFLAGS\tExtra preprocessor flags (e.g. include paths)" 1>&2
+	exit 1
+fi
+
+CLFILE=$1
+SYMFILE=$2
+shift 2
+
+# With PROFCOUNTER_SYMTAB defined, every checkpoint macro expands to:
+#   __PROFCOUNTER_SYMBOL_BEGIN__ <id> "<file>" <line> "<label>" __PROFCOUNTER_SYMBOL_END__
+# Only the preprocessor is run, the kernel itself is not compiled
+cpp -P -DPROFCOUNTER_SYMTAB "$@" $CLFILE | awk '
+{
+	n = split($0, parts, "__PROFCOUNTER_SYMBOL_END__");
+
+	for(i = 1; i < n; i++) {
+		p = index(parts[i], "__PROFCOUNTER_SYMBOL_BEGIN__");
+		if(!p)
+			continue;
+
+		rec = substr(parts[i], p + length("__PROFCOUNTER_SYMBOL_BEGIN__"));
+		sub(/^[ \t]+/, "", rec);
+
+		id = rec;
+		sub(/[ \t].*/, "", id);
+		sub(/^[0-9]+[ \t]+"/, "", rec);
+
+		file = rec;
+		sub(/".*/, "", file);
+		sub(/^[^"]*"[ \t]+/, "", rec);
+
+		line = rec;
+		sub(/[ \t].*/, "", line);
+		sub(/^[0-9]+[ \t]+"/, "", rec);
+
+		label = rec;
+		sub(/"[ \t]*$/, "", label);
+
+		print id "\t" file "\t" line "\t" label;
+	}
+}' | sort -t$'\t' -k1,1n -k2,2 -k3,3n -u > $SYMFILE
+
+exit ${PIPESTATUS[0]}
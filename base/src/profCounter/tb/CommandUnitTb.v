@@ -0,0 +1,208 @@
+`timescale 1ns / 1ps
+
+`include "commands.vh"
+`include "records.vh"
+
+module CommandUnitTb;
+
+	/* Number of issuers (work-items), each sending one COMM_FINISH */
+	localparam ISSUERS = 3;
+	/* Stamps and checkpoints sent before the last COMM_FINISH, and commands in total (with every COMM_FINISH) */
+	localparam EVENTS = 7;
+	localparam COMMANDS = 10;
+
+	reg clk;
+	reg rst_n;
+	reg start;
+	reg [31:0] finishes;
+	reg [31:0] pipeTDATA;
+	reg pipeTVALID;
+	wire pipeTREADY;
+	wire done;
+	wire [3:0] command;
+	wire [6:0] bank;
+	wire [`COMM_SOURCE_WIDTH-1:0] source;
+	wire [47:0] received;
+	reg [63:0] timestamp;
+	wire idle;
+	wire [31:0] written;
+
+	wire axiAWVALID;
+	wire [63:0] axiAWADDR;
+	wire [7:0] axiAWLEN;
+	wire [2:0] axiAWSIZE;
+	wire axiWVALID;
+	wire [127:0] axiWDATA;
+	wire [15:0] axiWSTRB;
+	wire axiWLAST;
+	wire axiBREADY;
+
+	/* Expected stamps and checkpoints (tag and issuer), in pipe order */
+	reg [7:0] expectedTag [0:EVENTS-1];
+	reg [`COMM_SOURCE_WIDTH-1:0] expectedSource [0:EVENTS-1];
+	reg [63:0] record;
+	integer expectedLen;
+	integer logged;
+	integer errors;
+	integer i;
+
+	CommandUnit commander(
+		.clk(clk),
+		.rst_n(rst_n),
+
+		.start(start),
+		.done(done),
+		.finishes(finishes),
+
+		.pipeTDATA(pipeTDATA),
+		.pipeTVALID(pipeTVALID),
+		.pipeTREADY(pipeTREADY),
+
+		.command(command),
+		.bank(bank),
+		.source(source),
+		.received(received)
+	);
+
+	/* NDRange writer, two records per beat, memory always ready */
+	SequentialWriter#(.DATA_WIDTH(128), .COUNTER_WIDTH(35), .NDRANGE(1)) writer(
+		.clk(clk),
+		.rst_n(rst_n),
+
+		.start(start),
+		.prescaler(5'h0),
+		.offset(64'hDEADCAFE00),
+		.command(command),
+		.bank(bank),
+		.source(source),
+		.value(timestamp),
+		.clock(timestamp),
+		/* Event logging */
+		.interval(32'h0),
+		.received(received),
+		.idle(idle),
+		.written(written),
+
+		.axiAWVALID(axiAWVALID),
+		.axiAWREADY(1'b1),
+		.axiAWADDR(axiAWADDR),
+		.axiAWLEN(axiAWLEN),
+		.axiAWSIZE(axiAWSIZE),
+		.axiWVALID(axiWVALID),
+		.axiWREADY(1'b1),
+		.axiWDATA(axiWDATA),
+		.axiWSTRB(axiWSTRB),
+		.axiWLAST(axiWLAST),
+		.axiBRESP(2'b00),
+		.axiBVALID(1'b1),
+		.axiBREADY(axiBREADY)
+	);
+
+	/* Send a command from work-item (group, local) for one cycle. The pipe must be ready, i.e. profCounter must still be running */
+	task send;
+		input [3:0] comm;
+		input [12:0] groupId;
+		input [7:0] localId;
+		begin
+			pipeTDATA <= {localId, groupId, 7'h0, comm};
+			pipeTVALID <= 'b1;
+			if(`COMM_NOP != comm && comm < `COMM_HOLD) begin
+				expectedTag[expectedLen] = (`COMM_STAMP == comm)? `REC_STAMP : (`REC_CHECKPOINT | (comm - 'h1));
+				expectedSource[expectedLen] = {localId, groupId};
+				expectedLen = expectedLen + 1;
+			end
+			#5 if(!pipeTREADY) begin
+				$display("Command %h from work-item %0d.%0d refused", comm, groupId, localId);
+				errors = errors + 1;
+			end
+			@(posedge clk);
+			pipeTVALID <= 'b0;
+		end
+	endtask
+
+	initial begin
+		$dumpfile("commander.vcd");
+		$dumpvars;
+
+		clk <= 'b1;
+		rst_n <= 'b0;
+		start <= 'b0;
+		finishes <= ISSUERS;
+		pipeTDATA <= 'h0;
+		pipeTVALID <= 'b0;
+		expectedLen = 0;
+		logged = 0;
+		errors = 0;
+		#20 @(posedge clk);
+
+		rst_n <= 'b1;
+		#20 @(posedge clk);
+
+		/* Start, then the clocks and sync records are enqueued */
+		start <= 'b1;
+		#5 @(posedge clk);
+		start <= 'b0;
+		#5 @(posedge clk);
+		#5 @(posedge clk);
+		#5 @(posedge clk);
+
+		/* Three work-items (group 5 local 0, group 5 local 1, group 6 local 0) interleave checkpoints 0 and 1 (commands 0x1 and 0x2) */
+		/* and finish one after the other */
+		send('h1, 'h5, 'h0);
+		send('h1, 'h5, 'h1);
+		send('h2, 'h5, 'h0);
+		send(`COMM_FINISH, 'h5, 'h0);
+		send('h1, 'h6, 'h0);
+		#5 @(posedge clk);
+		send('h2, 'h5, 'h1);
+		send(`COMM_FINISH, 'h5, 'h1);
+		send('h2, 'h6, 'h0);
+		send(`COMM_STAMP, 'h6, 'h0);
+		send(`COMM_FINISH, 'h6, 'h0);
+
+		/* The last COMM_FINISH stops profCounter: the pipe is no longer ready */
+		#5 if(pipeTREADY || !done) begin
+			$display("Still running after the last COMM_FINISH");
+			errors = errors + 1;
+		end
+
+		/* Trailer */
+		#2000 @(posedge clk);
+
+		if(errors || EVENTS != expectedLen || EVENTS != logged || COMMANDS != received || !idle)
+			$display("FAIL: %0d errors, %0d of %0d events logged, %0d commands received", errors, logged, expectedLen, received);
+		else
+			$display("PASS: %0d events from %0d work-items logged as expected", logged, ISSUERS);
+
+		#20 $finish;
+	end
+
+	/* Free-running timestamp, cleared on start */
+	always @(posedge clk) begin
+		if(start)
+			timestamp <= 'h0;
+		else
+			timestamp <= timestamp + 'h1;
+	end
+
+	/* Check every stamp and checkpoint written to memory against the commands sent */
+	always @(posedge clk) begin
+		if(axiWVALID) begin
+			for(i = 0; i < 2; i = i + 1) begin
+				record = axiWDATA[64*i +: 64];
+				if(axiWSTRB[8*i] && (`REC_STAMP == record[63:56] || record[63])) begin
+					if(logged >= expectedLen || expectedTag[logged] != record[63:56] || expectedSource[logged] != record[55:35]) begin
+						$display("Event %0d: unexpected %h", logged, record);
+						errors = errors + 1;
+					end
+					logged = logged + 1;
+				end
+			end
+		end
+	end
+
+	always begin
+		#5 clk <= ~clk;
+	end
+
+endmodule
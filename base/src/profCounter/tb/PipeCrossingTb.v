@@ -0,0 +1,160 @@
+`timescale 1ns / 1ps
+
+module PipeCrossingTb;
+
+	/* Number of commands sent by the DUT (the last one is COMM_FINISH) */
+	localparam COMMANDS = 24;
+
+	reg clk;
+	reg rst_n;
+	reg start;
+	reg [4:0] prescaler;
+	wire [31:0] outTDATA;
+	wire outTVALID;
+	reg outTREADY;
+	wire [63:0] timestamp;
+
+	reg dutClk;
+	reg dutRst_n;
+	reg [31:0] pipeTDATA;
+	reg pipeTVALID;
+	wire pipeTREADY;
+
+	/* DUT side bookkeeping: cycle counter, DUT cycle at which each command was accepted, gap before the next command */
+	reg [63:0] dutCycle;
+	reg [63:0] acceptCycle [0:COMMANDS-1];
+	reg [31:0] sent;
+	reg [1:0] gap;
+	/* ProfCounter side bookkeeping */
+	integer cycle;
+	integer received;
+	integer errors;
+	reg [63:0] firstTimestamp;
+
+	PipeCrossing#(56) inst(
+		.clk(clk),
+		.rst_n(rst_n),
+		.start(start),
+		.prescaler(prescaler),
+		/* A single COMM_FINISH ends the execution */
+		.finishes(32'h0),
+		.outTDATA(outTDATA),
+		.outTVALID(outTVALID),
+		.outTREADY(outTREADY),
+		.timestamp(timestamp),
+
+		.dutClk(dutClk),
+		.dutRst_n(dutRst_n),
+		.pipeTDATA(pipeTDATA),
+		.pipeTVALID(pipeTVALID),
+		.pipeTREADY(pipeTREADY)
+	);
+
+	/* ProfCounter side: start pulse, then a consumer that is only ready every third cycle (slower than the DUT writes) */
+	initial begin
+		$dumpfile("crossing.vcd");
+		$dumpvars;
+
+		clk <= 'b1;
+		rst_n <= 'b0;
+		start <= 'b0;
+		prescaler <= 'h0;
+		outTREADY <= 'b0;
+		cycle = 0;
+		received = 0;
+		errors = 0;
+		#200 @(posedge clk);
+
+		/* Release reset */
+		rst_n <= 'b1;
+		#200 @(posedge clk);
+
+		/* Start pulse, crosses to the DUT side as a toggle */
+		start <= 'b1;
+		#5 @(posedge clk);
+		start <= 'b0;
+
+		while(received < COMMANDS) begin
+			outTREADY <= (2 == cycle % 3);
+			cycle = cycle + 1;
+			#5 @(posedge clk);
+		end
+		outTREADY <= 'b0;
+
+		/* After COMM_FINISH, the pipe must not be ready anymore */
+		if(errors || pipeTREADY)
+			$display("FAIL: %0d errors", errors);
+		else
+			$display("PASS: %0d commands crossed in order with DUT-cycle timestamps", received);
+
+		#200 $finish;
+	end
+
+	/* Check every command leaving the crossing: order, payload and timestamp distance in DUT cycles */
+	always @(posedge clk) begin
+		if(outTVALID && outTREADY) begin
+			if((COMMANDS - 1 == received)? ('hF != outTDATA) : ({received[27:0], 4'h1} != outTDATA)) begin
+				$display("Command %0d: unexpected payload %h", received, outTDATA);
+				errors = errors + 1;
+			end
+
+			if(!received)
+				firstTimestamp = timestamp;
+			else if(timestamp - firstTimestamp != acceptCycle[received] - acceptCycle[0]) begin
+				$display("Command %0d: timestamp distance %0d, expected %0d", received, timestamp - firstTimestamp, acceptCycle[received] - acceptCycle[0]);
+				errors = errors + 1;
+			end
+
+			received = received + 1;
+		end
+	end
+
+	/* DUT side: unrelated clock, commands are written with gaps of 0 to 3 cycles. Each write waits for TREADY (before start, */
+	/* the first one waits until the start toggle crosses) */
+	always @(posedge dutClk) begin
+		if(!dutRst_n) begin
+			pipeTDATA <= 'h0;
+			pipeTVALID <= 'b0;
+			sent <= 'h0;
+			gap <= 'h0;
+		end
+		else if(pipeTVALID && pipeTREADY) begin
+			acceptCycle[sent] <= dutCycle;
+			sent <= sent + 'h1;
+			gap <= sent[1:0];
+			pipeTVALID <= 'b0;
+		end
+		else if(!pipeTVALID && sent < COMMANDS) begin
+			if(gap) begin
+				gap <= gap - 'h1;
+			end
+			else begin
+				pipeTDATA <= (COMMANDS - 1 == sent)? 'hF : {sent[27:0], 4'h1};
+				pipeTVALID <= 'b1;
+			end
+		end
+	end
+
+	always @(posedge dutClk) begin
+		if(!dutRst_n)
+			dutCycle <= 'h0;
+		else
+			dutCycle <= dutCycle + 'h1;
+	end
+
+	/* Reset of the DUT domain, released at an unrelated time */
+	initial begin
+		dutClk <= 'b1;
+		dutRst_n <= 'b0;
+		#330 dutRst_n <= 'b1;
+	end
+
+	/* Unrelated clocks: 100 MHz and ~137 MHz */
+	always begin
+		#5 clk <= ~clk;
+	end
+	always begin
+		#3.65 dutClk <= ~dutClk;
+	end
+
+endmodule
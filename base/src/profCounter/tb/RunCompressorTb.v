@@ -0,0 +1,139 @@
+`timescale 1ns / 1ps
+
+`include "records.vh"
+
+module RunCompressorTb;
+
+	/* Number of records sent to and expected from the compressor */
+	localparam INPUTS = 16;
+	localparam OUTPUTS = 12;
+	/* Records expected from the first execution */
+	localparam FIRST_OUTPUTS = 9;
+
+	reg clk;
+	reg rst_n;
+	reg start;
+	reg inEnqueue;
+	reg [63:0] inRecord;
+	wire outEnqueue;
+	wire [63:0] outRecord;
+	wire idle;
+
+	reg [63:0] stream [0:INPUTS-1];
+	reg [63:0] expected [0:OUTPUTS-1];
+	integer i;
+	integer received;
+	integer errors;
+
+	/* Tolerance of 1 count */
+	RunCompressor#(56, 1, 1) inst(
+		.clk(clk),
+		.rst_n(rst_n),
+
+		.start(start),
+		.inEnqueue(inEnqueue),
+		.inRecord(inRecord),
+		.outEnqueue(outEnqueue),
+		.outRecord(outRecord),
+		.idle(idle)
+	);
+
+	initial begin
+		$dumpfile("compressor.vcd");
+		$dumpvars;
+
+		/* Header, clocks record, a run of checkpoint 0 with 10 counts per iteration (one record 1 count late), checkpoint 1, a stamp, */
+		/* a run of checkpoint 0 that ends when a record is 2 counts late, COMM_FINISH */
+		stream[0] = {`REC_HEADER, 56'h01380000000000};
+		stream[1] = {`REC_CLOCKS, 56'h0};
+		stream[2] = {`REC_CHECKPOINT, 56'd100};
+		stream[3] = {`REC_CHECKPOINT, 56'd110};
+		stream[4] = {`REC_CHECKPOINT, 56'd121};
+		stream[5] = {`REC_CHECKPOINT, 56'd130};
+		stream[6] = {`REC_CHECKPOINT, 56'd140};
+		stream[7] = {`REC_CHECKPOINT | 8'h01, 56'd145};
+		stream[8] = {`REC_STAMP, 56'd150};
+		stream[9] = {`REC_CHECKPOINT, 56'd160};
+		stream[10] = {`REC_CHECKPOINT, 56'd170};
+		stream[11] = {`REC_CHECKPOINT, 56'd182};
+		stream[12] = 'hFFFFFFFFFFFFFFFF;
+		/* Second execution, a single record */
+		stream[13] = {`REC_HEADER, 56'h01380000000000};
+		stream[14] = {`REC_CHECKPOINT | 8'h02, 56'd7};
+		stream[15] = 'hFFFFFFFFFFFFFFFF;
+
+		expected[0] = {`REC_HEADER, 56'h01380000000000};
+		expected[1] = {`REC_CLOCKS, 56'h0};
+		expected[2] = {`REC_CHECKPOINT, 56'd100};
+		expected[3] = {`REC_REPEAT, `REC_CHECKPOINT, 16'd4, 32'd10};
+		expected[4] = {`REC_CHECKPOINT | 8'h01, 56'd145};
+		expected[5] = {`REC_STAMP, 56'd150};
+		expected[6] = {`REC_REPEAT, `REC_CHECKPOINT, 16'd2, 32'd10};
+		expected[7] = {`REC_CHECKPOINT, 56'd182};
+		expected[8] = 'hFFFFFFFFFFFFFFFF;
+		expected[9] = {`REC_HEADER, 56'h01380000000000};
+		expected[10] = {`REC_CHECKPOINT | 8'h02, 56'd7};
+		expected[11] = 'hFFFFFFFFFFFFFFFF;
+
+		clk <= 'b1;
+		rst_n <= 'b0;
+		start <= 'b0;
+		inEnqueue <= 'b0;
+		inRecord <= 'h0;
+		received = 0;
+		errors = 0;
+		#20 @(posedge clk);
+
+		rst_n <= 'b1;
+		#20 @(posedge clk);
+
+		/* One record per cycle, except for a gap before the stamp. Start is asserted with each header */
+		for(i = 0; i < INPUTS; i = i + 1) begin
+			if(8 == i) begin
+				inEnqueue <= 'b0;
+				#5 @(posedge clk);
+			end
+			/* First execution must be fully written (COMM_FINISH follows the last run) before the second one starts */
+			if(13 == i) begin
+				inEnqueue <= 'b0;
+				#20 @(posedge clk);
+				#1 if(!idle || FIRST_OUTPUTS != received) begin
+					$display("First execution: %0d records written, idle %b", received, idle);
+					errors = errors + 1;
+				end
+			end
+
+			start <= `REC_HEADER == stream[i][63:56];
+			inEnqueue <= 'b1;
+			inRecord <= stream[i];
+			#5 @(posedge clk);
+		end
+		start <= 'b0;
+		inEnqueue <= 'b0;
+		#20 @(posedge clk);
+
+		/* Second execution: header, checkpoint 2 unchanged (the run state is cleared on start), COMM_FINISH */
+		if(errors || !idle || OUTPUTS != received)
+			$display("FAIL: %0d errors", errors);
+		else
+			$display("PASS: runs compressed as expected");
+
+		#20 $finish;
+	end
+
+	/* Check every record written */
+	always @(posedge clk) begin
+		if(outEnqueue) begin
+			if(received >= OUTPUTS || expected[received] != outRecord) begin
+				$display("Record %0d: unexpected %h", received, outRecord);
+				errors = errors + 1;
+			end
+			received = received + 1;
+		end
+	end
+
+	always begin
+		#5 clk <= ~clk;
+	end
+
+endmodule
@@ -0,0 +1,137 @@
+`timescale 1ns / 1ps
+
+`include "commands.vh"
+`include "records.vh"
+
+module SamplerTb;
+
+	/* Sampling interval, and cycle of COMM_FINISH after start */
+	localparam INTERVAL = 4;
+	localparam FINISH = 42;
+	/* Samples expected before COMM_FINISH */
+	localparam SAMPLES = 10;
+
+	reg clk;
+	reg rst_n;
+	reg start;
+	reg [31:0] interval;
+	reg [3:0] command;
+	reg [6:0] checkpointId;
+	reg [63:0] timestamp;
+	reg busy;
+	wire sampling;
+	wire sampleEnqueue;
+	wire [63:0] sampleRecord;
+
+	/* Expected state of the sampler, updated as commands are sent */
+	reg [6:0] modelCurrent;
+	reg modelSeen;
+	reg [11:0] modelHits;
+	reg [63:0] lastTimestamp;
+	integer i;
+	integer received;
+	integer errors;
+
+	Sampler inst(
+		.clk(clk),
+		.rst_n(rst_n),
+
+		.start(start),
+		.interval(interval),
+		.sampling(sampling),
+		.command(command),
+		.checkpointId(checkpointId),
+		.timestamp(timestamp),
+		.busy(busy),
+		.sampleEnqueue(sampleEnqueue),
+		.sampleRecord(sampleRecord)
+	);
+
+	initial begin
+		$dumpfile("sampler.vcd");
+		$dumpvars;
+
+		clk <= 'b1;
+		rst_n <= 'b0;
+		start <= 'b0;
+		interval <= INTERVAL;
+		command <= `COMM_NOP;
+		checkpointId <= 'h0;
+		busy <= 'b0;
+		received = 0;
+		errors = 0;
+		#20 @(posedge clk);
+
+		rst_n <= 'b1;
+		#20 @(posedge clk);
+
+		/* Start, then the clocks record keeps the writer busy for a cycle */
+		start <= 'b1;
+		busy <= 'b1;
+		#5 @(posedge clk);
+		start <= 'b0;
+		#5 @(posedge clk);
+		busy <= 'b0;
+
+		/* A checkpoint every third cycle, IDs 0 to 4 in turn, then COMM_FINISH */
+		for(i = 2; i < FINISH; i = i + 1) begin
+			command <= (i % 3)? `COMM_NOP : (((i / 3) % 5) + 'h1);
+			checkpointId <= (i / 3) % 5;
+			#5 @(posedge clk);
+		end
+		command <= `COMM_FINISH;
+		#5 @(posedge clk);
+		command <= `COMM_NOP;
+
+		/* No sample after COMM_FINISH */
+		#200 @(posedge clk);
+
+		if(errors || SAMPLES != received || sampling != 'b1)
+			$display("FAIL: %0d errors, %0d samples", errors, received);
+		else
+			$display("PASS: %0d samples as expected", received);
+
+		#20 $finish;
+	end
+
+	/* Free-running timestamp, cleared on start */
+	always @(posedge clk) begin
+		if(start)
+			timestamp <= 'h0;
+		else
+			timestamp <= timestamp + 'h1;
+	end
+
+	/* Check every sample against the commands sent so far */
+	always @(posedge clk) begin
+		if(start) begin
+			modelCurrent = 'h0;
+			modelSeen = 'b0;
+			modelHits = 'h0;
+		end
+		else if(sampleEnqueue) begin
+			if(busy || {`REC_SAMPLE, modelCurrent, modelSeen, modelHits} != sampleRecord[63:36]) begin
+				$display("Sample %0d: unexpected %h", received, sampleRecord);
+				errors = errors + 1;
+			end
+			if(received && INTERVAL != timestamp - lastTimestamp) begin
+				$display("Sample %0d: %0d cycles after the previous one", received, timestamp - lastTimestamp);
+				errors = errors + 1;
+			end
+			lastTimestamp = timestamp;
+			received = received + 1;
+			modelHits = 'h0;
+		end
+
+		if(`COMM_NOP != command && command < `COMM_STAMP) begin
+			modelCurrent = checkpointId;
+			modelSeen = 'b1;
+			modelHits = modelHits + 'h1;
+		end
+	end
+
+	always begin
+		#5 clk <= ~clk;
+	end
+
+endmodule
@@ -5,9 +5,13 @@ module SequentialWriterTb;
 	reg clk;
 	reg rst_n;
 
+	reg start;
+	reg [4:0] prescaler;
 	reg [63:0] offset;
 	reg [3:0] command;
+	reg [6:0] bank;
 	reg [63:0] value;
+	reg [47:0] received;
 	wire idle;
 
 	wire axiAWVALID;
@@ -17,21 +21,28 @@ module SequentialWriterTb;
 	wire [2:0] axiAWSIZE;
 	wire axiWVALID;
 	reg axiWREADY;
-	wire [63:0] axiWDATA;
-	wire [7:0] axiWSTRB;
+	wire [127:0] axiWDATA;
+	wire [15:0] axiWSTRB;
 	wire axiWLAST;
 	reg [1:0] axiBRESP;
 	reg axiBVALID;
 	wire axiBREADY;
 
-	/* DUT */
-	SequentialWriter inst(
+	/* DUT, two records per beat */
+	SequentialWriter#(128) inst(
 		.clk(clk),
 		.rst_n(rst_n),
 
+		.start(start),
+		.prescaler(prescaler),
 		.offset(offset),
 		.command(command),
+		.bank(bank),
 		.value(value),
+		.clock(value),
+		/* Event logging */
+		.interval(32'h0),
+		.received(received),
 		.idle(idle),
 
 		.axiAWVALID(axiAWVALID),
@@ -56,9 +67,13 @@ module SequentialWriterTb;
 		/* Reset */
 		clk <= 'b1;
 		rst_n <= 'b0;
+		start <= 'b0;
+		prescaler <= 'h0;
 		offset <= 'hDEADCAFE00;
 		command <= 'h0;
+		bank <= 'h0;
 		value <= 'hDEADBEEF00;
+		received <= 'h0;
 		axiAWREADY <= 'b1;
 		axiWREADY <= 'b1;
 		axiBRESP <= 'b00;
@@ -69,6 +84,13 @@ module SequentialWriterTb;
 		rst_n <= 'b1;
 		#200 @(posedge clk);
 
+		/* Start pulse, header record is enqueued, then the clocks and sync records in the next two cycles (no command is issued in these) */
+		start <= 'b1;
+		#50 @(posedge clk);
+		start <= 'b0;
+		#50 @(posedge clk);
+		#50 @(posedge clk);
+
 		command <= 'h1;
 		value <= 'hDEADBEEF00;
 		#50 @(posedge clk);
@@ -85,19 +107,31 @@ module SequentialWriterTb;
 		value <= 'hDEADCAFE00;
 		#50 @(posedge clk);
 
-		command <= 'h1;
+		command <= 'h2;
 		value <= 'hDEADCAFE10;
 		#50 @(posedge clk);
 
-		command <= 'h1;
-		value <= 'hDEADCAFE20;
+		/* Slow memory: the pending write response is held for 20 cycles, counted as BVALID blocked cycles and in the 16-31 latency bin */
+		command <= 'h0;
+		axiBVALID <= 'b0;
+		#1950 @(posedge clk);
+		axiBVALID <= 'b1;
 		#50 @(posedge clk);
 
-		command <= 'h2;
+		/* Banked checkpoint: bank 10, command 0x8 is ID 127 (tag 0xFF) */
+		command <= 'h8;
+		bank <= 'hA;
+		#50 @(posedge clk);
+		bank <= 'h0;
+
+		/* COMM_FINISH appends the 16 telemetry records (e.g. 7 commands received). Odd number of records in total (header, clocks, */
+		/* sync, 6 checkpoints and the trailer), the last beat is flushed with the upper strobes deasserted */
+		received <= 'h7;
+		command <= 'hF;
 		#50 @(posedge clk);
 
 		command <= 'h0;
-		#2000 @(posedge clk);
+		#4000 @(posedge clk);
 
 		$finish;
 	end
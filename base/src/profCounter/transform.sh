@@ -20,4 +20,8 @@ sed -i "/store volatile i32.*PROFCOUNTER_COMM_DUMMY_VAR.*/d" $1
 sed -i "s/  %.* = add i32 %.*PROFCOUNTER_COMM_DUMMY_VAR.*, \\([0-9]\\+\\), !dbg.*/  store i32 \\1, i32 addrspace(4)* %p0/g" $1
 sed -i "s/  %.* = add i32 \\([0-9]\\+\\), %.*PROFCOUNTER_COMM_DUMMY_VAR.*, !dbg.*/  store i32 \\1, i32 addrspace(4)* %p0/g" $1
 
+# With PROFCOUNTER_NDRANGE, the pipe word is computed at runtime (command ORed with the issuer), so the other operand is a register
+sed -i "s/  %.* = add i32 %[^,]*PROFCOUNTER_COMM_DUMMY_VAR[^,]*, %\\([^ ,]\\+\\), !dbg.*/  store i32 %\\1, i32 addrspace(4)* %p0/g" $1
+sed -i "s/  %.* = add i32 %\\([^ ,]\\+\\), %[^,]*PROFCOUNTER_COMM_DUMMY_VAR[^,]*, !dbg.*/  store i32 %\\1, i32 addrspace(4)* %p0/g" $1
+
 exit
\ No newline at end of file
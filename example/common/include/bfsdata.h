@@ -0,0 +1,90 @@
+#ifndef BFSDATA_H
+#define BFSDATA_H
+
+#include <stdint.h>
+
+/**
+ * @brief BFS dataset file constants. A dataset file starts with a bfs_header_t, followed by the input levels (numVertices), the edge
+ * offsets (numVertices + 1), the edge list (numEdges) and the reference output levels (numVertices), all as little-endian 32-bit
+ * unsigned integers.
+ */
+#define BFS_DATA_MAGIC 0x47534642
+#define BFS_DATA_VERSION 1
+
+/**
+ * @brief Level of a vertex not (yet) reached.
+ */
+#define BFS_DATA_UNREACHED 0xFFFFFFFF
+
+/**
+ * @brief Header of a BFS dataset file.
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numVertices;
+	uint32_t numEdges;
+	/* Vertex where the search starts */
+	uint32_t source;
+	/* Maximum level in the reference output (i.e. number of BFS levels minus one) */
+	uint32_t depth;
+} bfs_header_t;
+
+/**
+ * @brief A loaded BFS dataset. All arrays point into the memory-mapped file and are read-only.
+ */
+typedef struct {
+	unsigned numVertices;
+	unsigned numEdges;
+	unsigned source;
+	unsigned depth;
+	/* Input levels: 0 at the source, BFS_DATA_UNREACHED elsewhere */
+	const unsigned *levels;
+	/* Compressed sparse rows: neighbours of vertex v are edgeList[edgeOffsets[v]] to edgeList[edgeOffsets[v + 1] - 1] */
+	const unsigned *edgeOffsets;
+	const unsigned *edgeList;
+	/* Reference output levels, used for validation */
+	const unsigned *levelsC;
+	/* Mapping of the whole file */
+	void *map;
+	size_t mapSz;
+} bfs_data_t;
+
+/**
+ * @brief Memory-map a BFS dataset file. Sizes are taken from its header and checked against the file size, and the edge offsets
+ * and edge list are checked to be in range.
+ * @param fileName Path to the dataset file.
+ * @param data Loaded dataset. Must be released with bfs_data_free().
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int bfs_data_load(const char *fileName, bfs_data_t *data);
+
+/**
+ * @brief Unmap a BFS dataset.
+ * @param data Dataset to be released.
+ */
+void bfs_data_free(bfs_data_t *data);
+
+/**
+ * @brief Compute the BFS levels of a graph on the host.
+ * @param numVertices Number of vertices.
+ * @param edgeOffsets Edge offsets (numVertices + 1 elements).
+ * @param edgeList Edge list.
+ * @param source Vertex where the search starts.
+ * @param levels Output levels (numVertices elements). Unreachable vertices are set to BFS_DATA_UNREACHED.
+ * @return Maximum level reached, or -1 if memory could not be allocated.
+ */
+long bfs_data_levels(unsigned numVertices, const unsigned *edgeOffsets, const unsigned *edgeList, unsigned source, unsigned *levels);
+
+/**
+ * @brief Save a graph as a BFS dataset file. Input and reference output levels are computed from @p source.
+ * @param fileName Path to the dataset file.
+ * @param numVertices Number of vertices.
+ * @param edgeOffsets Edge offsets (numVertices + 1 elements).
+ * @param edgeList Edge list (edgeOffsets[numVertices] elements).
+ * @param source Vertex where the search starts.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+ */
+int bfs_data_save(const char *fileName, unsigned numVertices, const unsigned *edgeOffsets, const unsigned *edgeList, unsigned source);
+
+#endif
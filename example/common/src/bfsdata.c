@@ -0,0 +1,186 @@
+/**
+ * BFS dataset loader
+ *
+ * Datasets are single binary files (see bfsdata.h) holding a graph in compressed sparse rows, plus the input and reference output
+ * levels. They are memory-mapped, so that loading does not depend on the graph size and the arrays can be handed directly to the
+ * OpenCL runtime. Datasets are created with bfsgen.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bfsdata.h"
+#include "common.h"
+
+int bfs_data_load(const char *fileName, bfs_data_t *data) {
+	int rv = EXIT_SUCCESS;
+	int fd = -1;
+	struct stat fileStat;
+	const bfs_header_t *header;
+	const uint32_t *arrays;
+	size_t expectedSz;
+	size_t i;
+
+	memset(data, 0, sizeof(bfs_data_t));
+	data->map = MAP_FAILED;
+
+	fd = open(fileName, O_RDONLY);
+	ASSERT_CALL(fd != -1, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+	ASSERT_CALL(!fstat(fd, &fileStat), fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+	data->mapSz = fileStat.st_size;
+	ASSERT_CALL(data->mapSz >= sizeof(bfs_header_t), fprintf(stderr, "Error: %s is not a BFS dataset.\n", fileName); rv = EXIT_FAILURE);
+	data->map = mmap(NULL, data->mapSz, PROT_READ, MAP_SHARED, fd, 0);
+	ASSERT_CALL(MAP_FAILED != data->map, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+
+	header = (const bfs_header_t *) data->map;
+	ASSERT_CALL(BFS_DATA_MAGIC == header->magic, fprintf(stderr, "Error: %s is not a BFS dataset.\n", fileName); rv = EXIT_FAILURE);
+	ASSERT_CALL(
+		BFS_DATA_VERSION == header->version,
+		fprintf(stderr, "Error: unsupported BFS dataset version %u.\n", header->version); rv = EXIT_FAILURE
+	);
+	ASSERT_CALL(
+		header->numVertices && header->source < header->numVertices,
+		fprintf(stderr, "Error: invalid BFS dataset header in %s.\n", fileName); rv = EXIT_FAILURE
+	);
+
+	/* All sizes come from the header, the file must hold exactly the arrays it describes */
+	expectedSz = sizeof(bfs_header_t) + (3 * (size_t) header->numVertices + 1 + header->numEdges) * sizeof(uint32_t);
+	ASSERT_CALL(
+		expectedSz == data->mapSz,
+		fprintf(stderr, "Error: %s has %zu bytes, expected %zu.\n", fileName, data->mapSz, expectedSz); rv = EXIT_FAILURE
+	);
+
+	arrays = (const uint32_t *) (header + 1);
+	data->numVertices = header->numVertices;
+	data->numEdges = header->numEdges;
+	data->source = header->source;
+	data->depth = header->depth;
+	data->levels = arrays;
+	data->edgeOffsets = &(arrays[data->numVertices]);
+	data->edgeList = &(arrays[2 * data->numVertices + 1]);
+	data->levelsC = &(arrays[2 * data->numVertices + 1 + data->numEdges]);
+	ASSERT_CALL(
+		data->edgeOffsets[data->numVertices] == data->numEdges,
+		fprintf(stderr, "Error: edge offsets of %s do not match its number of edges.\n", fileName); rv = EXIT_FAILURE
+	);
+
+	/* The kernels index the arrays with these values unchecked, so every row and every neighbour must be in range */
+	for(i = 0; i < data->numVertices; i++) {
+		ASSERT_CALL(
+			data->edgeOffsets[i] <= data->edgeOffsets[i + 1],
+			fprintf(stderr, "Error: edge offsets of %s decrease at vertex %zu.\n", fileName, i); rv = EXIT_FAILURE
+		);
+	}
+	for(i = 0; i < data->numEdges; i++) {
+		ASSERT_CALL(
+			data->edgeList[i] < data->numVertices,
+			fprintf(stderr, "Error: edge %zu of %s points to vertex %u, out of range.\n", i, fileName, data->edgeList[i]); rv = EXIT_FAILURE
+		);
+	}
+
+_err:
+	if(fd != -1)
+		close(fd);
+	if(EXIT_FAILURE == rv)
+		bfs_data_free(data);
+
+	return rv;
+}
+
+void bfs_data_free(bfs_data_t *data) {
+	if(data->map && MAP_FAILED != data->map)
+		munmap(data->map, data->mapSz);
+
+	memset(data, 0, sizeof(bfs_data_t));
+}
+
+long bfs_data_levels(unsigned numVertices, const unsigned *edgeOffsets, const unsigned *edgeList, unsigned source, unsigned *levels) {
+	unsigned *queue = malloc(numVertices * sizeof(unsigned));
+	size_t head = 0;
+	size_t tail = 0;
+	unsigned i;
+	long depth = 0;
+
+	if(!queue)
+		return -1;
+
+	for(i = 0; i < numVertices; i++)
+		levels[i] = BFS_DATA_UNREACHED;
+
+	levels[source] = 0;
+	queue[tail++] = source;
+	while(head < tail) {
+		unsigned v = queue[head++];
+
+		for(i = edgeOffsets[v]; i < edgeOffsets[v + 1]; i++) {
+			unsigned w = edgeList[i];
+
+			if(BFS_DATA_UNREACHED == levels[w]) {
+				levels[w] = levels[v] + 1;
+				if(levels[w] > depth)
+					depth = levels[w];
+				queue[tail++] = w;
+			}
+		}
+	}
+
+	free(queue);
+
+	return depth;
+}
+
+int bfs_data_save(const char *fileName, unsigned numVertices, const unsigned *edgeOffsets, const unsigned *edgeList, unsigned source) {
+	int rv = EXIT_SUCCESS;
+	unsigned i;
+	long depth;
+	bfs_header_t header;
+	unsigned *levels = NULL;
+	unsigned *levelsC = NULL;
+	FILE *dataFile = NULL;
+
+	levels = malloc(numVertices * sizeof(unsigned));
+	levelsC = malloc(numVertices * sizeof(unsigned));
+	ASSERT_CALL(levels && levelsC, fprintf(stderr, "Error: could not allocate memory for levels.\n"); rv = EXIT_FAILURE);
+
+	for(i = 0; i < numVertices; i++)
+		levels[i] = BFS_DATA_UNREACHED;
+	levels[source] = 0;
+	depth = bfs_data_levels(numVertices, edgeOffsets, edgeList, source, levelsC);
+	ASSERT_CALL(depth >= 0, fprintf(stderr, "Error: could not allocate memory for levels.\n"); rv = EXIT_FAILURE);
+
+	header.magic = BFS_DATA_MAGIC;
+	header.version = BFS_DATA_VERSION;
+	header.numVertices = numVertices;
+	header.numEdges = edgeOffsets[numVertices];
+	header.source = source;
+	header.depth = depth;
+
+	dataFile = fopen(fileName, "wb");
+	ASSERT_CALL(dataFile, fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE);
+	ASSERT_CALL(
+		1 == fwrite(&header, sizeof(bfs_header_t), 1, dataFile) &&
+		numVertices == fwrite(levels, sizeof(unsigned), numVertices, dataFile) &&
+		numVertices + 1 == fwrite(edgeOffsets, sizeof(unsigned), numVertices + 1, dataFile) &&
+		header.numEdges == fwrite(edgeList, sizeof(unsigned), header.numEdges, dataFile) &&
+		numVertices == fwrite(levelsC, sizeof(unsigned), numVertices, dataFile),
+		fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName); rv = EXIT_FAILURE
+	);
+
+_err:
+	if(dataFile && fclose(dataFile) && EXIT_SUCCESS == rv) {
+		fprintf(stderr, "Error: %s: %s\n", strerror(errno), fileName);
+		rv = EXIT_FAILURE;
+	}
+	if(levels)
+		free(levels);
+	if(levelsC)
+		free(levelsC);
+
+	return rv;
+}
@@ -0,0 +1,191 @@
+/**
+ * BFS dataset generator
+ *
+ * Generates synthetic undirected graphs and saves them as BFS datasets (see bfsdata.h), with the reference levels already computed:
+ *
+ * bfsgen TYPE VERTICES OUTPUT [degree=<average degree>] [seed=<seed>] [source=<vertex>]
+ *
+ * uniform: edges between uniformly chosen vertex pairs (shallow search, even work per level);
+ * power-law: preferential attachment (Barabasi-Albert), a few hub vertices with very high degree;
+ * road: 2D grid with randomly removed streets, low degree and a search depth in the order of the square root of the vertex count.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bfsdata.h"
+#include "common.h"
+
+/* Graph types */
+typedef enum {
+	BFSGEN_UNIFORM,
+	BFSGEN_POWER_LAW,
+	BFSGEN_ROAD
+} bfsgen_type_t;
+
+/* Directed arcs of the graph being generated (each undirected edge is stored as two arcs) */
+typedef struct {
+	unsigned *from;
+	unsigned *to;
+	size_t len;
+	size_t capacity;
+} bfsgen_arcs_t;
+
+/* xorshift64* state. A private generator keeps datasets reproducible across C libraries */
+static uint64_t randomState = 0x9E3779B97F4A7C15ull;
+
+static uint64_t bfsgen_random(uint64_t bound) {
+	randomState ^= randomState >> 12;
+	randomState ^= randomState << 25;
+	randomState ^= randomState >> 27;
+
+	return (randomState * 0x2545F4914F6CDD1Dull) % bound;
+}
+
+static void bfsgen_edge(bfsgen_arcs_t *arcs, unsigned u, unsigned v) {
+	arcs->from[arcs->len] = u;
+	arcs->to[(arcs->len)++] = v;
+	arcs->from[arcs->len] = v;
+	arcs->to[(arcs->len)++] = u;
+}
+
+static void bfsgen_uniform(bfsgen_arcs_t *arcs, unsigned numVertices, unsigned degree) {
+	size_t i;
+	size_t edgesLen = ((size_t) numVertices * degree) / 2;
+
+	for(i = 0; i < edgesLen; i++) {
+		unsigned u = bfsgen_random(numVertices);
+		unsigned v = bfsgen_random(numVertices);
+
+		if(u != v)
+			bfsgen_edge(arcs, u, v);
+	}
+}
+
+static void bfsgen_power_law(bfsgen_arcs_t *arcs, unsigned numVertices, unsigned degree) {
+	unsigned u, v;
+	unsigned i;
+	unsigned m = (degree > 1)? degree / 2 : 1;
+
+	/* Start from a clique of m + 1 vertices */
+	for(u = 0; u <= m && u < numVertices; u++) {
+		for(v = 0; v < u; v++)
+			bfsgen_edge(arcs, u, v);
+	}
+
+	/* Every new vertex attaches to m vertices chosen with probability proportional to their degree (i.e. the endpoint of a random arc) */
+	for(u = m + 1; u < numVertices; u++) {
+		for(i = 0; i < m; i++)
+			bfsgen_edge(arcs, u, arcs->to[bfsgen_random(arcs->len)]);
+	}
+}
+
+static void bfsgen_road(bfsgen_arcs_t *arcs, unsigned numVertices, unsigned degree) {
+	unsigned u;
+	unsigned width = ceil(sqrt(numVertices));
+	/* A full grid has degree 4, streets are kept with the probability that gives the requested average degree */
+	uint64_t keep = (degree >= 4)? 1000 : (degree * 1000) / 4;
+
+	for(u = 0; u < numVertices; u++) {
+		if((u % width) + 1 < width && u + 1 < numVertices && bfsgen_random(1000) < keep)
+			bfsgen_edge(arcs, u, u + 1);
+		if(u + width < numVertices && bfsgen_random(1000) < keep)
+			bfsgen_edge(arcs, u, u + width);
+	}
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s TYPE VERTICES OUTPUT [degree=<average degree>] [seed=<seed>] [source=<vertex>]\n", name);
+	fprintf(stderr, "\tTYPE\tuniform, power-law or road\n");
+	fprintf(stderr, "\tVERTICES\tnumber of vertices\n");
+	fprintf(stderr, "\tOUTPUT\tdataset file (e.g. aux/graph.bfs)\n");
+	fprintf(stderr, "\tdegree\taverage vertex degree (default is 8, or 3 for road)\n");
+	fprintf(stderr, "\tseed\tseed of the random generator\n");
+	fprintf(stderr, "\tsource\tvertex where the search starts (default is 0)\n");
+}
+
+int main(int argc, char *argv[]) {
+	int rv = EXIT_SUCCESS;
+	int i;
+	size_t j;
+	bfsgen_type_t type;
+	unsigned numVertices;
+	unsigned degree = 0;
+	unsigned source = 0;
+	bfsgen_arcs_t arcs = {0};
+	unsigned *edgeOffsets = NULL;
+	unsigned *edgeList = NULL;
+	unsigned *fill = NULL;
+
+	ASSERT_CALL(argc >= 4, usage(argv[0]); rv = EXIT_FAILURE);
+	ASSERT_CALL(
+		!strcmp(argv[1], "uniform") || !strcmp(argv[1], "power-law") || !strcmp(argv[1], "road"),
+		usage(argv[0]); rv = EXIT_FAILURE
+	);
+	if(!strcmp(argv[1], "uniform"))
+		type = BFSGEN_UNIFORM;
+	else if(!strcmp(argv[1], "power-law"))
+		type = BFSGEN_POWER_LAW;
+	else
+		type = BFSGEN_ROAD;
+	numVertices = strtoul(argv[2], NULL, 10);
+	ASSERT_CALL(numVertices > 1, fprintf(stderr, "Error: a graph needs at least 2 vertices.\n"); rv = EXIT_FAILURE);
+
+	for(i = 4; i < argc; i++) {
+		if(!strncmp(argv[i], "degree=", 7))
+			degree = strtoul(argv[i] + 7, NULL, 10);
+		else if(!strncmp(argv[i], "seed=", 5))
+			randomState ^= strtoull(argv[i] + 5, NULL, 10) * 0xBF58476D1CE4E5B9ull;
+		else if(!strncmp(argv[i], "source=", 7))
+			source = strtoul(argv[i] + 7, NULL, 10);
+	}
+	if(!degree)
+		degree = (BFSGEN_ROAD == type)? 3 : 8;
+	ASSERT_CALL(source < numVertices, fprintf(stderr, "Error: source vertex out of range.\n"); rv = EXIT_FAILURE);
+
+	/* Every generator adds at most degree + 2 arcs per vertex (the power-law clique adds a few more for small graphs) */
+	arcs.capacity = (size_t) numVertices * (degree + 2) + (size_t) (degree + 2) * (degree + 2);
+	ASSERT_CALL(arcs.capacity <= UINT32_MAX, fprintf(stderr, "Error: graph too large, edge offsets are 32-bit.\n"); rv = EXIT_FAILURE);
+	arcs.from = malloc(arcs.capacity * sizeof(unsigned));
+	arcs.to = malloc(arcs.capacity * sizeof(unsigned));
+	ASSERT_CALL(arcs.from && arcs.to, fprintf(stderr, "Error: could not allocate memory for %zu edges.\n", arcs.capacity); rv = EXIT_FAILURE);
+
+	if(BFSGEN_UNIFORM == type)
+		bfsgen_uniform(&arcs, numVertices, degree);
+	else if(BFSGEN_POWER_LAW == type)
+		bfsgen_power_law(&arcs, numVertices, degree);
+	else
+		bfsgen_road(&arcs, numVertices, degree);
+
+	/* Convert arcs to compressed sparse rows */
+	edgeOffsets = calloc((size_t) numVertices + 1, sizeof(unsigned));
+	fill = calloc(numVertices, sizeof(unsigned));
+	edgeList = malloc((arcs.len? arcs.len : 1) * sizeof(unsigned));
+	ASSERT_CALL(edgeOffsets && fill && edgeList, fprintf(stderr, "Error: could not allocate memory for edge list.\n"); rv = EXIT_FAILURE);
+	for(j = 0; j < arcs.len; j++)
+		(edgeOffsets[arcs.from[j] + 1])++;
+	for(j = 0; j < numVertices; j++)
+		edgeOffsets[j + 1] += edgeOffsets[j];
+	for(j = 0; j < arcs.len; j++)
+		edgeList[edgeOffsets[arcs.from[j]] + (fill[arcs.from[j]])++] = arcs.to[j];
+
+	ASSERT_CALL(EXIT_SUCCESS == bfs_data_save(argv[3], numVertices, edgeOffsets, edgeList, source), rv = EXIT_FAILURE);
+	printf("Saved %s graph with %u vertices and %zu edges (directed) to %s.\n", argv[1], numVertices, arcs.len, argv[3]);
+
+_err:
+	if(arcs.from)
+		free(arcs.from);
+	if(arcs.to)
+		free(arcs.to);
+	if(edgeOffsets)
+		free(edgeOffsets);
+	if(edgeList)
+		free(edgeList);
+	if(fill)
+		free(fill);
+
+	return rv;
+}
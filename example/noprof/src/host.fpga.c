@@ -31,8 +31,8 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+#include "bfsdata.h"
 #include "common.h"
-#include "prepostambles.h"
 
 /**
  * @brief Standard statements for function error handling and printing.
@@ -74,8 +74,10 @@ int main(int argc, char *argv[]) {
 	cl_int programRet;
 	cl_program program = NULL;
 	cl_kernel kernelBfs = NULL;
-	bool loopFlag = false;
+	int runsLen = 1;
+	const char *dataFileName = "graph.bfs";
 	bool invalidDataFound = false;
+	unsigned int invalidDataLen = 0;
 	long totalTime;
 	struct timeval tThen, tNow, tDelta, tExecTime;
 	timerclear(&tExecTime);
@@ -88,19 +90,30 @@ int main(int argc, char *argv[]) {
 	};
 
 	/* Input/output variables */
-	unsigned int *levels = malloc(1000 * sizeof(unsigned int));
-	unsigned int *levelsC = malloc(1000 * sizeof(unsigned int));
+	bfs_data_t data = {0};
+	unsigned int *levels = NULL;
 	cl_mem levelsK = NULL;
-	unsigned int *edgeOffsets = malloc(1001 * sizeof(unsigned int));
 	cl_mem edgeOffsetsK = NULL;
-	unsigned int *edgeList = malloc(1998 * sizeof(unsigned int));
 	cl_mem edgeListK = NULL;
 	unsigned int numVertices;
 
-	/* Calling preamble function */
-	PRINT_STEP("Calling preamble function...");
-	PREAMBLE(levels, 1000, levelsC, 1000, edgeOffsets, 1001, edgeList, 1998, numVertices);
+	for(i = 1; i < argc; i++) {
+		if(!strncmp(argv[i], "runs=", 5))
+			runsLen = atoi(argv[i] + 5);
+		else if(!strncmp(argv[i], "dataset=", 8))
+			dataFileName = argv[i] + 8;
+	}
+	i = 0;
+
+	/* Load (memory-mapped) dataset: input levels, graph and reference levels */
+	PRINT_STEP("Loading dataset \"%s\"...", dataFileName);
+	fRet = bfs_data_load(dataFileName, &data);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("bfs_data_load"));
+	numVertices = data.numVertices;
+	levels = malloc(numVertices * sizeof(unsigned int));
+	ASSERT_CALL(levels, POSIX_ERROR_STATEMENTS("levels"));
 	PRINT_SUCCESS();
+	printf("Dataset: %u vertices, %u edges, depth %u.\n", data.numVertices, data.numEdges, data.depth);
 
 	/* Get platforms IDs */
 	PRINT_STEP("Getting platforms IDs...");
@@ -170,11 +183,11 @@ int main(int argc, char *argv[]) {
 
 	/* Create input and output buffers */
 	PRINT_STEP("Creating buffers...");
-	levelsK = clCreateBuffer(context, CL_MEM_READ_WRITE, 1000 * sizeof(unsigned int), NULL, &fRet);
+	levelsK = clCreateBuffer(context, CL_MEM_READ_WRITE, numVertices * sizeof(unsigned int), NULL, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (levelsK)"));
-	edgeOffsetsK = clCreateBuffer(context, CL_MEM_READ_ONLY, 1001 * sizeof(unsigned int), NULL, &fRet);
+	edgeOffsetsK = clCreateBuffer(context, CL_MEM_READ_ONLY, (numVertices + 1) * sizeof(unsigned int), NULL, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (edgeOffsetsK)"));
-	edgeListK = clCreateBuffer(context, CL_MEM_READ_ONLY, 1998 * sizeof(unsigned int), NULL, &fRet);
+	edgeListK = clCreateBuffer(context, CL_MEM_READ_ONLY, (data.numEdges? data.numEdges : 1) * sizeof(unsigned int), NULL, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (edgeListK)"));
 	PRINT_SUCCESS();
 
@@ -193,12 +206,15 @@ int main(int argc, char *argv[]) {
 	do {
 		/* Setting input and output buffers */
 		PRINT_STEP("[%d] Setting buffers...", i);
-		fRet = clEnqueueWriteBuffer(queueBfs, levelsK, CL_TRUE, 0, 1000 * sizeof(unsigned int), levels, 0, NULL, NULL);
+		fRet = clEnqueueWriteBuffer(queueBfs, levelsK, CL_TRUE, 0, numVertices * sizeof(unsigned int), data.levels, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (levelsK)"));
-		fRet = clEnqueueWriteBuffer(queueBfs, edgeOffsetsK, CL_TRUE, 0, 1001 * sizeof(unsigned int), edgeOffsets, 0, NULL, NULL);
+		fRet = clEnqueueWriteBuffer(queueBfs, edgeOffsetsK, CL_TRUE, 0, (numVertices + 1) * sizeof(unsigned int), data.edgeOffsets, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (edgeOffsetsK)"));
-		fRet = clEnqueueWriteBuffer(queueBfs, edgeListK, CL_TRUE, 0, 1998 * sizeof(unsigned int), edgeList, 0, NULL, NULL);
-		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (edgeListK)"));
+		/* Edgeless datasets have nothing to write, their buffer only holds padding */
+		if(data.numEdges) {
+			fRet = clEnqueueWriteBuffer(queueBfs, edgeListK, CL_TRUE, 0, data.numEdges * sizeof(unsigned int), data.edgeList, 0, NULL, NULL);
+			ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (edgeListK)"));
+		}
 		PRINT_SUCCESS();
 
 		PRINT_STEP("[%d] Running kernels...", i);
@@ -211,14 +227,14 @@ int main(int argc, char *argv[]) {
 
 		/* Get output buffers */
 		PRINT_STEP("[%d] Getting kernels arguments...", i);
-		fRet = clEnqueueReadBuffer(queueBfs, levelsK, CL_TRUE, 0, 1000 * sizeof(unsigned int), levels, 0, NULL, NULL);
+		fRet = clEnqueueReadBuffer(queueBfs, levelsK, CL_TRUE, 0, numVertices * sizeof(unsigned int), levels, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueReadBuffer"));
 		PRINT_SUCCESS();
 
 		timersub(&tNow, &tThen, &tDelta);
 		timeradd(&tExecTime, &tDelta, &tExecTime);
 		i++;
-	} while(loopFlag);
+	} while(i < runsLen);
 
 	/* Print profiling results */
 	totalTime = (1000000 * tExecTime.tv_sec) + tExecTime.tv_usec;
@@ -226,17 +242,21 @@ int main(int argc, char *argv[]) {
 
 	/* Validate received data */
 	PRINT_STEP("Validating received data...");
-	for(i = 0; i < 1000; i++) {
-		if(levelsC[i] != levels[i]) {
+	for(i = 0; i < numVertices; i++) {
+		if(data.levelsC[i] != levels[i]) {
 			if(!invalidDataFound) {
 				PRINT_FAIL();
 				invalidDataFound = true;
 			}
-			printf("Variable levels[%d]: expected %u got %u.\n", i, levelsC[i], levels[i]);
+			/* Large graphs may have millions of mismatches, only the first ones are listed */
+			if(invalidDataLen++ < 16)
+				printf("Variable levels[%d]: expected %u got %u.\n", i, data.levelsC[i], levels[i]);
 		}
 	}
 	if(!invalidDataFound)
 		PRINT_SUCCESS();
+	if(invalidDataLen)
+		printf("%u of %u levels differ.\n", invalidDataLen, numVertices);
 
 _err:
 
@@ -249,10 +269,9 @@ _err:
 		clReleaseMemObject(edgeListK);
 
 	/* Dealloc variables */
-	free(levels);
-	free(levelsC);
-	free(edgeOffsets);
-	free(edgeList);
+	if(levels)
+		free(levels);
+	bfs_data_free(&data);
 
 	/* Dealloc kernels */
 	if(kernelBfs)
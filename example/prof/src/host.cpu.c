@@ -0,0 +1,244 @@
+/* ********************************************************************************************* */
+/* * C Template for Kernel Execution (CPU backend)                                             * */
+/* * Author: André Bannwart Perina                                                             * */
+/* ********************************************************************************************* */
+/* * Copyright (c) 2017 André B. Perina                                                        * */
+/* *                                                                                           * */
+/* * Permission is hereby granted, free of charge, to any person obtaining a copy of this      * */
+/* * software and associated documentation files (the "Software"), to deal in the Software     * */
+/* * without restriction, including without limitation the rights to use, copy, modify,        * */
+/* * merge, publish, distribute, sublicense, and/or sell copies of the Software, and to        * */
+/* * permit persons to whom the Software is furnished to do so, subject to the following       * */
+/* * conditions:                                                                               * */
+/* *                                                                                           * */
+/* * The above copyright notice and this permission notice shall be included in all copies     * */
+/* * or substantial portions of the Software.                                                  * */
+/* *                                                                                           * */
+/* * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,       * */
+/* * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR  * */
+/* * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE * */
+/* * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR      * */
+/* * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER    * */
+/* * DEALINGS IN THE SOFTWARE.                                                                 * */
+/* ********************************************************************************************* */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "bfsdata.h"
+#include "common.h"
+#include "pccpu.h"
+#include "pccritical.h"
+#include "pcdecoder.h"
+#include "pcphase.h"
+
+/**
+ * @brief Standard statements for function error handling and printing.
+ *
+ * @param funcName Function name that failed.
+ */
+#define FUNCTION_ERROR_STATEMENTS(funcName) {\
+	rv = EXIT_FAILURE;\
+	PRINT_FAIL();\
+	fprintf(stderr, "Error: %s failed with return code %d.\n", funcName, fRet);\
+}
+
+/**
+ * @brief Standard statements for POSIX error handling and printing.
+ *
+ * @param arg Arbitrary string to the printed at the end of error string.
+ */
+#define POSIX_ERROR_STATEMENTS(arg) {\
+	rv = EXIT_FAILURE;\
+	PRINT_FAIL();\
+	fprintf(stderr, "Error: %s: %s\n", strerror(errno), arg);\
+}
+
+/**
+ * @brief Kernel from src/bfs.cl, compiled as C with the CPU backend of ProfCounter.
+ */
+void bfs(unsigned *restrict levels, unsigned *restrict edgeOffsets, unsigned *restrict edgeList, unsigned numVertices);
+
+/**
+ * @brief Arguments of the bfs kernel.
+ */
+typedef struct {
+	unsigned *levels;
+	unsigned *edgeOffsets;
+	unsigned *edgeList;
+	unsigned numVertices;
+} bfs_args_t;
+
+/**
+ * @brief Work-item body, the kernel has a single work-item (reqd_work_group_size(1,1,1)).
+ */
+static void bfsWorkItem(unsigned id, void *arg) {
+	bfs_args_t *args = (bfs_args_t *) arg;
+
+	(void) id;
+	bfs(args->levels, args->edgeOffsets, args->edgeList, args->numVertices);
+}
+
+int main(int argc, char *argv[]) {
+	/* Return variable */
+	int rv = EXIT_SUCCESS;
+
+	/* Aux variables */
+	int i = 0;
+	int fRet;
+	int runsLen = 1;
+	const char *dataFileName = "graph.bfs";
+	bool invalidDataFound = false;
+	unsigned int invalidDataLen = 0;
+	long totalTime;
+	struct timeval tThen, tNow, tDelta, tExecTime;
+	timerclear(&tExecTime);
+
+	/* Input/output variables */
+	bfs_data_t data = {0};
+	bfs_args_t args = {0};
+	unsigned int *levels = NULL;
+	unsigned int numVertices;
+	unsigned prescaler = 0;
+	double speedup = PC_CRITICAL_DEFAULT_SPEEDUP;
+	pc_cpu_t cpu = {0};
+	const uint64_t *log;
+	size_t logLen;
+	pc_trace_t trace = {0};
+	pc_symtab_t symtab = {0};
+	pc_phases_t phases = {0};
+	pc_critical_t critical = {0};
+	FILE *csvFile = NULL;
+	double *edgesPerLevel = NULL;
+
+	for(i = 1; i < argc; i++) {
+		if(!strncmp(argv[i], "runs=", 5))
+			runsLen = atoi(argv[i] + 5);
+		else if(!strncmp(argv[i], "dataset=", 8))
+			dataFileName = argv[i] + 8;
+		else if(!strncmp(argv[i], "prescaler=", 10))
+			prescaler = strtoul(argv[i] + 10, NULL, 10);
+		else if(!strncmp(argv[i], "speedup=", 8))
+			speedup = strtod(argv[i] + 8, NULL);
+	}
+	i = 0;
+
+	/* Load (memory-mapped) dataset: input levels, graph and reference levels */
+	PRINT_STEP("Loading dataset \"%s\"...", dataFileName);
+	fRet = bfs_data_load(dataFileName, &data);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("bfs_data_load"));
+	numVertices = data.numVertices;
+	levels = malloc(numVertices * sizeof(unsigned int));
+	ASSERT_CALL(levels, POSIX_ERROR_STATEMENTS("levels"));
+	PRINT_SUCCESS();
+	printf("Dataset: %u vertices, %u edges, depth %u.\n", data.numVertices, data.numEdges, data.depth);
+
+	/* Prepare the CPU backend (one log per work-item) */
+	PRINT_STEP("Opening ProfCounter CPU backend...");
+	fRet = pc_cpu_open(&cpu, 1, prescaler);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_cpu_open"));
+	PRINT_SUCCESS();
+
+	/* Kernel arguments. The graph is read-only, so it is used straight from the memory-mapped dataset */
+	args.levels = levels;
+	args.edgeOffsets = (unsigned *) data.edgeOffsets;
+	args.edgeList = (unsigned *) data.edgeList;
+	args.numVertices = numVertices;
+
+	do {
+		/* Setting input and output buffers */
+		PRINT_STEP("[%d] Setting buffers...", i);
+		memcpy(levels, data.levels, numVertices * sizeof(unsigned int));
+		PRINT_SUCCESS();
+
+		PRINT_STEP("[%d] Running kernel...", i);
+		gettimeofday(&tThen, NULL);
+		fRet = pc_cpu_run(&cpu, 0, bfsWorkItem, &args);
+		gettimeofday(&tNow, NULL);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_cpu_run"));
+		PRINT_SUCCESS();
+
+		timersub(&tNow, &tThen, &tDelta);
+		timeradd(&tExecTime, &tDelta, &tExecTime);
+		i++;
+	} while(i < runsLen);
+
+	/* Print profiling results */
+	totalTime = (1000000 * tExecTime.tv_sec) + tExecTime.tv_usec;
+	printf("Elapsed time spent on kernels: %ld us; Average time per iteration: %lf us.\n", totalTime, totalTime / (double) i);
+
+	/* Validate received data */
+	PRINT_STEP("Validating received data...");
+	for(i = 0; (unsigned) i < numVertices; i++) {
+		if(data.levelsC[i] != levels[i]) {
+			if(!invalidDataFound) {
+				PRINT_FAIL();
+				invalidDataFound = true;
+			}
+			/* Large graphs may have millions of mismatches, only the first ones are listed */
+			if(invalidDataLen++ < 16)
+				printf("Variable levels[%d]: expected %u got %u.\n", i, data.levelsC[i], levels[i]);
+		}
+	}
+	if(!invalidDataFound)
+		PRINT_SUCCESS();
+	if(invalidDataLen)
+		printf("%u of %u levels differ.\n", invalidDataLen, numVertices);
+
+	/* Log of the last run, in the same format as the one read from profCounter */
+	log = pc_cpu_log(&cpu, 0, &logLen);
+	fRet = pc_decode(log, logLen, &trace);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_decode"));
+
+	/* Save raw log for offline analysis (e.g. regression tests with pcregress) */
+	ASSERT_CALL(EXIT_SUCCESS == pc_log_save("profcounter.log", log, logLen), rv = EXIT_FAILURE);
+
+	/* Name checkpoints after their source locations if the symbol table is available */
+	pc_symtab_load("bfs.pcsym", &symtab);
+
+	/* Export decoded trace */
+	csvFile = fopen("profcounter.csv", "w");
+	ASSERT_CALL(csvFile, POSIX_ERROR_STATEMENTS("profcounter.csv"));
+	pc_export_csv(csvFile, &trace, &symtab);
+
+	pc_print_trace(stdout, &trace, &symtab);
+
+	/* Per-level analysis. Each iteration of the outer loop is a BFS level, whose cost is correlated with the number of edges */
+	/* leaving the vertices of that level (taken from the reference levels of the dataset) */
+	if(EXIT_SUCCESS == pc_phase_analyse(&trace, PC_PHASE_AUTO_ANCHOR, &phases)) {
+		edgesPerLevel = calloc(phases.iterationsLen, sizeof(double));
+		ASSERT_CALL(edgesPerLevel, POSIX_ERROR_STATEMENTS("edgesPerLevel"));
+		for(i = 0; (unsigned) i < numVertices; i++) {
+			if(data.levelsC[i] < phases.iterationsLen)
+				edgesPerLevel[data.levelsC[i]] += data.edgeOffsets[i + 1] - data.edgeOffsets[i];
+		}
+
+		pc_print_phases(stdout, &phases, &trace, &symtab, edgesPerLevel, phases.iterationsLen);
+	}
+
+	/* Regions ranked by the end-to-end cycles projected if each were "speedup" times faster at every level */
+	if(EXIT_SUCCESS == pc_critical_analyse(&trace, speedup, &critical))
+		pc_print_critical(stdout, &critical, trace.header.ndrange, &symtab);
+
+_err:
+
+	/* Dealloc variables */
+	if(csvFile)
+		fclose(csvFile);
+	if(edgesPerLevel)
+		free(edgesPerLevel);
+	pc_phases_free(&phases);
+	pc_critical_free(&critical);
+	pc_symtab_free(&symtab);
+	pc_trace_free(&trace);
+	pc_cpu_close(&cpu);
+	if(levels)
+		free(levels);
+	bfs_data_free(&data);
+
+	return rv;
+}
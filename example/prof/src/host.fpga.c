@@ -29,10 +29,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
-#include <unistd.h>
 
+#include "bfsdata.h"
 #include "common.h"
-#include "prepostambles.h"
+#include "pccritical.h"
+#include "pcdecoder.h"
+#include "pclive.h"
+#include "pcphase.h"
+#include "pcsession.h"
 
 /**
  * @brief Standard statements for function error handling and printing.
@@ -56,6 +60,49 @@
 	fprintf(stderr, "Error: %s: %s\n", strerror(errno), arg);\
 }
 
+/**
+ * @brief Data shared with the log drain consumer.
+ */
+typedef struct {
+	const pc_symtab_t *symtab;
+	bool calibrated;
+	pc_calibration_t calibration;
+	/* Trace of the last drained run, analysed by the main thread */
+	pc_trace_t trace;
+} drain_context_t;
+
+/**
+ * @brief Log drain consumer, called by a worker thread for every run while the next run is already executing.
+ */
+static int drainConsumer(unsigned run, const uint64_t *log, size_t logLen, pc_trace_t *trace, void *arg) {
+	int rv = EXIT_SUCCESS;
+	drain_context_t *drainContext = (drain_context_t *) arg;
+	FILE *csvFile = NULL;
+
+	/* Report the pipe timing jitter if a calibration is available (see base project) */
+	if(drainContext->calibrated)
+		pc_apply_calibration(trace, &(drainContext->calibration));
+
+	/* Save raw log for offline analysis (e.g. regression tests with pcregress) */
+	ASSERT_CALL(EXIT_SUCCESS == pc_log_save("profcounter.log", log, logLen), rv = EXIT_FAILURE);
+
+	/* Export decoded trace */
+	csvFile = fopen("profcounter.csv", "w");
+	ASSERT_CALL(csvFile, fprintf(stderr, "Error: %s: profcounter.csv\n", strerror(errno)); rv = EXIT_FAILURE);
+	pc_export_csv(csvFile, trace, drainContext->symtab);
+
+	/* Keep the trace (the drain releases it otherwise) */
+	pc_trace_free(&(drainContext->trace));
+	drainContext->trace = *trace;
+	memset(trace, 0, sizeof(pc_trace_t));
+
+_err:
+	if(csvFile)
+		fclose(csvFile);
+
+	return rv;
+}
+
 int main(int argc, char *argv[]) {
 	/* Return variable */
 	int rv = EXIT_SUCCESS;
@@ -67,27 +114,16 @@ int main(int argc, char *argv[]) {
 	cl_platform_id *platforms = NULL;
 	cl_device_id *devices = NULL;
 	cl_context context = NULL;
-	cl_command_queue queueProfCounter = NULL;
 	cl_command_queue queueBfs = NULL;
-	FILE *programFile = NULL;
-	size_t programSz;
-	char *programContent = NULL;
-	cl_int programRet;
 	cl_program program = NULL;
-	cl_kernel kernelProfCounter = NULL;
 	cl_kernel kernelBfs = NULL;
-	bool loopFlag = false;
+	int runsLen = 1;
+	const char *dataFileName = "graph.bfs";
 	bool invalidDataFound = false;
+	unsigned int invalidDataLen = 0;
 	long totalTime;
 	struct timeval tThen, tNow, tDelta, tExecTime;
 	timerclear(&tExecTime);
-	cl_uint workDimProfCounter = 1;
-	size_t globalSizeProfCounter[1] = {
-		1
-	};
-	size_t localSizeProfCounter[1] = {
-		1
-	};
 	cl_uint workDimBfs = 1;
 	size_t globalSizeBfs[1] = {
 		1
@@ -97,21 +133,47 @@ int main(int argc, char *argv[]) {
 	};
 
 	/* Input/output variables */
-	long *log = calloc(65536, sizeof(long));
-	cl_mem logK = NULL;
-	unsigned int *levels = malloc(1000 * sizeof(unsigned int));
-	unsigned int *levelsC = malloc(1000 * sizeof(unsigned int));
+	bfs_data_t data = {0};
+	unsigned int *levels = NULL;
 	cl_mem levelsK = NULL;
-	unsigned int *edgeOffsets = malloc(1001 * sizeof(unsigned int));
 	cl_mem edgeOffsetsK = NULL;
-	unsigned int *edgeList = malloc(1998 * sizeof(unsigned int));
 	cl_mem edgeListK = NULL;
 	unsigned int numVertices;
-
-	/* Calling preamble function */
-	PRINT_STEP("Calling preamble function...");
-	PREAMBLE(levels, 1000, levelsC, 1000, edgeOffsets, 1001, edgeList, 1998, numVertices);
+	cl_uint prescaler = 0;
+	cl_uint interval = 0;
+	const char *liveSocket = NULL;
+	double speedup = PC_CRITICAL_DEFAULT_SPEEDUP;
+	pc_session_t session = {0};
+	pc_live_t live = {0};
+	drain_context_t drainContext = {0};
+	pc_symtab_t symtab = {0};
+	pc_phases_t phases = {0};
+	pc_critical_t critical = {0};
+	double *edgesPerLevel = NULL;
+
+	for(i = 1; i < argc; i++) {
+		if(!strncmp(argv[i], "runs=", 5))
+			runsLen = atoi(argv[i] + 5);
+		else if(!strncmp(argv[i], "dataset=", 8))
+			dataFileName = argv[i] + 8;
+		else if(!strncmp(argv[i], "interval=", 9))
+			interval = strtoul(argv[i] + 9, NULL, 10);
+		else if(!strncmp(argv[i], "live=", 5))
+			liveSocket = argv[i] + 5;
+		else if(!strncmp(argv[i], "speedup=", 8))
+			speedup = strtod(argv[i] + 8, NULL);
+	}
+	i = 0;
+
+	/* Load (memory-mapped) dataset: input levels, graph and reference levels */
+	PRINT_STEP("Loading dataset \"%s\"...", dataFileName);
+	fRet = bfs_data_load(dataFileName, &data);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("bfs_data_load"));
+	numVertices = data.numVertices;
+	levels = malloc(numVertices * sizeof(unsigned int));
+	ASSERT_CALL(levels, POSIX_ERROR_STATEMENTS("levels"));
 	PRINT_SUCCESS();
+	printf("Dataset: %u vertices, %u edges, depth %u.\n", data.numVertices, data.numEdges, data.depth);
 
 	/* Get platforms IDs */
 	PRINT_STEP("Getting platforms IDs...");
@@ -137,78 +199,45 @@ int main(int argc, char *argv[]) {
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateContext"));
 	PRINT_SUCCESS();
 
-	/* Create command queue for profCounter kernel */
-	PRINT_STEP("Creating command queue for \"profCounter\"...");
-	queueProfCounter = clCreateCommandQueue(context, devices[0], 0, &fRet);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateCommandQueue"));
-	PRINT_SUCCESS();
-
 	/* Create command queue for bfs kernel */
 	PRINT_STEP("Creating command queue for \"bfs\"...");
 	queueBfs = clCreateCommandQueue(context, devices[0], 0, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateCommandQueue"));
 	PRINT_SUCCESS();
 
-	/* Open binary file */
-	PRINT_STEP("Opening program binary...");
-	programFile = fopen("program.xclbin", "rb");
-	ASSERT_CALL(programFile, POSIX_ERROR_STATEMENTS("program.xclbin"));
+	/* Load (memory-mapped) and build program from binary file */
+	PRINT_STEP("Loading program binary...");
+	fRet = pc_program_load(context, devices[0], "program.xclbin", &program);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_program_load"));
 	PRINT_SUCCESS();
 
-	/* Get size and read file */
-	PRINT_STEP("Reading program binary...");
-	fseek(programFile, 0, SEEK_END);
-	programSz = ftell(programFile);
-	fseek(programFile, 0, SEEK_SET);
-	programContent = malloc(programSz);
-	fread(programContent, programSz, 1, programFile);
-	fclose(programFile);
-	programFile = NULL;
-	PRINT_SUCCESS();
-
-	/* Create program from binary file */
-	PRINT_STEP("Creating program from binary...");
-	program = clCreateProgramWithBinary(context, 1, devices, &programSz, (const unsigned char **) &programContent, &programRet, &fRet);
-	ASSERT_CALL(CL_SUCCESS == programRet, FUNCTION_ERROR_STATEMENTS("clCreateProgramWithBinary (when loading binary)"));
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateProgramWithBinary"));
-	PRINT_SUCCESS();
-
-	/* Build program */
-	PRINT_STEP("Building program...");
-	fRet = clBuildProgram(program, 1, devices, NULL, NULL, NULL);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clBuildProgram"));
-	PRINT_SUCCESS();
-
-	/* Create profCounter kernel */
-	PRINT_STEP("Creating kernel \"profCounter\" from program...");
-	kernelProfCounter = clCreateKernel(program, "profCounter", &fRet);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateKernel"));
+	/* Open ProfCounter session (profCounter kernel, its queue and log buffer) */
+	PRINT_STEP("Opening ProfCounter session...");
+	fRet = pc_session_open(&session, context, program, 0, prescaler);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_session_open"));
+	/* Sampling mode: one sample every "interval" cycles instead of one record per checkpoint */
+	fRet = pc_session_interval(&session, interval);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_session_interval"));
 	PRINT_SUCCESS();
 
 	/* Create bfs kernel */
 	PRINT_STEP("Creating kernel \"bfs\" from program...");
-	kernelBfs = clCreateKernel(program, "bfs", &fRet);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateKernel"));
+	fRet = pc_kernel_create(program, "bfs", &kernelBfs);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_kernel_create"));
 	PRINT_SUCCESS();
 
+	pc_print_startup(stdout);
+
 	/* Create input and output buffers */
 	PRINT_STEP("Creating buffers...");
-	logK = clCreateBuffer(context, CL_MEM_WRITE_ONLY, 65536 * sizeof(long), NULL, &fRet);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (logK)"));
-	levelsK = clCreateBuffer(context, CL_MEM_READ_WRITE, 1000 * sizeof(unsigned int), NULL, &fRet);
+	levelsK = clCreateBuffer(context, CL_MEM_READ_WRITE, numVertices * sizeof(unsigned int), NULL, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (levelsK)"));
-	edgeOffsetsK = clCreateBuffer(context, CL_MEM_READ_ONLY, 1001 * sizeof(unsigned int), NULL, &fRet);
+	edgeOffsetsK = clCreateBuffer(context, CL_MEM_READ_ONLY, (numVertices + 1) * sizeof(unsigned int), NULL, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (edgeOffsetsK)"));
-	edgeListK = clCreateBuffer(context, CL_MEM_READ_ONLY, 1998 * sizeof(unsigned int), NULL, &fRet);
+	edgeListK = clCreateBuffer(context, CL_MEM_READ_ONLY, (data.numEdges? data.numEdges : 1) * sizeof(unsigned int), NULL, &fRet);
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clCreateBuffer (edgeListK)"));
 	PRINT_SUCCESS();
 
-	/* Set kernel arguments for profCounter */
-	PRINT_STEP("Setting kernel arguments for \"profCounter\"...");
-	fRet = clSetKernelArg(kernelProfCounter, 0, sizeof(cl_mem), &logK);
-	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clSetKernelArg (logK)"));
-	PRINT_SUCCESS();
-
 	/* Set kernel arguments for bfs */
 	PRINT_STEP("Setting kernel arguments for \"bfs\"...");
 	fRet = clSetKernelArg(kernelBfs, 0, sizeof(cl_mem), &levelsK);
@@ -221,46 +250,81 @@ int main(int argc, char *argv[]) {
 	ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clSetKernelArg (numVertices)"));
 	PRINT_SUCCESS();
 
+	/* Report the pipe timing jitter if a calibration is available (see base project) */
+	drainContext.calibrated = EXIT_SUCCESS == pc_calibration_load("profcounter.cal", &(drainContext.calibration));
+
+	/* Name checkpoints after their source locations if the symbol table is available */
+	pc_symtab_load("bfs.pcsym", &symtab);
+	drainContext.symtab = &symtab;
+
+	/* Logs are read asynchronously into pinned memory and decoded/exported by a worker thread while the next run executes */
+	PRINT_STEP("Starting log drain...");
+	fRet = pc_session_drain(&session, 1, drainConsumer, &drainContext);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_session_drain"));
+	PRINT_SUCCESS();
+
+	/* Runs are streamed while they execute if a socket is given (live=<path>), follow them with pcwatch from the base project */
+	if(liveSocket) {
+		PRINT_STEP("Opening live streaming on \"%s\"...", liveSocket);
+		fRet = pc_live_open(&live, &session, liveSocket, 0);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_live_open"));
+		PRINT_SUCCESS();
+	}
+
 	do {
 		/* Setting input and output buffers */
 		PRINT_STEP("[%d] Setting buffers...", i);
-		fRet = clEnqueueWriteBuffer(queueProfCounter, logK, CL_TRUE, 0, 65536 * sizeof(long), log, 0, NULL, NULL);
-		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (logK)"));
-		fRet = clEnqueueWriteBuffer(queueBfs, levelsK, CL_TRUE, 0, 1000 * sizeof(unsigned int), levels, 0, NULL, NULL);
+		fRet = clEnqueueWriteBuffer(queueBfs, levelsK, CL_TRUE, 0, numVertices * sizeof(unsigned int), data.levels, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (levelsK)"));
-		fRet = clEnqueueWriteBuffer(queueBfs, edgeOffsetsK, CL_TRUE, 0, 1001 * sizeof(unsigned int), edgeOffsets, 0, NULL, NULL);
+		fRet = clEnqueueWriteBuffer(queueBfs, edgeOffsetsK, CL_TRUE, 0, (numVertices + 1) * sizeof(unsigned int), data.edgeOffsets, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (edgeOffsetsK)"));
-		fRet = clEnqueueWriteBuffer(queueBfs, edgeListK, CL_TRUE, 0, 1998 * sizeof(unsigned int), edgeList, 0, NULL, NULL);
-		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (edgeListK)"));
+		/* Edgeless datasets have nothing to write, their buffer only holds padding */
+		if(data.numEdges) {
+			fRet = clEnqueueWriteBuffer(queueBfs, edgeListK, CL_TRUE, 0, data.numEdges * sizeof(unsigned int), data.edgeList, 0, NULL, NULL);
+			ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueWriteBuffer (edgeListK)"));
+		}
 		PRINT_SUCCESS();
 
 		PRINT_STEP("[%d] Running kernels...", i);
-		fRet = clEnqueueNDRangeKernel(queueProfCounter, kernelProfCounter, workDimProfCounter, NULL, globalSizeProfCounter, localSizeProfCounter, 0, NULL, NULL);
-		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueNDRangeKernel"));
-
-		// XXX: wait to settle down
-		sleep(1);
+		fRet = pc_arm(&session);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_arm"));
+		if(liveSocket) {
+			fRet = pc_live_watch(&live);
+			ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_live_watch"));
+		}
+		fRet = pc_wait_armed(&session);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_wait_armed"));
 
 		gettimeofday(&tThen, NULL);
 		fRet = clEnqueueNDRangeKernel(queueBfs, kernelBfs, workDimBfs, NULL, globalSizeBfs, localSizeBfs, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueNDRangeKernel"));
 		clFinish(queueBfs);
 		gettimeofday(&tNow, NULL);
-		clFinish(queueProfCounter);
+		/* The next pc_arm() clears the log buffer, thus the live stream must end first */
+		if(liveSocket) {
+			fRet = pc_live_wait(&live);
+			ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_live_wait"));
+		}
 		PRINT_SUCCESS();
 
-		/* Get output buffers */
+		/* Get output buffers. The log is drained asynchronously once profCounter finishes */
 		PRINT_STEP("[%d] Getting kernels arguments...", i);
-		fRet = clEnqueueReadBuffer(queueProfCounter, logK, CL_TRUE, 0, 65536 * sizeof(long), log, 0, NULL, NULL);
-		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueReadBuffer"));
-		fRet = clEnqueueReadBuffer(queueBfs, levelsK, CL_TRUE, 0, 1000 * sizeof(unsigned int), levels, 0, NULL, NULL);
+		fRet = pc_collect_async(&session);
+		ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_collect_async"));
+		fRet = clEnqueueReadBuffer(queueBfs, levelsK, CL_TRUE, 0, numVertices * sizeof(unsigned int), levels, 0, NULL, NULL);
 		ASSERT_CALL(CL_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("clEnqueueReadBuffer"));
 		PRINT_SUCCESS();
 
 		timersub(&tNow, &tThen, &tDelta);
 		timeradd(&tExecTime, &tDelta, &tExecTime);
 		i++;
-	} while(loopFlag);
+	} while(i < runsLen);
+
+	/* Wait for the last logs */
+	PRINT_STEP("Waiting for log drain...");
+	fRet = pc_session_wait(&session);
+	ASSERT_CALL(EXIT_SUCCESS == fRet, FUNCTION_ERROR_STATEMENTS("pc_session_wait"));
+	PRINT_SUCCESS();
 
 	/* Print profiling results */
 	totalTime = (1000000 * tExecTime.tv_sec) + tExecTime.tv_usec;
@@ -268,37 +332,55 @@ int main(int argc, char *argv[]) {
 
 	/* Validate received data */
 	PRINT_STEP("Validating received data...");
-	for(i = 0; i < 1000; i++) {
-		if(levelsC[i] != levels[i]) {
+	for(i = 0; i < numVertices; i++) {
+		if(data.levelsC[i] != levels[i]) {
 			if(!invalidDataFound) {
 				PRINT_FAIL();
 				invalidDataFound = true;
 			}
-			printf("Variable levels[%d]: expected %u got %u.\n", i, levelsC[i], levels[i]);
+			/* Large graphs may have millions of mismatches, only the first ones are listed */
+			if(invalidDataLen++ < 16)
+				printf("Variable levels[%d]: expected %u got %u.\n", i, data.levelsC[i], levels[i]);
 		}
 	}
 	if(!invalidDataFound)
 		PRINT_SUCCESS();
+	if(invalidDataLen)
+		printf("%u of %u levels differ.\n", invalidDataLen, numVertices);
+
+	/* Trace of the last run (raw log and CSV export were saved by the drain consumer) */
+	pc_print_trace(stdout, &(drainContext.trace), &symtab);
+	pc_print_telemetry(stdout, &(drainContext.trace));
+	/* Bytes and bandwidth per region, if profCounter monitors the bfs memory port (AXI_MONITOR) */
+	pc_print_traffic(stdout, &(drainContext.trace), &symtab);
+	/* Time-in-region profile, if the runs were sampled (interval=<cycles>) */
+	pc_print_samples(stdout, &(drainContext.trace), &symtab);
+
+	/* Per-level analysis. Each iteration of the outer loop is a BFS level, whose cost is correlated with the number of edges */
+	/* leaving the vertices of that level (taken from the reference levels of the dataset) */
+	if(EXIT_SUCCESS == pc_phase_analyse(&(drainContext.trace), PC_PHASE_AUTO_ANCHOR, &phases)) {
+		edgesPerLevel = calloc(phases.iterationsLen, sizeof(double));
+		ASSERT_CALL(edgesPerLevel, POSIX_ERROR_STATEMENTS("edgesPerLevel"));
+		for(i = 0; i < numVertices; i++) {
+			if(data.levelsC[i] < phases.iterationsLen)
+				edgesPerLevel[data.levelsC[i]] += data.edgeOffsets[i + 1] - data.edgeOffsets[i];
+		}
 
-	printf("Information provided by \"profCounter\":\n");
-	printf("|          |        Timestamp        |\n");
-	printf("| Chkpt ID |   Absolute |   Relative |\n");
-	for(i = 0; i < 65536; i++) {
-		if(!(log[i]))
-			break;
-
-		unsigned checkpointID = (log[i] >> 60) & 0xF;
-		uint64_t timestamp0 = log[0] & 0xFFFFFFFFFFFFFFF;
-		uint64_t timestampi = log[i] & 0xFFFFFFFFFFFFFFF;
-
-		printf("|       %2x | %10ld | %10ld |\n", checkpointID, timestampi, timestampi - timestamp0);
+		pc_print_phases(stdout, &phases, &(drainContext.trace), &symtab, edgesPerLevel, phases.iterationsLen);
 	}
 
+	/* Regions ranked by the end-to-end cycles projected if each were "speedup" times faster at every level */
+	if(EXIT_SUCCESS == pc_critical_analyse(&(drainContext.trace), speedup, &critical))
+		pc_print_critical(stdout, &critical, drainContext.trace.header.ndrange, &symtab);
+
 _err:
 
+	/* Close live streaming and ProfCounter session (waits for pending logs) */
+	if(liveSocket)
+		pc_live_close(&live);
+	pc_close(&session);
+
 	/* Dealloc buffers */
-	if(logK)
-		clReleaseMemObject(logK);
 	if(levelsK)
 		clReleaseMemObject(levelsK);
 	if(edgeOffsetsK)
@@ -307,32 +389,31 @@ _err:
 		clReleaseMemObject(edgeListK);
 
 	/* Dealloc variables */
-	free(log);
-	free(levels);
-	free(levelsC);
-	free(edgeOffsets);
-	free(edgeList);
+	if(edgesPerLevel)
+		free(edgesPerLevel);
+	pc_phases_free(&phases);
+	pc_critical_free(&critical);
+	pc_symtab_free(&symtab);
+	pc_trace_free(&(drainContext.trace));
+	if(levels)
+		free(levels);
+	bfs_data_free(&data);
 
 	/* Dealloc kernels */
-	if(kernelProfCounter)
-		clReleaseKernel(kernelProfCounter);
 	if(kernelBfs)
 		clReleaseKernel(kernelBfs);
 
 	/* Dealloc program */
 	if(program)
 		clReleaseProgram(program);
-	if(programContent)
-		free(programContent);
-	if(programFile)
-		fclose(programFile);
 
 	/* Dealloc queues */
-	if(queueProfCounter)
-		clReleaseCommandQueue(queueProfCounter);
 	if(queueBfs)
 		clReleaseCommandQueue(queueBfs);
 
+	/* Release cached programs and kernels */
+	pc_cache_release();
+
 	/* Last OpenCL variables */
 	if(context)
 		clReleaseContext(context);